@@ -3,6 +3,8 @@ import serial
 import time
 import threading
 import json
+import re
+import collections
 import paho.mqtt.client as mqtt
 
 # --- RAK4270_RPi Class ---    
@@ -20,7 +22,13 @@ class RAK4270_RPi:
         self.LORA_CR = 1
         self.LORA_PREAMBLE = 5
         self.LORA_TX_POWER = 5
+        self.NODE_WAKE_DELAY_S = 0.3 # Farm units light-sleep; a wake frame goes ahead of each command, the first bytes after a wake are lost. Keep below the node's IDLE_SHARED_WAKE_MS
         self.mqtt_client = None # MQTT client instance
+        self.sensor_schema = list(DEFAULT_SENSOR_SCHEMA) # "sv"/"ss" slots, replaced by the node's "sc" frame
+        self.time_sync_due = True # node clock for its SD log; set again when a node boots
+        self.pending_acks = [] # "q" of received frames, acked from the main thread
+        self.ack_lock = threading.Lock()
+        self.seen_frames = collections.deque(maxlen=FRAME_DEDUP_WINDOW) # (room, q, ts) of recent frames, replays arrive twice
 
     def _string_to_hex(self, s):
         return ''.join([hex(ord(c))[2:].zfill(2) for c in s]).upper()
@@ -105,7 +113,11 @@ class RAK4270_RPi:
 
     def send_json_payload(self, json_data_obj):
         # ... (Your working send_json_payload method) ...
+        MAX_HEX_PAYLOAD_CHARS_FOR_AT_CMD = 235 
         json_string = json.dumps(json_data_obj, separators=(',', ':')) 
+        # Hub clock ("t") for the node's SD log, when the frame has room for it
+        timed_string = json.dumps(dict(json_data_obj, t=int(time.time())), separators=(',', ':'))
+        if len(timed_string) * 2 <= MAX_HEX_PAYLOAD_CHARS_FOR_AT_CMD: json_string = timed_string
         # print(f"RPi: Attempting to send JSON via LoRa: {json_string}")
 
         if not self._set_transfer_mode(2): 
@@ -113,11 +125,12 @@ class RAK4270_RPi:
             self._set_transfer_mode(1); return False
         
         hex_payload = self._string_to_hex(json_string)
-        MAX_HEX_PAYLOAD_CHARS_FOR_AT_CMD = 235 
         if len(hex_payload) > MAX_HEX_PAYLOAD_CHARS_FOR_AT_CMD:
             print(f"Error: HEX Payload ({len(hex_payload)} chars) exceeds AT cmd limit ({MAX_HEX_PAYLOAD_CHARS_FOR_AT_CMD} chars).")
             self._set_transfer_mode(1); return False
 
+        self._send_at("at+send=lorap2p:00", "OK", timeout=5.0, silent_success=True) # Wake frame, ignored by the node (not JSON)
+        time.sleep(self.NODE_WAKE_DELAY_S)
         sent_ok = self._send_at(f"at+send=lorap2p:{hex_payload}", "OK", timeout=5.0, silent_success=True) # Make send silent too
         
         time.sleep(0.1) 
@@ -147,10 +160,26 @@ class RAK4270_RPi:
                                 
                                 compact_json_string = self._hex_to_string(data_hex)
                                 if not (compact_json_string.startswith("HEX_") and "ERROR" in compact_json_string):
-                                    verbose_json_string = self.reconstruct_to_verbose_json(compact_json_string)
-                                    if verbose_json_string and self.mqtt_client:
-                                        self.mqtt_client.publish(mqtt_telemetry_topic, verbose_json_string, qos=0)
-                                        print(f"RPi-MQTT: Published telemetry to {mqtt_telemetry_topic}")
+                                    alert_json_string = self.reconstruct_alert_json(compact_json_string)
+                                    actuator_json_string = self.reconstruct_actuator_reply(compact_json_string)
+                                    if not self.register_frame(compact_json_string):
+                                        print("RPi-RAK: Duplicate frame from node backlog, acked again and skipped")
+                                    elif self.update_sensor_schema(compact_json_string):
+                                        print(f"RPi-RAK: Sensor schema from node: {[d['name'] for d in self.sensor_schema]}")
+                                        self.time_sync_due = True # sent at boot: the node has no clock yet
+                                    elif alert_json_string:
+                                        # Rule transitions from the node, sent as they happen
+                                        if self.mqtt_client: self.mqtt_client.publish(MQTT_ALERT_TOPIC, alert_json_string, qos=1)
+                                        print(f"RPi-MQTT: Published alert transition(s) to {MQTT_ALERT_TOPIC}")
+                                    elif actuator_json_string:
+                                        # What the node's relays did with an "act" command, refused requests included
+                                        if self.mqtt_client: self.mqtt_client.publish(MQTT_ACTUATOR_STATE_TOPIC, actuator_json_string, qos=1)
+                                        print(f"RPi-MQTT: Actuator state reported by node: {actuator_json_string}")
+                                    else:
+                                        verbose_json_string = self.reconstruct_to_verbose_json(compact_json_string)
+                                        if verbose_json_string and self.mqtt_client:
+                                            self.mqtt_client.publish(mqtt_telemetry_topic, verbose_json_string, qos=0)
+                                            print(f"RPi-MQTT: Published telemetry to {mqtt_telemetry_topic}")
                                     # else: print(f"RPi-RAK: Reconstructed to: {verbose_json_string}") # For direct print
                                 else:
                                     print(f"RPi-RAK: Error decoding HEX from ESP32: {compact_json_string}")
@@ -176,32 +205,100 @@ class RAK4270_RPi:
         if self.serial and self.serial.is_open: print("RPi-RAK: Closing serial port."); self.serial.close()
         print("RPi-RAK: Listener resources released.")
 
+    def reconstruct_alert_json(self, compact_json_string):
+        # {"i": "R1", "al": [[rule id, 1 fired / 0 cleared, value * 1000], ...]}, None for anything else
+        try:
+            compact_data = json.loads(compact_json_string)
+            if "al" not in compact_data: return None
+            events = [{"rule": e[0], "state": "FIRING" if e[1] == 1 else "CLEARED", "value": e[2] / 1000.0} for e in compact_data["al"] if len(e) >= 3]
+            verbose_alerts = {"room_id": compact_data.get("i", "ESP_Room_Unknown"), "alerts": events}
+            verbose_alerts.update(frame_timing(compact_data))
+            return json.dumps(verbose_alerts)
+        except Exception as e:
+            print(f"RPi-RAK: Error reconstructing alert JSON: {e}")
+            return None
+
+    def reconstruct_actuator_reply(self, compact_json_string):
+        # {"i": "R1", "z": zone, "aa": [result per actuator, -1 not commanded], "av": [states]}, None for anything else
+        try:
+            compact_data = json.loads(compact_json_string)
+            if "aa" not in compact_data: return None
+            names = ["WATER_PUMP", "PH_RELAY", "NUTRIENTS_RELAY"]
+            compact_av = compact_data.get("av", [])
+            reply = {"room_id": compact_data.get("i", "ESP_Room_Unknown"), "zone": compact_data.get("z", 0),
+                     "actuator_status": {name: "ON" if i < len(compact_av) and compact_av[i] == 1 else "OFF" for i, name in enumerate(names)},
+                     "results": {names[i]: ACTUATOR_RESULTS.get(r, "UNKNOWN") for i, r in enumerate(compact_data["aa"][:len(names)]) if r >= 0}}
+            reply.update(frame_timing(compact_data))
+            return json.dumps(reply)
+        except Exception as e:
+            print(f"RPi-RAK: Error reconstructing actuator reply: {e}")
+            return None
+
+    def register_frame(self, compact_json_string):
+        # Numbered frames ("q") are acked whether new or not; False for one the hub already has
+        try: compact_data = json.loads(compact_json_string)
+        except Exception: return True
+        if "q" not in compact_data: return True
+        with self.ack_lock: self.pending_acks.append(compact_data["q"])
+        room = compact_data.get("i")
+        if "sc" in compact_data: # node booted, its numbering restarts: untimed frames of the last boot cannot be told apart
+            self.seen_frames = collections.deque((k for k in self.seen_frames if k[0] != room or k[2] is not None), maxlen=FRAME_DEDUP_WINDOW)
+        key = (room, compact_data["q"], compact_data.get("ts"))
+        if key in self.seen_frames: return False
+        self.seen_frames.append(key)
+        return True
+
+    def take_acks(self):
+        with self.ack_lock:
+            acks = self.pending_acks[:ACKS_PER_FRAME]; self.pending_acks = self.pending_acks[ACKS_PER_FRAME:]
+        return acks
+
+    def update_sensor_schema(self, compact_json_string):
+        # {"i": "R1", "sc": [[name, scale, unit, period_s], ...]} in slot order, sent by the node at boot
+        try:
+            compact_data = json.loads(compact_json_string)
+            if "sc" not in compact_data: return False
+            self.sensor_schema = [{"name": e[0], "scale": float(e[1]), "unit": e[2], "period_s": e[3]} for e in compact_data["sc"] if len(e) >= 4]
+            return True
+        except Exception as e:
+            print(f"RPi-RAK: Error reading sensor schema: {e}")
+            return False
+
     def reconstruct_to_verbose_json(self, compact_json_string):
         try:
             compact_data = json.loads(compact_json_string)
             verbose_data = {}
             verbose_data["room_id"] = compact_data.get("i", "ESP_Room_Unknown") 
             verbose_data["mode"] = "auto" if compact_data.get("m") == 0 else "manual"
+            verbose_data.update(frame_timing(compact_data))
 
             verbose_sensors = {}
             compact_sv = compact_data.get("sv", []) 
             compact_ss = compact_data.get("ss", [])
             
-            sensor_details = [
-                {"name": "pH", "key_v": "ph_v", "key_sp": "ph_sp", "scale": 10.0, "unit": ""},
-                {"name": "EC", "key_v": "ec_v", "key_sp": "ec_sp", "scale": 100.0, "unit": ""},
-                {"name": "air_temperature", "key_v": "at_v", "key_sp": "at_sp", "scale": 10.0, "unit": "C"},
-                {"name": "CO2", "key_v": "co2_v", "key_sp": "co2_sp", "scale": 1.0, "unit": "ppm"},
-                {"name": "light", "key_v": "lt_v", "key_sp": "lt_sp", "scale": 1.0, "unit": ""}
-            ]
-
-            for i, detail in enumerate(sensor_details):
+            for i, detail in enumerate(self.sensor_schema):
                 s_obj = {}
                 if i < len(compact_sv): s_obj["value"] = compact_sv[i] / detail["scale"] if detail["scale"] != 1.0 else compact_sv[i]
                 if i < len(compact_ss): s_obj["setpoint"] = compact_ss[i] / detail["scale"] if detail["scale"] != 1.0 else compact_ss[i]
                 if s_obj: verbose_sensors[detail["name"]] = s_obj
+
+            # Reading noise around the filtered estimate (std dev * 1000) for the water chemistry sensors
+            compact_fv = compact_data.get("fv", [])
+            for i, name in enumerate(["pH", "EC"]):
+                if i < len(compact_fv) and name in verbose_sensors: verbose_sensors[name]["noise"] = compact_fv[i] / 1000.0
+
+            # Spread over the device statistics window
+            compact_sd = compact_data.get("sd", [])
+            spread_details = [("pH", 100.0), ("EC", 1000.0), ("water_temperature", 100.0), ("CO2", 1.0)]
+            for i, (name, scale) in enumerate(spread_details):
+                if i < len(compact_sd): verbose_sensors.setdefault(name, {})["spread"] = compact_sd[i] / scale
             
             if verbose_sensors: verbose_data["sensors"] = verbose_sensors
+            if "w" in compact_data: verbose_data["task_wakeups_per_min"] = compact_data["w"]
+            if "sl" in compact_data: verbose_data["asleep_fraction"] = compact_data["sl"] / 1000.0
+            compact_rt = compact_data.get("rt", [])
+            rate_names = ["water", "environment", "level", "telemetry"]
+            if compact_rt: verbose_data["sample_periods_s"] = {rate_names[i]: compact_rt[i] for i in range(min(len(compact_rt), len(rate_names)))}
 
             verbose_actuators = {}
             compact_av = compact_data.get("av", [])
@@ -212,7 +309,31 @@ class RAK4270_RPi:
                 if i < len(compact_av) and key_compact in actuator_names_map:
                      verbose_actuators[actuator_names_map[key_compact]] = "ON" if compact_av[i] == 1 else "OFF"
             if verbose_actuators: verbose_data["actuator_status"] = verbose_actuators
-            
+
+            # Duty accounting: [starts, on-time s] per actuator in "av" order
+            compact_ac = compact_data.get("ac", [])
+            actuator_duty = {}
+            for i, key_compact in enumerate(actuator_keys_ordered):
+                if 2 * i + 1 < len(compact_ac): actuator_duty[actuator_names_map[key_compact]] = {"starts": compact_ac[2 * i], "on_time_s": compact_ac[2 * i + 1]}
+            if actuator_duty: verbose_data["actuator_duty"] = actuator_duty
+
+            # Dosing convergence: [error, in-band permille, doses, dosed s] per loop, error positive when a dose is due
+            compact_pc = compact_data.get("pc", [])
+            dosing_control = {}
+            for i, (name, scale) in enumerate([("pH", 100.0), ("EC", 1000.0)]):
+                if 4 * i + 3 < len(compact_pc): dosing_control[name] = {"error": compact_pc[4 * i] / scale, "in_band_fraction": compact_pc[4 * i + 1] / 1000.0, "doses": compact_pc[4 * i + 2], "dosed_s": compact_pc[4 * i + 3]}
+            if dosing_control: verbose_data["dosing_control"] = dosing_control
+
+            # Multi-zone units: [pH*10, EC*100, pH sp*10, EC sp*100, relay bits, pH err*100, EC err*1000] per zone
+            zone_rows = compact_data.get("zn", [])
+            zones = []
+            for z, row in enumerate(zone_rows):
+                if len(row) < 7: continue
+                zones.append({"zone": z, "pH": row[0] / 10.0, "EC": row[1] / 100.0, "pH_sp": row[2] / 10.0, "EC_sp": row[3] / 100.0,
+                              "actuators": {name: "ON" if row[4] & (1 << i) else "OFF" for i, name in enumerate(["WATER_PUMP", "PH_RELAY", "NUTRIENTS_RELAY"])},
+                              "pH_error": row[5] / 100.0, "EC_error": row[6] / 1000.0})
+            if zones: verbose_data["zones"] = zones
+
             verbose_data["alerts"] = {"code": compact_data.get("x", 0)}
             return json.dumps(verbose_data, indent=2)
         except Exception as e:
@@ -224,7 +345,59 @@ MQTT_BROKER = "localhost" # Or your MQTT broker IP/hostname
 MQTT_PORT = 1883
 MQTT_TELEMETRY_TOPIC = "hydroponics/room1/telemetry_verbose" # RPi publishes ESP32 data here
 MQTT_COMMAND_TOPIC_AUTO = "hydroponics/room1/command/auto"
-MQTT_COMMAND_TOPIC_MANUAL_ACTUATOR = "hydroponics/room1/command/actuator" # e.g., actuator/wp payload "ON"
+MQTT_COMMAND_TOPIC_MANUAL_ACTUATOR = "hydroponics/room1/command/actuator" # e.g., actuator/wp payload "ON", actuator/1/wp for zone 1
+MQTT_COMMAND_TOPIC_RATES = "hydroponics/room1/command/rates" # e.g., {"water": [1, 10], "telemetry": [30, 300]} (min/max period in s)
+MQTT_COMMAND_TOPIC_ALERTS = "hydroponics/room1/command/alerts" # e.g., {"id": 1, "rule": "pH > 7.5 for 60 s"}, "rule": null removes it
+MQTT_ALERT_TOPIC = "hydroponics/room1/alerts" # RPi publishes rule transitions from the ESP32 here
+MQTT_ACTUATOR_STATE_TOPIC = "hydroponics/room1/actuator_state" # relay states the ESP32 reports after an actuator command
+ACTUATOR_RESULTS = {0: "OK", 1: "OK", 2: "REFUSED_BUSY", 3: "REFUSED_MIN_OFF", 4: "REFUSED_INTERLOCK"} # node ActuatorResult codes
+# Store-and-forward: frames carry "q" (and "ts" once the node has the hub clock); the hub acks
+# every number it gets, drops the duplicates and files replayed frames at their own time
+ACKS_PER_FRAME = 10 # {"k":[...]} within the downlink AT limit
+ACK_INTERVAL_S = 5
+FRAME_DEDUP_WINDOW = 4096
+BACKFILL_AGE_S = 120 # older frames are flagged as backfill
+
+def frame_timing(compact_data):
+    timing = {}
+    if "q" in compact_data: timing["sequence"] = compact_data["q"]
+    if "ts" in compact_data:
+        timing["timestamp"] = compact_data["ts"]
+        if time.time() - compact_data["ts"] > BACKFILL_AGE_S: timing["backfill"] = True
+    return timing
+
+# "sv"/"ss" slot layout until a node sends its own ("sc" frame, generated from the node's sensor registry)
+DEFAULT_SENSOR_SCHEMA = [
+    {"name": "pH", "scale": 10.0, "unit": "", "period_s": 1},
+    {"name": "EC", "scale": 100.0, "unit": "mS/cm", "period_s": 1},
+    {"name": "air_temperature", "scale": 10.0, "unit": "C", "period_s": 5},
+    {"name": "CO2", "scale": 1.0, "unit": "ppm", "period_s": 10},
+    {"name": "light", "scale": 1.0, "unit": "lux", "period_s": 5}
+]
+
+# --- Alert rule compiler ---
+# Text rules become the node's postfix bytecode (alert_engine.h), values in milli-units:
+#   "pH > 7.5 for 60 s", "EC rate < -0.1/min", "air_temp > 30 and co2 > 1500 for 120 s"
+ALERT_SIGNALS = {"ph": 0, "ec": 1, "water_temp": 2, "air_temp": 3, "co2": 4, "light": 5, "level": 6}
+ALERT_OP_VAL, ALERT_OP_RATE, ALERT_OP_CONST = 1, 2, 3
+ALERT_COMPARE_OPS = {">": 4, "<": 5, ">=": 6, "<=": 7}
+ALERT_LOGIC_OPS = {"and": 8, "or": 9}
+
+def compile_alert_rule(rule_id, text):
+    text = text.strip().lower().replace("/min", "")
+    hold_s = 0
+    m = re.search(r"\s+for\s+(\d+)\s*s?$", text)
+    if m: hold_s = int(m.group(1)); text = text[:m.start()]
+    parts = re.split(r"\s+(and|or)\s+", text)  # clauses at even indices, connectives between, left to right
+    code = []
+    for i, part in enumerate(parts):
+        if i % 2 == 1: continue
+        c = re.match(r"^(\w+)(\s+rate)?\s*(>=|<=|>|<)\s*(-?[\d.]+)$", part.strip())
+        if not c or c.group(1) not in ALERT_SIGNALS: raise ValueError(f"cannot parse clause '{part.strip()}'")
+        code += [ALERT_OP_RATE if c.group(2) else ALERT_OP_VAL, ALERT_SIGNALS[c.group(1)], ALERT_OP_CONST, int(round(float(c.group(4)) * 1000)), ALERT_COMPARE_OPS[c.group(3)]]
+        if i > 0: code.append(ALERT_LOGIC_OPS[parts[i - 1]])
+    if len(code) > 16: raise ValueError("rule too long for the node (16 words)")
+    return [int(rule_id), hold_s] + code
 
 mqtt_client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1, client_id="RPiLoRaBridge")
 rpi_rak_device = None # Global for RAK device
@@ -237,6 +410,10 @@ def on_mqtt_connect(client, userdata, flags, rc):
         print(f"RPi-MQTT: Subscribed to {MQTT_COMMAND_TOPIC_AUTO}")
         client.subscribe(MQTT_COMMAND_TOPIC_MANUAL_ACTUATOR + "/#") # Subscribe to all subtopics like /wp, /phr
         print(f"RPi-MQTT: Subscribed to {MQTT_COMMAND_TOPIC_MANUAL_ACTUATOR}/#")
+        client.subscribe(MQTT_COMMAND_TOPIC_RATES)
+        print(f"RPi-MQTT: Subscribed to {MQTT_COMMAND_TOPIC_RATES}")
+        client.subscribe(MQTT_COMMAND_TOPIC_ALERTS)
+        print(f"RPi-MQTT: Subscribed to {MQTT_COMMAND_TOPIC_ALERTS}")
     else:
         print(f"RPi-MQTT: Failed to connect, return code {rc}")
 
@@ -266,11 +443,13 @@ def on_mqtt_message(client, userdata, msg):
                     int(data.get("setpoints", {}).get("light", 300))
                 ]
             }
+            if "zone" in data: compact_lora_payload["z"] = int(data["zone"]) # pH/EC setpoints for one zone only, otherwise every zone
         except Exception as e:
             print(f"RPi-MQTT: Error parsing auto command JSON: {e}")
 
     elif msg.topic.startswith(MQTT_COMMAND_TOPIC_MANUAL_ACTUATOR + "/"):
         actuator_name_full = msg.topic.split('/')[-1].upper() # e.g., WP -> WATER_PUMP
+        zone_part = msg.topic.split('/')[-2] # actuator/<zone>/<name> on multi-zone units
         actuator_state_str = payload_str.upper()
         
         # Map full names to compact keys used in LoRa JSON
@@ -287,9 +466,31 @@ def on_mqtt_message(client, userdata, msg):
                 }
             }
             compact_lora_payload["act"][compact_key] = 1 if actuator_state_str == "ON" else 0
+            if zone_part.isdigit(): compact_lora_payload["z"] = int(zone_part)
+            # Only a request: the state comes back from the node on MQTT_ACTUATOR_STATE_TOPIC
+            print(f"RPi-MQTT: Requesting {actuator_name_full} {actuator_state_str}, waiting for the node's reply")
         else:
             print(f"RPi-MQTT: Unknown actuator name: {actuator_name_full}")
 
+    elif msg.topic == MQTT_COMMAND_TOPIC_RATES:
+        try:
+            # Sampling policy only, no "md": the node keeps its mode
+            data = json.loads(payload_str)
+            rate_keys = {"water": "w", "environment": "e", "level": "l", "telemetry": "t"}
+            rates = {rate_keys[k]: [int(v[0]), int(v[1])] for k, v in data.items() if k in rate_keys and len(v) >= 2}
+            if rates: compact_lora_payload = {"ar": rates}
+        except Exception as e:
+            print(f"RPi-MQTT: Error parsing rates command JSON: {e}")
+
+    elif msg.topic == MQTT_COMMAND_TOPIC_ALERTS:
+        try:
+            # Alert rule only, no "md": [id] removes, [id, hold_s, code...] sets
+            data = json.loads(payload_str)
+            rule_text = data.get("rule")
+            compact_lora_payload = {"ru": compile_alert_rule(data["id"], rule_text) if rule_text else [int(data["id"])]}
+        except Exception as e:
+            print(f"RPi-MQTT: Error compiling alert rule: {e}")
+
     if compact_lora_payload:
         print(f"RPi-MQTT: Sending LoRa command: {compact_lora_payload}")
         rpi_rak_device.send_json_payload(compact_lora_payload)
@@ -316,7 +517,12 @@ if __name__ == "__main__":
         print("RPi LoRa-MQTT Bridge is running. Node-RED can now interact. Press Ctrl+C to exit.")
         try:
             while True:
-                time.sleep(10) # Keep main thread alive, can do other tasks here if needed
+                time.sleep(ACK_INTERVAL_S) # Keep main thread alive; downlinks the listener asks for go out from here
+                acks = rpi_rak_device.take_acks()
+                if acks: rpi_rak_device.send_json_payload({"k": acks})
+                if rpi_rak_device.time_sync_due:
+                    rpi_rak_device.time_sync_due = False
+                    rpi_rak_device.send_json_payload({"t": int(time.time())}) # clock only, the node keeps its mode
         except KeyboardInterrupt:
             print("\nRPi: Shutting down bridge...")
         finally:
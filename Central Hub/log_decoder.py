@@ -0,0 +1,102 @@
+# log_decoder.py - reads the Farm Unit SD log (/log/*.bin) on a PC or the RPi
+import struct
+import sys
+import zlib
+
+LOG_BLOCK_SIZE = 512
+LOG_MAGIC = 0x4C48
+LOG_BLOCK_RAW = 1
+LOG_BLOCK_SERIES = 2
+LOG_BLOCK_PACKED = 3
+LOG_FLAG_UPTIME = 0x01
+HEADER = struct.Struct("<HBBHHII") # magic, type, flags, count, length, seq, crc
+RECORD = struct.Struct("<IHBBi") # time s, ms, signal, zone, value milli-units
+SEGMENT = struct.Struct("<HH") # count, length of one series in a packed block
+TIME_WIDTHS = (7, 9, 12, 32) # series_codec.h
+VALUE_WIDTHS = (6, 12, 20, 32)
+SIGNAL_NAMES = ["ph", "ec", "water_temp", "air_temp", "co2", "light", "level"] # AlertSignal order
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def get(self, width):
+        bits = 0
+        for _ in range(width):
+            byte = self.data[self.pos >> 3] if (self.pos >> 3) < len(self.data) else 0
+            bits = (bits << 1) | ((byte >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return bits
+
+    def field(self, widths):
+        ones = 0
+        while ones < 4 and self.get(1): ones += 1
+        return self.get(widths[ones - 1]) if ones else 0
+
+def unzigzag(u):
+    return (u >> 1) ^ -(u & 1)
+
+def to_int32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+def decode_series(payload, count):
+    """Yields (time_ms, signal, zone, value) from one series: first record, then bit-packed samples."""
+    t, ms, signal, zone, value = RECORD.unpack_from(payload)
+    time_ms, delta = t * 1000 + ms, 0
+    yield time_ms, signal, zone, value
+    bits = BitReader(payload[RECORD.size:])
+    for _ in range(count - 1):
+        delta = to_int32(delta + unzigzag(bits.field(TIME_WIDTHS)))
+        value = to_int32(value + unzigzag(bits.field(VALUE_WIDTHS)))
+        time_ms += delta
+        yield time_ms, signal, zone, value
+
+def decode_block(block):
+    """Yields (time_ms, signal, zone, value) from one 512-byte block; raises ValueError if it is not valid."""
+    magic, btype, flags, count, length, seq, crc = HEADER.unpack_from(block)
+    if magic != LOG_MAGIC: raise ValueError("bad magic")
+    if zlib.crc32(block[:12] + b"\0\0\0\0" + block[16:]) != crc: raise ValueError(f"bad CRC in block {seq}")
+    payload = block[HEADER.size:HEADER.size + length]
+    if btype == LOG_BLOCK_RAW:
+        for i in range(count):
+            t, ms, signal, zone, value = RECORD.unpack_from(payload, i * RECORD.size)
+            yield t * 1000 + ms, signal, zone, value
+    elif btype == LOG_BLOCK_SERIES:
+        yield from decode_series(payload, count)
+    elif btype == LOG_BLOCK_PACKED:
+        offset = 0
+        while offset + SEGMENT.size <= len(payload):
+            seg_count, seg_length = SEGMENT.unpack_from(payload, offset)
+            offset += SEGMENT.size
+            if seg_length < RECORD.size or offset + seg_length > len(payload): raise ValueError(f"bad segment in block {seq}")
+            yield from decode_series(payload[offset:offset + seg_length], seg_count)
+            offset += seg_length
+    else: raise ValueError(f"unknown block type {btype}")
+
+def read_log(path, stats=None):
+    """Yields (time_s, uptime, signal, zone, value) from a log file, skipping torn or corrupt blocks."""
+    with open(path, "rb") as f: data = f.read()
+    for offset in range(0, len(data) - LOG_BLOCK_SIZE + 1, LOG_BLOCK_SIZE):
+        block = data[offset:offset + LOG_BLOCK_SIZE]
+        uptime = bool(block[3] & LOG_FLAG_UPTIME)
+        try: samples = list(decode_block(block))
+        except (ValueError, struct.error):
+            if stats is not None: stats["bad_blocks"] = stats.get("bad_blocks", 0) + 1
+            continue
+        if stats is not None: stats["blocks"] = stats.get("blocks", 0) + 1
+        for time_ms, signal, zone, value in samples:
+            yield time_ms / 1000.0, uptime, signal, zone, value / 1000.0
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("usage: log_decoder.py LOGFILE.bin [...] > samples.csv", file=sys.stderr)
+        sys.exit(1)
+    print("time,uptime,signal,zone,value")
+    for path in sys.argv[1:]:
+        stats = {}
+        for t, uptime, signal, zone, value in read_log(path, stats):
+            name = SIGNAL_NAMES[signal] if signal < len(SIGNAL_NAMES) else str(signal)
+            print(f"{t:.3f},{int(uptime)},{name},{zone},{value:.3f}")
+        print(f"{path}: {stats.get('blocks', 0)} blocks, {stats.get('bad_blocks', 0)} skipped", file=sys.stderr)
@@ -1,38 +1,103 @@
 String webpage = ""; //String to save the html code
 
+// Page shell kept in flash. The stylesheet is its own resource, /style.css,
+// sent gzipped with an ETag so browsers keep it; a page is PAGE_HEADER, its
+// own content and PAGE_FOOTER. The arrays further down are PAGE_CSS and
+// PAGE_HEADER compressed: run gen_assets.py after editing either.
+static const char PAGE_CSS[] PROGMEM =
+  "body{max-width:65%;margin:0 auto;font-family:arial;font-size:100%;}"
+  "ul{list-style-type:none;padding:0;border-radius:0em;overflow:hidden;background-color:#d90707;font-size:1em;}"
+  "li{float:left;border-radius:0em;border-right:0em solid #bbb;}"
+  "li a{color:white; display: block;border-radius:0.375em;padding:0.44em 0.44em;text-decoration:none;font-size:100%}"
+  "li a:hover{background-color:#e86b6b;border-radius:0em;font-size:100%}"
+  "h1{color:white;border-radius:0em;font-size:1.5em;padding:0.2em 0.2em;background:#d90707;}"
+  "h2{color:blue;font-size:0.8em;}"
+  "h3{font-size:0.8em;}"
+  "table{font-family:arial,sans-serif;font-size:0.9em;border-collapse:collapse;width:85%;}"
+  "th,td {border:0.06em solid #dddddd;text-align:left;padding:0.3em;border-bottom:0.06em solid #dddddd;}"
+  "tr:nth-child(odd) {background-color:#eeeeee;}"
+  ".rcorners_n {border-radius:0.5em;background:#558ED5;padding:0.3em 0.3em;width:20%;color:white;font-size:75%;}"
+  ".rcorners_m {border-radius:0.5em;background:#558ED5;padding:0.3em 0.3em;width:50%;color:white;font-size:75%;}"
+  ".rcorners_w {border-radius:0.5em;background:#558ED5;padding:0.3em 0.3em;width:70%;color:white;font-size:75%;}"
+  ".column{float:left;width:50%;height:45%;}"
+  ".row:after{content:'';display:table;clear:both;}"
+  "*{box-sizing:border-box;}"
+  "a{font-size:75%;}"
+  "p{font-size:75%;}";
+
+static const char PAGE_HEADER[] PROGMEM =
+  "<!DOCTYPE html><html>"
+  "<head>"
+  "<title>MC Server</title>" // NOTE: 1em = 16px
+  "<meta name='viewport' content='user-scalable=yes,initial-scale=1.0,width=device-width'>"
+  "<link rel='stylesheet' href='/style.css'>"
+  "</head><body><h1>My Circuits</h1>"
+  "<ul>"
+  "<li><a href='/'>Files</a></li>" //Menu bar with commands
+  "<li><a href='/upload'>Configuration</a></li>"
+  "</ul>";
+
+static const char PAGE_FOOTER[] PROGMEM = "</body></html>";
+
+// gen_assets.py output
+static const uint8_t PAGE_CSS_GZ[] PROGMEM = { // 1266 bytes of CSS
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x54, 0xdd, 0x6e, 0x9b, 0x30,
+  0x14, 0x7e, 0x15, 0xa4, 0xaa, 0xea, 0x36, 0x15, 0x44, 0x93, 0x10, 0x52, 0xfb, 0xb6, 0x7b, 0x8e,
+  0xc9, 0xc6, 0x06, 0x5b, 0x35, 0x36, 0xb2, 0x0f, 0x4d, 0x18, 0xe2, 0xdd, 0x67, 0xf0, 0x12, 0x02,
+  0x89, 0xba, 0x5d, 0xd4, 0x37, 0xa0, 0x83, 0xcf, 0xf7, 0x73, 0x7e, 0xa0, 0x86, 0x75, 0x7d, 0x4d,
+  0x4e, 0xf1, 0x51, 0x32, 0x10, 0x68, 0x9f, 0x3d, 0xe2, 0x9a, 0xd8, 0x4a, 0x6a, 0x94, 0x46, 0xa4,
+  0x05, 0x83, 0x4b, 0xa3, 0x21, 0x2e, 0x49, 0x2d, 0x55, 0x87, 0x88, 0x95, 0x44, 0x85, 0x88, 0x93,
+  0xbf, 0x39, 0x7a, 0x49, 0xd3, 0x47, 0x3c, 0xb4, 0xaa, 0x57, 0xd2, 0xf9, 0x10, 0x74, 0x8a, 0xc7,
+  0xd0, 0x35, 0x1c, 0x69, 0xa3, 0x39, 0x6e, 0x08, 0x63, 0x52, 0x57, 0x28, 0xc5, 0xd4, 0x58, 0xc6,
+  0x6d, 0x6c, 0x09, 0x93, 0xad, 0x43, 0x29, 0xaf, 0xb1, 0xf9, 0xe0, 0xb6, 0x54, 0xe6, 0x88, 0x84,
+  0x64, 0x8c, 0x6b, 0x4c, 0x49, 0xf1, 0x5e, 0x59, 0xd3, 0x6a, 0x16, 0x17, 0x46, 0x19, 0x8b, 0x1e,
+  0xd8, 0x6b, 0x9a, 0xa7, 0xf9, 0x35, 0x99, 0x4f, 0x1b, 0x94, 0xec, 0x7d, 0x1a, 0x01, 0xa4, 0x78,
+  0x09, 0x77, 0x70, 0xcf, 0x11, 0x59, 0x09, 0x18, 0x03, 0x91, 0x33, 0x4a, 0xb2, 0xe8, 0x81, 0x52,
+  0x3a, 0x26, 0x47, 0xa4, 0x0f, 0xf0, 0x47, 0x21, 0x81, 0xe3, 0x88, 0x49, 0xd7, 0x28, 0xd2, 0xa1,
+  0x88, 0x2a, 0x53, 0xbc, 0xaf, 0xf1, 0x92, 0x6d, 0x9e, 0x79, 0xcc, 0x8b, 0x8f, 0x64, 0xb7, 0xf3,
+  0x88, 0xe1, 0x81, 0x81, 0x9f, 0x20, 0x66, 0xbc, 0x30, 0x96, 0x80, 0x34, 0x3a, 0x58, 0x5e, 0x96,
+  0x66, 0x22, 0x44, 0x62, 0xf4, 0xda, 0xdf, 0x1a, 0xe4, 0x87, 0x3d, 0xdd, 0xd3, 0x3b, 0x1e, 0x56,
+  0x20, 0xe2, 0x65, 0xa1, 0xf9, 0xd3, 0xfb, 0xc9, 0x52, 0xef, 0x66, 0x92, 0xbb, 0x19, 0xeb, 0x72,
+  0xa1, 0xbf, 0x54, 0x76, 0x10, 0x9b, 0xbf, 0xc0, 0x54, 0xb5, 0xd7, 0xd2, 0xd3, 0xe4, 0x30, 0x96,
+  0x5a, 0x6c, 0xfb, 0x9b, 0x18, 0x10, 0xaa, 0x78, 0x7f, 0x33, 0x12, 0xcf, 0x8e, 0x68, 0x17, 0x3b,
+  0x6e, 0x65, 0xb9, 0xc0, 0x79, 0x9d, 0x3b, 0xe2, 0x99, 0x14, 0x69, 0x1c, 0x47, 0xe7, 0x17, 0x1c,
+  0x06, 0xee, 0xe0, 0x07, 0x6e, 0x00, 0xf1, 0x0c, 0x2c, 0xea, 0xc3, 0x55, 0x9f, 0x97, 0xee, 0xe7,
+  0xce, 0xb1, 0xe9, 0x84, 0x72, 0x13, 0x25, 0x2b, 0x1d, 0x5a, 0x3f, 0x9b, 0xdc, 0xce, 0x24, 0xd4,
+  0x00, 0x98, 0xfa, 0x3e, 0xc0, 0x00, 0x16, 0x69, 0x10, 0x71, 0x21, 0xa4, 0x62, 0xdf, 0x0c, 0x63,
+  0xdf, 0xa3, 0x7b, 0x4d, 0x99, 0x0e, 0x1e, 0x12, 0xeb, 0x1b, 0xab, 0xb9, 0x75, 0xbf, 0xf4, 0x59,
+  0xd7, 0x3c, 0x16, 0xd9, 0xaa, 0xa0, 0x59, 0x76, 0xf8, 0xf9, 0x96, 0x2d, 0x25, 0x45, 0x41, 0x58,
+  0x30, 0xb9, 0xf1, 0x6b, 0x72, 0xdd, 0xc3, 0xb9, 0x46, 0xf9, 0x68, 0x7f, 0x26, 0xab, 0xbf, 0x80,
+  0x2c, 0xfb, 0x5f, 0xb2, 0xe3, 0x17, 0x90, 0xe5, 0xff, 0x20, 0xf3, 0xdf, 0xda, 0x5a, 0x5f, 0xef,
+  0xec, 0x2c, 0x52, 0xf0, 0x69, 0x4b, 0x77, 0x41, 0x95, 0xff, 0x17, 0x90, 0x12, 0xfc, 0xa6, 0x14,
+  0x1e, 0x82, 0x6b, 0x40, 0x4f, 0x4f, 0xf8, 0xbc, 0x9e, 0xd3, 0xd8, 0xe1, 0x42, 0x71, 0xe2, 0x87,
+  0xd5, 0x80, 0xc0, 0xc3, 0x0f, 0x2f, 0xfd, 0x34, 0x12, 0x8d, 0xb2, 0x2e, 0xdd, 0x3f, 0xe1, 0x81,
+  0xf4, 0x2b, 0x09, 0xcd, 0x3a, 0xf0, 0x07, 0xc4, 0xf7, 0xd4, 0x63, 0xf2, 0x04, 0x00, 0x00
+};
+#define PAGE_CSS_CRC 0x63d4f7c4UL
+static const uint8_t PAGE_HEADER_DEFLATE[] PROGMEM = { // 295 bytes of HTML
+  0x54, 0x8e, 0x3d, 0x4f, 0xc3, 0x30, 0x10, 0x86, 0xff, 0x8a, 0x99, 0xbc, 0xb4, 0x0d, 0xd9, 0x6d,
+  0x2f, 0x01, 0xb6, 0x0a, 0xa4, 0x76, 0x61, 0xbc, 0xda, 0x57, 0x72, 0xea, 0xc5, 0xae, 0xec, 0x73,
+  0xaa, 0xfc, 0x7b, 0xdc, 0x14, 0x84, 0x58, 0x4e, 0xba, 0xf7, 0xe3, 0xd1, 0x6b, 0x9e, 0x5e, 0xde,
+  0x87, 0xe3, 0xe7, 0xc7, 0xab, 0x1a, 0x65, 0x62, 0x67, 0x7e, 0x2e, 0x42, 0x70, 0x46, 0x48, 0x18,
+  0xdd, 0x7e, 0x50, 0x07, 0xcc, 0x33, 0x66, 0xd3, 0x3d, 0x04, 0x33, 0xa1, 0x80, 0x8a, 0x30, 0xa1,
+  0xd5, 0x33, 0xe1, 0xed, 0x9a, 0xb2, 0x68, 0xe5, 0x53, 0x14, 0x8c, 0x62, 0x75, 0x2d, 0x98, 0xb7,
+  0xc5, 0x03, 0xc3, 0x89, 0xd1, 0x2e, 0x58, 0x36, 0x14, 0x49, 0x08, 0x78, 0x15, 0xd1, 0xf6, 0xbb,
+  0xe7, 0xcd, 0x8d, 0x82, 0x8c, 0x36, 0xe0, 0x4c, 0x1e, 0xb7, 0xeb, 0xa3, 0x9d, 0x61, 0x8a, 0x17,
+  0x95, 0x91, 0xad, 0x2e, 0xb2, 0x30, 0x96, 0x11, 0xb1, 0x71, 0xc7, 0x8c, 0x67, 0xab, 0xbb, 0x55,
+  0xda, 0xf9, 0x52, 0x5a, 0xb0, 0x7b, 0xcc, 0x3b, 0xa5, 0xb0, 0xb4, 0xa9, 0xbd, 0xdb, 0x2f, 0x6a,
+  0xa0, 0xec, 0x2b, 0x49, 0x69, 0x5e, 0xef, 0x4c, 0xe5, 0x3b, 0xcd, 0x19, 0xf8, 0x6d, 0x6b, 0xf7,
+  0x46, 0x8d, 0x68, 0x3a, 0x68, 0xed, 0xbb, 0xf3, 0xcf, 0xad, 0x57, 0x4e, 0x10, 0xb4, 0x1b, 0x52,
+  0x3c, 0xd3, 0x57, 0xcd, 0x20, 0x94, 0xe2, 0x5f, 0xb6, 0x6b, 0xb8, 0x6f, 0x00, 0x00, 0x00, 0xff,
+  0xff
+};
+#define PAGE_HEADER_CRC 0xa693dd3dUL
+// end of gen_assets.py output
+
 void append_page_header() {
-  webpage  = F("<!DOCTYPE html><html>");
-  webpage += F("<head>");
-  webpage += F("<title>MC Server</title>"); // NOTE: 1em = 16px
-  webpage += F("<meta name='viewport' content='user-scalable=yes,initial-scale=1.0,width=device-width'>");
-  webpage += F("<style>");//From here style:
-  webpage += F("body{max-width:65%;margin:0 auto;font-family:arial;font-size:100%;}");
-  webpage += F("ul{list-style-type:none;padding:0;border-radius:0em;overflow:hidden;background-color:#d90707;font-size:1em;}");
-  webpage += F("li{float:left;border-radius:0em;border-right:0em solid #bbb;}");
-  webpage += F("li a{color:white; display: block;border-radius:0.375em;padding:0.44em 0.44em;text-decoration:none;font-size:100%}");
-  webpage += F("li a:hover{background-color:#e86b6b;border-radius:0em;font-size:100%}");
-  webpage += F("h1{color:white;border-radius:0em;font-size:1.5em;padding:0.2em 0.2em;background:#d90707;}");
-  webpage += F("h2{color:blue;font-size:0.8em;}");
-  webpage += F("h3{font-size:0.8em;}");
-  webpage += F("table{font-family:arial,sans-serif;font-size:0.9em;border-collapse:collapse;width:85%;}"); 
-  webpage += F("th,td {border:0.06em solid #dddddd;text-align:left;padding:0.3em;border-bottom:0.06em solid #dddddd;}"); 
-  webpage += F("tr:nth-child(odd) {background-color:#eeeeee;}");
-  webpage += F(".rcorners_n {border-radius:0.5em;background:#558ED5;padding:0.3em 0.3em;width:20%;color:white;font-size:75%;}");
-  webpage += F(".rcorners_m {border-radius:0.5em;background:#558ED5;padding:0.3em 0.3em;width:50%;color:white;font-size:75%;}");
-  webpage += F(".rcorners_w {border-radius:0.5em;background:#558ED5;padding:0.3em 0.3em;width:70%;color:white;font-size:75%;}");
-  webpage += F(".column{float:left;width:50%;height:45%;}");
-  webpage += F(".row:after{content:'';display:table;clear:both;}");
-  webpage += F("*{box-sizing:border-box;}");
-  webpage += F("a{font-size:75%;}");
-  webpage += F("p{font-size:75%;}");
-  webpage += F("</style></head><body><h1>My Circuits</h1>");
-  webpage += F("<ul>");
-  webpage += F("<li><a href='/'>Files</a></li>"); //Menu bar with commands
-  webpage += F("<li><a href='/upload'>Configuration</a></li>"); 
-  webpage += F("</ul>");
+  webpage = FPSTR(PAGE_HEADER);
 }
 //Saves repeating many lines of code for HTML page footers
 void append_page_footer()
-{ 
-  webpage += F("</body></html>");
+{
+  webpage += FPSTR(PAGE_FOOTER);
 }
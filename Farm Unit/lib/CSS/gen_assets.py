@@ -0,0 +1,65 @@
+# gen_assets.py - compresses the page shell in CSS.h for flash
+#   python3 gen_assets.py [--check]
+# PAGE_CSS becomes PAGE_CSS_GZ, a whole gzip file sent as is for /style.css.
+# PAGE_HEADER becomes PAGE_HEADER_DEFLATE, deflate blocks ending on a byte
+# boundary and not final, which a gzip page body starts with before the
+# firmware compresses the rest (GzipStream::writeDeflated).
+import gzip
+import os
+import sys
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+HEADERS = [os.path.join(HERE, "CSS.h"), os.path.join(HERE, "..", "CSS.h")] # lib/CSS.h is a copy
+BEGIN = "// gen_assets.py output\n"
+END = "// end of gen_assets.py output\n"
+
+def c_string(source, name):
+    """The text of a string constant spelled as adjacent literals."""
+    at = source.index(name + "[] PROGMEM =") + len(name) + len("[] PROGMEM =")
+    out, i = [], at
+    while source[i] != ";":
+        if source.startswith("//", i):
+            i = source.index("\n", i)
+        elif source[i] == '"':
+            i += 1
+            while source[i] != '"':
+                if source[i] == "\\":
+                    i += 1
+                    out.append({"n": "\n", "t": "\t"}.get(source[i], source[i]))
+                else:
+                    out.append(source[i])
+                i += 1
+            i += 1
+        else:
+            i += 1
+    return "".join(out).encode()
+
+def c_array(name, data, comment):
+    rows = [", ".join("0x%02x" % b for b in data[i:i + 16]) for i in range(0, len(data), 16)]
+    return "static const uint8_t %s[] PROGMEM = { // %s\n  %s\n};\n" % (name, comment, ",\n  ".join(rows))
+
+def generate(source):
+    css = c_string(source, "PAGE_CSS")
+    header = c_string(source, "PAGE_HEADER")
+    packer = zlib.compressobj(9, zlib.DEFLATED, -15)
+    deflated = packer.compress(header) + packer.flush(zlib.Z_SYNC_FLUSH)
+    return (c_array("PAGE_CSS_GZ", gzip.compress(css, 9, mtime=0), "%d bytes of CSS" % len(css)) +
+            "#define PAGE_CSS_CRC 0x%08xUL\n" % zlib.crc32(css) +
+            c_array("PAGE_HEADER_DEFLATE", deflated, "%d bytes of HTML" % len(header)) +
+            "#define PAGE_HEADER_CRC 0x%08xUL\n" % zlib.crc32(header))
+
+if __name__ == "__main__":
+    check = "--check" in sys.argv
+    stale = False
+    for path in HEADERS:
+        with open(path) as f: source = f.read()
+        start, end = source.index(BEGIN) + len(BEGIN), source.index(END)
+        updated = source[:start] + generate(source) + source[end:]
+        if updated == source: continue
+        stale = True
+        if check: print(f"{path}: compressed assets out of date", file=sys.stderr)
+        else:
+            with open(path, "w") as f: f.write(updated)
+            print(f"{path}: updated")
+    sys.exit(1 if check and stale else 0)
@@ -42,7 +42,7 @@ DFRobot_ESP_EC::~DFRobot_ESP_EC()
 {
 }
 
-void DFRobot_ESP_EC::begin(int EepromStartAddress)
+void DFRobot_ESP_EC::begin(int EepromStartAddress, int TableStartAddress)
 {
     this->_eepromStartAddress = EepromStartAddress;
     //check if calibration values (kvalueLow and kvalueHigh) are stored in eeprom
@@ -62,6 +62,8 @@ void DFRobot_ESP_EC::begin(int EepromStartAddress)
         EEPROM.commit();
     }
     this->_kvalue = this->_kvalueLow; // set default K value: K = kvalueLow
+    this->_tableStartAddress = TableStartAddress;
+    this->_curve.load(this->_tableStartAddress); // no table stored: keep the two K values
 }
 
 float DFRobot_ESP_EC::readEC(float voltage, float temperature)
@@ -71,19 +73,26 @@ float DFRobot_ESP_EC::readEC(float voltage, float temperature)
     #if DEBUG_EC 
     Serial.print(F(">>>rawEC: "));
     #endif
-    valueTemp = this->_rawEC * this->_kvalue;
-    //automatic shift process
-    //First Range:(0,2); Second Range:(2,20)
-    if (valueTemp > 2.5)
+    if (this->_curve.ready())
     {
-        this->_kvalue = this->_kvalueHigh;
+        value = this->_curve.evaluate(this->_rawEC); //precomputed segment table, no range switch
     }
-    else if (valueTemp < 2.0)
+    else
     {
-        this->_kvalue = this->_kvalueLow;
-    }
+        valueTemp = this->_rawEC * this->_kvalue;
+        //automatic shift process
+        //First Range:(0,2); Second Range:(2,20)
+        if (valueTemp > 2.5)
+        {
+            this->_kvalue = this->_kvalueHigh;
+        }
+        else if (valueTemp < 2.0)
+        {
+            this->_kvalue = this->_kvalueLow;
+        }
 
-    value = this->_rawEC * this->_kvalue;                  //calculate the EC value after automatic shift
+        value = this->_rawEC * this->_kvalue;                  //calculate the EC value after automatic shift
+    }
     value = value / (1.0 + 0.0185 * (temperature - 25.0)); //temperature compensation
     this->_ecvalue = value;                                //store the EC value for Serial CMD calibration
     #if DEBUG_EC 
@@ -94,6 +103,57 @@ float DFRobot_ESP_EC::readEC(float voltage, float temperature)
     return this->_ecvalue;
 }
 
+void DFRobot_ESP_EC::startCalibration()
+{
+    this->_pendingCurve.clear();
+}
+
+bool DFRobot_ESP_EC::addCalibrationPoint(float voltage, float temperature, float solutionEC)
+{
+    float rawEC = 1000 * voltage / RES2 / ECREF;
+    float compECsolution = solutionEC * (1.0 + 0.0185 * (temperature - 25.0)); //temperature compensation
+    if (rawEC <= 0)
+    {
+        return false;
+    }
+    //keep the K values in step so the legacy path stays usable
+    if (solutionEC < 2.0)
+    {
+        this->_kvalueLow = compECsolution / rawEC;
+    }
+    else
+    {
+        this->_kvalueHigh = compECsolution / rawEC;
+    }
+    return this->_pendingCurve.addPoint(rawEC, compECsolution);
+}
+
+bool DFRobot_ESP_EC::saveCalibration(byte mode)
+{
+    EEPROM.writeFloat(this->_eepromStartAddress, this->_kvalueLow);
+    EEPROM.writeFloat(this->_eepromStartAddress + (int)sizeof(float), this->_kvalueHigh);
+    CalibrationCurve curve = this->_pendingCurve;
+    if (curve.size() < 2 && this->_curve.ready())
+    {
+        //a single buffer only moves its own point of the active table
+        curve = this->_curve;
+        mode = curve.mode();
+        for (byte i = 0; i < this->_pendingCurve.size(); i++)
+        {
+            curve.addPoint(this->_pendingCurve.pointX(i), this->_pendingCurve.pointY(i));
+        }
+    }
+    bool built = curve.build(mode);
+    if (built)
+    {
+        this->_curve = curve;
+        this->_curve.save(this->_tableStartAddress);
+    }
+    EEPROM.commit();
+    this->_pendingCurve.clear();
+    return built;
+}
+
 void DFRobot_ESP_EC::calibration(float voltage, float temperature, char *cmd)
 {
     this->_voltage = voltage;
@@ -183,10 +243,11 @@ void DFRobot_ESP_EC::ecCalibration(byte mode)
     case 1:
         enterCalibrationFlag = 1;
         ecCalibrationFinish = 0;
+        this->startCalibration();
         Serial.println();
         Serial.println(F(">>>Enter EC Calibration Mode<<<"));
         Serial.println(F(">>>Please put the probe into the 1413us/cm or 2.76ms/cm or 12.88ms/cm buffer solution<<<"));
-        Serial.println(F(">>>Only need two point for calibration one low (1413us/com) and one high(2.76ms/cm or 12.88ms/cm)<<<"));
+        Serial.println(F(">>>Two points are enough (1413us/cm and 2.76ms/cm or 12.88ms/cm), each extra buffer refines the curve<<<"));
         Serial.println();
         break;
 
@@ -273,6 +334,7 @@ void DFRobot_ESP_EC::ecCalibration(byte mode)
                     Serial.print(this->_kvalueHigh);
                     Serial.println(F("<<<"));
                 }
+                this->_pendingCurve.addPoint(this->_rawEC, compECsolution);
                 ecCalibrationFinish = 1;
             }
             else
@@ -292,23 +354,9 @@ void DFRobot_ESP_EC::ecCalibration(byte mode)
         if (enterCalibrationFlag)
         {
             Serial.println();
-            if (ecCalibrationFinish)
+            if (ecCalibrationFinish || this->_pendingCurve.size() > 0)
             {
-                if ((this->_rawEC > RAWEC_1413_LOW) && (this->_rawEC < RAWEC_1413_HIGH))
-                {
-                    EEPROM.writeFloat(this->_eepromStartAddress, this->_kvalueLow);
-                    EEPROM.commit();
-                }
-                else if ((this->_rawEC > RAWEC_276_LOW) && (this->_rawEC < RAWEC_276_HIGH))
-                {
-                    EEPROM.writeFloat(this->_eepromStartAddress + (int)sizeof(float), this->_kvalueHigh);
-                    EEPROM.commit();
-                }
-                else if ((this->_rawEC > RAWEC_1288_LOW) && (this->_rawEC < RAWEC_1288_HIGH))
-                {
-                    EEPROM.writeFloat(this->_eepromStartAddress + (int)sizeof(float), this->_kvalueHigh);
-                    EEPROM.commit();
-                }
+                this->saveCalibration(); // K values always, the table once enough points exist
                 Serial.print(F(">>>Calibration Successful"));
             }
             else
@@ -22,8 +22,10 @@
 #define _DFROBOT_ESP_EC_H_
 
 #include "Arduino.h"
+#include "calibration_curve.h"
 
 #define KVALUEADDR 10 //the start address of the K value stored in the EEPROM
+#define ECTABLEADDR 100 //the start address of the multi-point EC calibration table stored in the EEPROM
 #define RAWEC_1413_LOW 0.70
 #define RAWEC_1413_HIGH 1.80
 #define RAWEC_276_LOW 1.95
@@ -41,7 +43,13 @@ public:
     void calibration(float voltage, float temperature, char *cmd); //calibration by Serial CMD
     void calibration(float voltage, float temperature);
     float readEC(float voltage, float temperature); // voltage to EC value, with temperature compensation
-    void begin(int EepromStartAddress = KVALUEADDR);                                   //initialization
+    void begin(int EepromStartAddress = KVALUEADDR, int TableStartAddress = ECTABLEADDR); //initialization
+
+    // N-point calibration: collect buffer points, then save to rebuild the curve table
+    void startCalibration();
+    bool addCalibrationPoint(float voltage, float temperature, float solutionEC);
+    bool saveCalibration(byte mode = CAL_CURVE_MONOTONE);
+    byte calibrationPoints() { return this->_pendingCurve.size(); }
 
 private:
     float _ecvalue;
@@ -51,12 +59,15 @@ private:
     float  _voltage;
     float  _temperature;
     float  _rawEC;
+    CalibrationCurve _curve;        // active rawEC -> EC table, replaces the K range switch when ready
+    CalibrationCurve _pendingCurve; // points collected during calibration
 
     char _cmdReceivedBuffer[ReceivedBufferLength]; //store the Serial CMD
     byte _cmdReceivedBufferIndex;
 
 private:
     int _eepromStartAddress;
+    int _tableStartAddress;
     boolean cmdSerialDataAvailable();
     void    ecCalibration(byte mode); // calibration process, wirte key parameters to EEPROM
     byte cmdParse(const char *cmd);
@@ -38,7 +38,7 @@ DFRobot_ESP_PH_WITH_ADC::~DFRobot_ESP_PH_WITH_ADC()
 {
 }
 
-void DFRobot_ESP_PH_WITH_ADC::begin(int EepromStartAddress)
+void DFRobot_ESP_PH_WITH_ADC::begin(int EepromStartAddress, int TableStartAddress)
 {
     this->_eepromStartAddress = EepromStartAddress;
     //check if calibration values (neutral and acid) are stored in eeprom
@@ -57,21 +57,35 @@ void DFRobot_ESP_PH_WITH_ADC::begin(int EepromStartAddress)
         EEPROM.writeFloat(this->_eepromStartAddress + (int)sizeof(float), this->_acidVoltage);
         EEPROM.commit();
     }
+
+    this->_tableStartAddress = TableStartAddress;
+    //multi-point table if one was saved, otherwise the legacy neutral/acid pair
+    if (!this->_curve.load(this->_tableStartAddress))
+    {
+        this->seedCurve();
+    }
+}
+
+void DFRobot_ESP_PH_WITH_ADC::seedCurve()
+{
+    this->_curve.clear();
+    this->_curve.addPoint(this->_neutralVoltage, 7.0);
+    this->_curve.addPoint(this->_acidVoltage, 4.0);
+    this->_curve.build(CAL_CURVE_LINEAR); // same line as the original two point formula
 }
 
 float DFRobot_ESP_PH_WITH_ADC::readPH(float voltage, float temperature)
 {
-    // Serial.print("[readPH]... _neutraVoltage:");
-    // Serial.print(this->_neutralVoltage);
-    // Serial.print(", _acidVoltage:");
-    // Serial.print(this->_acidVoltage);
-    float slope = (7.0 - 4.0) / ((this->_neutralVoltage - PH_7_AT_25) / 3.0 - (this->_acidVoltage - PH_7_AT_25) / 3.0); // two point: (_neutralVoltage,7.0),(_acidVoltage,4.0)
-    float intercept = 7.0 - slope * (this->_neutralVoltage - PH_7_AT_25) / 3.0;
-    // Serial.print(", slope:");
-    // Serial.print(slope);
-    // Serial.print(", intercept:");
-    // Serial.println(intercept);
-    this->_phValue = slope * (voltage - PH_7_AT_25) / 3.0 + intercept; //y = k*x + b
+    if (this->_curve.ready())
+    {
+        this->_phValue = this->_curve.evaluate(voltage); //precomputed segment table
+    }
+    else
+    {
+        float slope = (7.0 - 4.0) / ((this->_neutralVoltage - PH_7_AT_25) / 3.0 - (this->_acidVoltage - PH_7_AT_25) / 3.0); // two point: (_neutralVoltage,7.0),(_acidVoltage,4.0)
+        float intercept = 7.0 - slope * (this->_neutralVoltage - PH_7_AT_25) / 3.0;
+        this->_phValue = slope * (voltage - PH_7_AT_25) / 3.0 + intercept; //y = k*x + b
+    }
     #if DEBUG_PH
     Serial.print(F(">>>phValue "));
     Serial.print(this->_phValue,4);
@@ -80,6 +94,50 @@ float DFRobot_ESP_PH_WITH_ADC::readPH(float voltage, float temperature)
     return this->_phValue;
 }
 
+void DFRobot_ESP_PH_WITH_ADC::startCalibration()
+{
+    this->_pendingCurve.clear();
+}
+
+bool DFRobot_ESP_PH_WITH_ADC::addCalibrationPoint(float voltage, float bufferPH)
+{
+    if (bufferPH == 7.0)
+    {
+        this->_neutralVoltage = voltage;
+    }
+    else if (bufferPH == 4.0)
+    {
+        this->_acidVoltage = voltage;
+    }
+    return this->_pendingCurve.addPoint(voltage, bufferPH);
+}
+
+bool DFRobot_ESP_PH_WITH_ADC::saveCalibration(byte mode)
+{
+    CalibrationCurve curve = this->_pendingCurve;
+    if (curve.size() < 2)
+    {
+        //a single buffer only moves its own point of the active table
+        curve = this->_curve;
+        mode = curve.mode();
+        for (byte i = 0; i < this->_pendingCurve.size(); i++)
+        {
+            curve.addPoint(this->_pendingCurve.pointX(i), this->_pendingCurve.pointY(i));
+        }
+    }
+    if (!curve.build(mode))
+    {
+        return false;
+    }
+    this->_curve = curve;
+    this->_curve.save(this->_tableStartAddress);
+    EEPROM.writeFloat(this->_eepromStartAddress, this->_neutralVoltage);
+    EEPROM.writeFloat(this->_eepromStartAddress + (int)sizeof(float), this->_acidVoltage);
+    EEPROM.commit();
+    this->_pendingCurve.clear();
+    return true;
+}
+
 void DFRobot_ESP_PH_WITH_ADC::calibration(float voltage, float temperature, char *cmd)
 {
     this->_voltage = voltage;
@@ -179,9 +237,10 @@ void DFRobot_ESP_PH_WITH_ADC::phCalibration(byte mode)
     case 1:
         enterCalibrationFlag = 1;
         phCalibrationFinish = 0;
+        this->startCalibration();
         Serial.println();
         Serial.println(F(">>>Enter PH Calibration Mode<<<"));
-        Serial.println(F(">>>Please put the probe into the 4.0 or 7.0 standard buffer solution<<<"));
+        Serial.println(F(">>>Please put the probe into the 4.0, 7.0 or 10.0 standard buffer solution<<<"));
         Serial.println();
         break;
 
@@ -194,7 +253,7 @@ void DFRobot_ESP_PH_WITH_ADC::phCalibration(byte mode)
             {
                 Serial.println();
                 Serial.print(F(">>>Buffer Solution:7.0"));
-                this->_neutralVoltage = this->_voltage;
+                this->addCalibrationPoint(this->_voltage, 7.0);
                 Serial.println(F(",Send EXITPH to Save and Exit<<<"));
                 Serial.println();
                 phCalibrationFinish = 1;
@@ -205,7 +264,18 @@ void DFRobot_ESP_PH_WITH_ADC::phCalibration(byte mode)
             {
                 Serial.println();
                 Serial.print(F(">>>Buffer Solution:4.0"));
-                this->_acidVoltage = this->_voltage;
+                this->addCalibrationPoint(this->_voltage, 4.0);
+                Serial.println(F(",Send EXITPH to Save and Exit<<<"));
+                Serial.println();
+                phCalibrationFinish = 1;
+            }
+            //buffer solution:10.0
+            //547 to 795
+            else if ((this->_voltage > PH_VOLTAGE_ALKALINE_LOW_LIMIT) && (this->_voltage < PH_VOLTAGE_ALKALINE_HIGH_LIMIT))
+            {
+                Serial.println();
+                Serial.print(F(">>>Buffer Solution:10.0"));
+                this->addCalibrationPoint(this->_voltage, 10.0);
                 Serial.println(F(",Send EXITPH to Save and Exit<<<"));
                 Serial.println();
                 phCalibrationFinish = 1;
@@ -224,22 +294,8 @@ void DFRobot_ESP_PH_WITH_ADC::phCalibration(byte mode)
         if (enterCalibrationFlag)
         {
             Serial.println();
-            if (phCalibrationFinish)
+            if (this->_pendingCurve.size() > 0 && this->saveCalibration()) // every buffer accepted so far is kept
             {
-                // buffer solution:7.0
-                // 7795 to 1250
-                if ((this->_voltage > PH_VOLTAGE_NEUTRAL_LOW_LIMIT) && (this->_voltage < PH_VOLTAGE_NEUTRAL_HIGH_LIMIT))
-                {
-                    EEPROM.writeFloat(this->_eepromStartAddress, this->_neutralVoltage);
-                    EEPROM.commit();
-                }
-                //buffer solution:4.0
-                //1180 to 1700
-                else if ((this->_voltage > PH_VOLTAGE_ACID_LOW_LIMIT) && (this->_voltage < PH_VOLTAGE_ACID_HIGH_LIMIT))
-                {
-                    EEPROM.writeFloat(this->_eepromStartAddress + (int)sizeof(float), this->_acidVoltage);
-                    EEPROM.commit();
-                }
                 Serial.print(F(">>>Calibration Successful"));
             }
             else
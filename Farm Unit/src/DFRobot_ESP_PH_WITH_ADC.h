@@ -22,8 +22,10 @@
 #define _DFROBOT_ESP_PH_WITH_ADC_H_
 
 #include "Arduino.h"
+#include "calibration_curve.h"
 
 #define PHVALUEADDR 0 //the start address of the pH calibration parameters stored in the EEPROM
+#define PHTABLEADDR 160 //the start address of the multi-point pH calibration table stored in the EEPROM
 
 /**
  * first you need to define the raw voltage for your circuit
@@ -37,6 +39,8 @@
  */
 #define PH_VOLTAGE_ACID_OFFSET 200
 #define PH_VOLTAGE_NEUTRAL_OFFSET 200
+#define PH_VOLTAGE_ALKALINE_OFFSET 200
+#define PH_10_VOLTAGE 747 //linear culculation
 #define PH_8_VOLTAGE 995  //linear culculation
 #define PH_7_AT_25 1134   //laboratory measurement with isolation circuit, PH meter V2.0 and PH probe from DFRobot kit
 #define PH_6_VOLTAGE 1250 //linear culculation
@@ -48,6 +52,8 @@
 #define PH_VOLTAGE_NEUTRAL_HIGH_LIMIT PH_6_VOLTAGE
 #define PH_VOLTAGE_ACID_LOW_LIMIT PH_5_VOLTAGE - PH_VOLTAGE_ACID_OFFSET
 #define PH_VOLTAGE_ACID_HIGH_LIMIT PH_3_VOLTAGE
+#define PH_VOLTAGE_ALKALINE_LOW_LIMIT PH_10_VOLTAGE - PH_VOLTAGE_ALKALINE_OFFSET
+#define PH_VOLTAGE_ALKALINE_HIGH_LIMIT PH_VOLTAGE_NEUTRAL_LOW_LIMIT
 
 #define ReceivedBufferLength 10 //length of the Serial CMD buffer
 
@@ -59,7 +65,13 @@ public:
     void calibration(float voltage, float temperature, char *cmd); //calibration by Serial CMD
     void calibration(float voltage, float temperature);
     float readPH(float voltage, float temperature);   // voltage to pH value, with temperature compensation
-    void begin(int EepromStartAddress = PHVALUEADDR); //initialization
+    void begin(int EepromStartAddress = PHVALUEADDR, int TableStartAddress = PHTABLEADDR); //initialization
+
+    // N-point calibration: collect buffer points, then save to rebuild the curve table
+    void startCalibration();
+    bool addCalibrationPoint(float voltage, float bufferPH);
+    bool saveCalibration(byte mode = CAL_CURVE_MONOTONE);
+    byte calibrationPoints() { return this->_pendingCurve.size(); }
 
 private:
     float _phValue;
@@ -67,12 +79,16 @@ private:
     float _neutralVoltage;
     float _voltage;
     float _temperature;
+    CalibrationCurve _curve;        // active voltage -> pH table
+    CalibrationCurve _pendingCurve; // points collected during calibration
 
     char _cmdReceivedBuffer[ReceivedBufferLength]; //store the Serial CMD
     byte _cmdReceivedBufferIndex;
 
 private:
     int _eepromStartAddress;
+    int _tableStartAddress;
+    void seedCurve(); // two-point curve from _neutralVoltage and _acidVoltage
     boolean cmdSerialDataAvailable();
     void phCalibration(byte mode); // calibration process, wirte key parameters to EEPROM
     byte cmdParse(const char *cmd);
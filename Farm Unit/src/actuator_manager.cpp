@@ -0,0 +1,99 @@
+#include "actuator_manager.h"
+
+ActuatorManager::ActuatorManager(RelayPulse& pump, RelayPulse& ph, RelayPulse& nutrient)
+    : _runs{{pump, SRC_SCHEDULE, 0, 0, false, 0, {}},
+            {ph, SRC_SCHEDULE, 0, 0, false, 0, {}},
+            {nutrient, SRC_SCHEDULE, 0, 0, false, 0, {}}} {}
+
+void ActuatorManager::begin() {
+    for (Run& run : _runs) run.relay.begin();
+}
+
+void ActuatorManager::setExclusive(Actuator a, Actuator b) {
+    _runs[a].exclusive |= ACT_MASK(b);
+    _runs[b].exclusive |= ACT_MASK(a);
+}
+
+void ActuatorManager::setInhibit(uint8_t actuatorMask) {
+    _inhibit = actuatorMask;
+    for (uint8_t i = 0; i < ACT_COUNT; i++) {
+        if ((actuatorMask & ACT_MASK(i)) && isOn((Actuator)i) && _runs[i].owner != SRC_MANUAL) {
+            _runs[i].relay.stop();
+        }
+    }
+}
+
+ActuatorResult ActuatorManager::refuse(Run& run, ActuatorResult result) {
+    run.stats.rejected++;
+    return result;
+}
+
+ActuatorResult ActuatorManager::request(Actuator act, ActuatorSource source, uint32_t ms) {
+    Run& run = _runs[act];
+
+    if (source != SRC_MANUAL) {
+        if (_inhibit & ACT_MASK(act)) return refuse(run, ACT_INTERLOCKED);
+        for (uint8_t i = 0; i < ACT_COUNT; i++) {
+            if ((run.exclusive & ACT_MASK(i)) && isOn((Actuator)i)) return refuse(run, ACT_INTERLOCKED);
+        }
+    }
+
+    if (run.relay.active()) {
+        if (source > run.owner) {
+            // take over: the new duration counts from now, a shared pump run
+            // is only ever lengthened
+            bool shorter = run.mergeable && !run.relay.latched() && ms > 0 && ms <= run.relay.remainingMs();
+            if (shorter) run.stats.merged++;
+            else run.relay.start(ms);
+            run.owner = source;
+            run.sources |= SRC_MASK(source);
+            return ACT_STARTED;
+        }
+        if (run.mergeable && !run.relay.latched() && ms > 0) {
+            // overlapping runs become one longer run instead of an off/on cycle
+            if (ms > run.relay.remainingMs()) run.relay.start(ms);
+            run.sources |= SRC_MASK(source);
+            run.stats.merged++;
+            return ACT_MERGED;
+        }
+        return refuse(run, ACT_BUSY);
+    }
+
+    // minimum off-time protects the pumps from short cycling; automatic sources only
+    if (source < SRC_HUB && run.minOffMs > 0 && run.relay.pulses() > 0 &&
+        esp_timer_get_time() - run.relay.endedUs() < (int64_t)run.minOffMs * 1000) {
+        return refuse(run, ACT_MIN_OFF);
+    }
+
+    run.owner = source;
+    run.sources = SRC_MASK(source);
+    run.relay.start(ms);
+    run.stats.starts++;
+    return ACT_STARTED;
+}
+
+bool ActuatorManager::release(Actuator act, ActuatorSource source) {
+    Run& run = _runs[act];
+    if (!run.relay.active() || source < run.owner) return false;
+    run.relay.stop();
+    return true;
+}
+
+void ActuatorManager::stopAll() {
+    for (Run& run : _runs) run.relay.stop();
+}
+
+bool ActuatorManager::timedRunActive() const {
+    for (const Run& run : _runs) {
+        if (run.relay.active() && !run.relay.latched()) return true;
+    }
+    return false;
+}
+
+bool ActuatorManager::takeDone(Actuator act, uint8_t& sources) {
+    Run& run = _runs[act];
+    if (!run.relay.takeDone()) return false;
+    sources = run.sources;
+    run.stats.onTimeMs += (uint64_t)run.relay.actualMs();
+    return true;
+}
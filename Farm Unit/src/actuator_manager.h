@@ -0,0 +1,83 @@
+#ifndef ACTUATOR_MANAGER_H
+#define ACTUATOR_MANAGER_H
+
+#include <Arduino.h>
+#include "relay_pulse.h"
+
+enum Actuator : uint8_t {
+    ACT_WATER_PUMP = 0,
+    ACT_PH_RELAY,
+    ACT_NUTRIENT_RELAY,
+    ACT_COUNT
+};
+#define ACT_MASK(act) (1 << (act))
+
+// Who is asking, lowest priority first. A higher source takes over a run,
+// a lower one can only merge into it (mergeable actuators) or is refused.
+enum ActuatorSource : uint8_t {
+    SRC_SCHEDULE = 0,   // fixed-period runs (tStartPump, tStartPH, tStartNutrients)
+    SRC_CONTROL,        // pH / nutrient state machines
+    SRC_HUB,            // manual actuator commands from the hub
+    SRC_MANUAL,         // local Serial operator, bypasses interlocks
+    SRC_COUNT
+};
+#define SRC_MASK(src) (1 << (src))
+
+enum ActuatorResult : uint8_t {
+    ACT_STARTED,        // switched on, or taken over by a higher source
+    ACT_MERGED,         // joined the run already in progress
+    ACT_BUSY,           // a higher source owns the actuator
+    ACT_MIN_OFF,        // still inside the minimum off-time
+    ACT_INTERLOCKED     // inhibited or an exclusive partner is on
+};
+
+struct ActuatorStats {
+    uint32_t starts = 0;        // relay switch-ons
+    uint32_t merged = 0;        // requests served by a run already in progress
+    uint32_t rejected = 0;
+    uint64_t onTimeMs = 0;      // accumulated from completed runs
+};
+
+// Single owner of the relays. Every switch goes through request()/release(),
+// timed runs end from the RelayPulse timers.
+class ActuatorManager {
+public:
+    ActuatorManager(RelayPulse& pump, RelayPulse& ph, RelayPulse& nutrient);
+
+    void begin();
+    void setMinOffTime(Actuator act, uint32_t ms) { _runs[act].minOffMs = ms; }
+    void setMergeable(Actuator act, bool mergeable) { _runs[act].mergeable = mergeable; }
+    void setExclusive(Actuator a, Actuator b);   // never on at the same time
+    void setInhibit(uint8_t actuatorMask);       // blocks and stops all but SRC_MANUAL
+
+    ActuatorResult request(Actuator act, ActuatorSource source, uint32_t ms);  // ms 0: on until released
+    bool release(Actuator act, ActuatorSource source);  // off if source owns or outranks the run
+    void stopAll();
+
+    bool isOn(Actuator act) const { return _runs[act].relay.active(); }
+    bool timedRunActive() const;
+    ActuatorSource owner(Actuator act) const { return _runs[act].owner; }
+
+    // Completed run, with the mask of every source that shared it
+    bool takeDone(Actuator act, uint8_t& sources);
+
+    const RelayPulse& relay(Actuator act) const { return _runs[act].relay; }
+    const ActuatorStats& stats(Actuator act) const { return _runs[act].stats; }
+
+private:
+    struct Run {
+        RelayPulse& relay;
+        ActuatorSource owner;
+        uint8_t sources;
+        uint8_t exclusive;
+        bool mergeable;
+        uint32_t minOffMs;
+        ActuatorStats stats;
+    };
+    Run _runs[ACT_COUNT];
+    uint8_t _inhibit = 0;
+
+    ActuatorResult refuse(Run& run, ActuatorResult result);
+};
+
+#endif // ACTUATOR_MANAGER_H
@@ -0,0 +1,35 @@
+#include "adaptive_rate.h"
+
+AdaptiveRate::AdaptiveRate(uint32_t minMs, uint32_t maxMs)
+    : _minMs(minMs), _maxMs(maxMs), _periodMs(minMs) {}
+
+void AdaptiveRate::setLimits(uint32_t minMs, uint32_t maxMs) {
+    if (minMs == 0 || maxMs < minMs) return;
+    _minMs = minMs;
+    _maxMs = maxMs;
+    _periodMs = constrain(_periodMs, _minMs, _maxMs);
+}
+
+uint32_t AdaptiveRate::update(float activity) {
+    if (isnan(activity) || activity >= 1.0) {
+        _periodMs = _minMs;
+        return _periodMs;
+    }
+    if (activity < 0) activity = 0;
+    // linear between ceiling (flat) and floor (fully active)
+    uint32_t target = _maxMs - (uint32_t)((_maxMs - _minMs) * activity);
+    if (target < _periodMs) {
+        _periodMs = target;
+    } else {
+        uint32_t step = (uint32_t)(_periodMs * RATE_BACKOFF);
+        _periodMs = step < target ? step : target;
+    }
+    return _periodMs;
+}
+
+float AdaptiveRate::activity(const RunningStats& stats, float slopePerMin, float stddev) {
+    if (!stats.ready()) return 1.0;  // not enough history, stay fast
+    float a = fabs(stats.slopePerMin()) / slopePerMin;
+    float b = stats.stddev() / stddev;
+    return a > b ? a : b;
+}
@@ -0,0 +1,33 @@
+#ifndef ADAPTIVE_RATE_H
+#define ADAPTIVE_RATE_H
+
+#include <Arduino.h>
+#include "running_stats.h"
+
+#define RATE_BACKOFF 1.5   // a stable signal lengthens the period by at most this factor per update
+
+// Sampling period for one sensor stream, between a floor used while the
+// signal moves and a ceiling for when it is stable. Activity is 0 for a
+// flat signal and >= 1 when the stream should run at its floor.
+class AdaptiveRate {
+public:
+    AdaptiveRate(uint32_t minMs, uint32_t maxMs);
+
+    void setLimits(uint32_t minMs, uint32_t maxMs);
+    uint32_t minMs() const { return _minMs; }
+    uint32_t maxMs() const { return _maxMs; }
+    uint32_t periodMs() const { return _periodMs; }
+
+    // Shortens at once, lengthens gradually; returns the new period
+    uint32_t update(float activity);
+
+    // |slope| and spread of a stats window relative to what counts as active
+    static float activity(const RunningStats& stats, float slopePerMin, float stddev);
+
+private:
+    uint32_t _minMs;
+    uint32_t _maxMs;
+    uint32_t _periodMs;
+};
+
+#endif // ADAPTIVE_RATE_H
@@ -0,0 +1,158 @@
+#include "alert_engine.h"
+
+static bool takesArgument(int32_t op) {
+    return op == OP_VAL || op == OP_RATE || op == OP_CONST;
+}
+
+// Walks the program once with a depth counter: valid opcodes and signals,
+// no stack underflow or overflow, one value left at the end.
+bool AlertEngine::compile(const int32_t* code, uint8_t len, uint8_t& signals, int8_t& subject) {
+    if (len == 0 || len > ALERT_MAX_CODE) return false;
+    int depth = 0;
+    signals = 0;
+    subject = -1;
+    for (uint8_t pc = 0; pc < len; pc++) {
+        int32_t op = code[pc];
+        if (takesArgument(op)) {
+            if (pc + 1 >= len) return false;
+            int32_t arg = code[++pc];
+            if (op != OP_CONST) {
+                if (arg < 0 || arg >= SIG_COUNT) return false;
+                signals |= 1 << arg;
+                if (subject < 0) subject = arg;
+            }
+            depth++;
+        } else if (op >= OP_GT && op <= OP_OR) {
+            depth--;
+        } else if (op != OP_NOT) {
+            return false;
+        }
+        if (depth < 1 || depth > ALERT_STACK_DEPTH) return false;
+    }
+    return depth == 1 && signals != 0;
+}
+
+bool AlertEngine::run(const Rule& rule) const {
+    int32_t stack[ALERT_STACK_DEPTH];
+    int sp = 0;
+    for (uint8_t pc = 0; pc < rule.len; pc++) {
+        int32_t op = rule.code[pc];
+        switch (op) {
+            case OP_VAL:   stack[sp++] = _value[rule.code[++pc]]; break;
+            case OP_RATE:  stack[sp++] = _rate[rule.code[++pc]]; break;
+            case OP_CONST: stack[sp++] = rule.code[++pc]; break;
+            case OP_NOT:   stack[sp - 1] = !stack[sp - 1]; break;
+            default: {
+                int32_t b = stack[--sp];
+                int32_t a = stack[sp - 1];
+                switch (op) {
+                    case OP_GT:  a = a > b; break;
+                    case OP_LT:  a = a < b; break;
+                    case OP_GE:  a = a >= b; break;
+                    case OP_LE:  a = a <= b; break;
+                    case OP_AND: a = a && b; break;
+                    case OP_OR:  a = a || b; break;
+                }
+                stack[sp - 1] = a;
+                break;
+            }
+        }
+    }
+    return stack[0] != 0;
+}
+
+AlertEngine::Rule* AlertEngine::find(uint8_t id) {
+    for (Rule& rule : _rules) {
+        if (rule.used && rule.id == id) return &rule;
+    }
+    return nullptr;
+}
+
+bool AlertEngine::setRule(uint8_t id, uint16_t holdS, const int32_t* code, uint8_t len) {
+    uint8_t signals;
+    int8_t subject;
+    if (!compile(code, len, signals, subject)) return false;
+
+    Rule* rule = find(id);
+    if (rule) {
+        if (rule->active) queue(*rule, false);  // the new condition starts from scratch
+    } else {
+        for (Rule& free : _rules) {
+            if (!free.used) { rule = &free; break; }
+        }
+        if (!rule) return false;
+    }
+    rule->used = true;
+    rule->id = id;
+    rule->len = len;
+    rule->signals = signals;
+    rule->subject = subject;
+    rule->holdS = holdS;
+    rule->holding = false;
+    rule->active = false;
+    memcpy(rule->code, code, len * sizeof(int32_t));
+    return true;
+}
+
+bool AlertEngine::removeRule(uint8_t id) {
+    Rule* rule = find(id);
+    if (!rule) return false;
+    if (rule->active) queue(*rule, false);
+    rule->used = false;
+    return true;
+}
+
+uint8_t AlertEngine::ruleCount() const {
+    uint8_t n = 0;
+    for (const Rule& rule : _rules) n += rule.used;
+    return n;
+}
+
+void AlertEngine::sample(AlertSignal signal, float value, float ratePerMin, unsigned long nowMs) {
+    _value[signal] = (int32_t)lroundf(value * 1000);
+    _rate[signal] = (int32_t)lroundf(ratePerMin * 1000);
+    _seen |= 1 << signal;
+
+    for (Rule& rule : _rules) {
+        if (!rule.used || !(rule.signals & (1 << signal))) continue;
+        if ((rule.signals & _seen) != rule.signals) continue;  // an input was never sampled
+
+        if (!run(rule)) {
+            rule.holding = false;
+            if (rule.active) {
+                rule.active = false;
+                queue(rule, false);
+            }
+            continue;
+        }
+        if (!rule.holding) {
+            rule.holding = true;
+            rule.sinceMs = nowMs;
+        }
+        if (!rule.active && nowMs - rule.sinceMs >= rule.holdS * 1000UL) {
+            rule.active = true;
+            queue(rule, true);
+        }
+    }
+}
+
+void AlertEngine::queue(const Rule& rule, bool active) {
+    uint8_t next = (_head + 1) % ALERT_EVENT_QUEUE;
+    if (next == _tail) {
+        _dropped++;
+        return;
+    }
+    _events[_head] = { rule.id, active, _value[rule.subject] };
+    _head = next;
+}
+
+bool AlertEngine::peekEvent(AlertEvent& event, uint8_t index) const {
+    uint8_t queued = (_head + ALERT_EVENT_QUEUE - _tail) % ALERT_EVENT_QUEUE;
+    if (index >= queued) return false;
+    event = _events[(_tail + index) % ALERT_EVENT_QUEUE];
+    return true;
+}
+
+void AlertEngine::popEvent() {
+    if (_head != _tail) _tail = (_tail + 1) % ALERT_EVENT_QUEUE;
+}
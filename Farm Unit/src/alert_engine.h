@@ -0,0 +1,94 @@
+#ifndef ALERT_ENGINE_H
+#define ALERT_ENGINE_H
+
+#include <Arduino.h>
+
+// Inputs a rule can read. Values and constants are in milli-units
+// (pH * 1000, ms/cm * 1000, °C * 1000, ppm * 1000 ...), rates per minute.
+enum AlertSignal : uint8_t {
+    SIG_PH,
+    SIG_EC,
+    SIG_WATER_TEMP,
+    SIG_AIR_TEMP,
+    SIG_CO2,
+    SIG_LUX,
+    SIG_LEVEL,
+    SIG_COUNT
+};
+
+// Rule bytecode, postfix. VAL, RATE and CONST take the following word as
+// argument; the program must leave exactly one truth value on the stack.
+enum AlertOp : uint8_t {
+    OP_VAL = 1,     // push value of signal <arg>
+    OP_RATE,        // push rate per minute of signal <arg>
+    OP_CONST,       // push <arg>
+    OP_GT,
+    OP_LT,
+    OP_GE,
+    OP_LE,
+    OP_AND,
+    OP_OR,
+    OP_NOT
+};
+
+#define ALERT_MAX_RULES 8
+#define ALERT_MAX_CODE 16     // words per rule, arguments included
+#define ALERT_STACK_DEPTH 6
+#define ALERT_EVENT_QUEUE 8
+
+struct AlertEvent {
+    uint8_t id;
+    bool active;              // true: fired, false: cleared
+    int32_t value;            // first signal the rule reads, milli-units
+};
+
+// Hub-defined alert rules, evaluated on the device as samples arrive. A rule
+// fires once its condition held for holdS seconds and clears as soon as it
+// is false again; only these transitions are queued for the uplink.
+class AlertEngine {
+public:
+    // Checks the program and adds it, replacing a rule with the same id.
+    // Bad code leaves the rule set unchanged.
+    bool setRule(uint8_t id, uint16_t holdS, const int32_t* code, uint8_t len);
+    bool removeRule(uint8_t id);    // an active rule queues its clear event
+    uint8_t ruleCount() const;
+
+    // Re-evaluates only the rules that read this signal
+    void sample(AlertSignal signal, float value, float ratePerMin, unsigned long nowMs);
+
+    // index-th oldest transition; pop only once it is on its way
+    bool peekEvent(AlertEvent& event, uint8_t index = 0) const;
+    void popEvent();
+    bool pending() const { return _head != _tail; }
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    struct Rule {
+        bool used;
+        uint8_t id;
+        uint8_t len;
+        uint8_t signals;        // bit per AlertSignal read by the program
+        int8_t subject;         // signal reported with events
+        uint16_t holdS;
+        bool holding;           // condition true, hold time running
+        bool active;
+        unsigned long sinceMs;
+        int32_t code[ALERT_MAX_CODE];
+    };
+
+    Rule _rules[ALERT_MAX_RULES] = {};
+    int32_t _value[SIG_COUNT] = {};
+    int32_t _rate[SIG_COUNT] = {};
+    uint8_t _seen = 0;          // signals sampled at least once
+
+    AlertEvent _events[ALERT_EVENT_QUEUE];
+    uint8_t _head = 0, _tail = 0;
+    uint32_t _dropped = 0;
+
+    static bool compile(const int32_t* code, uint8_t len, uint8_t& signals, int8_t& subject);
+    bool run(const Rule& rule) const;
+    void queue(const Rule& rule, bool active);
+    Rule* find(uint8_t id);
+};
+
+#endif // ALERT_ENGINE_H
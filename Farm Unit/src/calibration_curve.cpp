@@ -0,0 +1,194 @@
+/*
+ * calibration_curve.cpp
+ *
+ * See calibration_curve.h. Monotone segments use the Fritsch-Carlson
+ * tangent limiter so the curve never overshoots between buffer points.
+ */
+
+#include "Arduino.h"
+#include "calibration_curve.h"
+#include "EEPROM.h"
+
+CalibrationCurve::CalibrationCurve()
+{
+    this->clear();
+}
+
+void CalibrationCurve::clear()
+{
+    this->_count = 0;
+    this->_mode = CAL_CURVE_LINEAR;
+    this->_ready = false;
+}
+
+bool CalibrationCurve::addPoint(float x, float y)
+{
+    if (isnan(x) || isinf(x) || isnan(y) || isinf(y))
+    {
+        return false;
+    }
+    for (byte i = 0; i < this->_count; i++)
+    {
+        if (this->_y[i] == y) // same buffer solution measured again
+        {
+            this->_x[i] = x;
+            return true;
+        }
+    }
+    if (this->_count >= CAL_CURVE_MAX_POINTS)
+    {
+        return false;
+    }
+    this->_x[this->_count] = x;
+    this->_y[this->_count] = y;
+    this->_count++;
+    return true;
+}
+
+bool CalibrationCurve::build(byte mode)
+{
+    byte n = this->_count;
+    this->_ready = false;
+    this->_mode = mode;
+    if (n < 2)
+    {
+        return false;
+    }
+
+    //insertion sort by x, n is tiny
+    for (byte i = 1; i < n; i++)
+    {
+        float x = this->_x[i], y = this->_y[i];
+        int j = i - 1;
+        while (j >= 0 && this->_x[j] > x)
+        {
+            this->_x[j + 1] = this->_x[j];
+            this->_y[j + 1] = this->_y[j];
+            j--;
+        }
+        this->_x[j + 1] = x;
+        this->_y[j + 1] = y;
+    }
+
+    float h[CAL_CURVE_MAX_POINTS], delta[CAL_CURVE_MAX_POINTS], m[CAL_CURVE_MAX_POINTS];
+    for (byte i = 0; i < n - 1; i++)
+    {
+        h[i] = this->_x[i + 1] - this->_x[i];
+        if (h[i] <= 0)
+        {
+            return false; // two buffers gave the same reading
+        }
+        delta[i] = (this->_y[i + 1] - this->_y[i]) / h[i];
+    }
+
+    //tangents: secant average inside, one-sided at the ends
+    m[0] = delta[0];
+    m[n - 1] = delta[n - 2];
+    for (byte i = 1; i < n - 1; i++)
+    {
+        m[i] = (mode == CAL_CURVE_MONOTONE && delta[i - 1] * delta[i] > 0) ? (delta[i - 1] + delta[i]) / 2.0 : 0.0;
+    }
+    if (mode == CAL_CURVE_MONOTONE)
+    {
+        for (byte i = 0; i < n - 1; i++)
+        {
+            if (delta[i] == 0)
+            {
+                m[i] = m[i + 1] = 0;
+                continue;
+            }
+            float a = m[i] / delta[i];
+            float b = m[i + 1] / delta[i];
+            float s = a * a + b * b;
+            if (s > 9.0)
+            {
+                float tau = 3.0 / sqrt(s);
+                m[i] = tau * a * delta[i];
+                m[i + 1] = tau * b * delta[i];
+            }
+        }
+    }
+
+    for (byte i = 0; i < n - 1; i++)
+    {
+        if (mode == CAL_CURVE_MONOTONE)
+        {
+            this->_b[i] = m[i];
+            this->_c[i] = (3.0 * delta[i] - 2.0 * m[i] - m[i + 1]) / h[i];
+            this->_d[i] = (m[i] + m[i + 1] - 2.0 * delta[i]) / (h[i] * h[i]);
+        }
+        else
+        {
+            this->_b[i] = delta[i];
+            this->_c[i] = 0;
+            this->_d[i] = 0;
+        }
+    }
+    //extrapolate linearly past the last point
+    this->_b[n - 1] = (mode == CAL_CURVE_MONOTONE) ? m[n - 1] : delta[n - 2];
+    this->_c[n - 1] = 0;
+    this->_d[n - 1] = 0;
+    this->_ready = true;
+    return true;
+}
+
+float CalibrationCurve::evaluate(float x) const
+{
+    if (!this->_ready)
+    {
+        return NAN;
+    }
+    if (x <= this->_x[0])
+    {
+        return this->_y[0] + (x - this->_x[0]) * this->_b[0]; //extrapolate linearly below the first point
+    }
+    byte i = 0;
+    while (i + 1 < this->_count && x >= this->_x[i + 1])
+    {
+        i++;
+    }
+    float dx = x - this->_x[i];
+    return this->_y[i] + dx * (this->_b[i] + dx * (this->_c[i] + dx * this->_d[i]));
+}
+
+bool CalibrationCurve::load(int eepromAddress)
+{
+    this->clear();
+    if (EEPROM.readByte(eepromAddress) != CAL_CURVE_MAGIC)
+    {
+        return false;
+    }
+    byte count = EEPROM.readByte(eepromAddress + 1);
+    byte mode = EEPROM.readByte(eepromAddress + 2);
+    if (count < 2 || count > CAL_CURVE_MAX_POINTS || mode > CAL_CURVE_MONOTONE)
+    {
+        return false;
+    }
+    int addr = eepromAddress + 3;
+    for (byte i = 0; i < count; i++)
+    {
+        float x = EEPROM.readFloat(addr);
+        float y = EEPROM.readFloat(addr + (int)sizeof(float));
+        addr += 2 * (int)sizeof(float);
+        if (!this->addPoint(x, y))
+        {
+            this->clear();
+            return false;
+        }
+    }
+    return this->build(mode);
+}
+
+void CalibrationCurve::save(int eepromAddress) const
+{
+    EEPROM.writeByte(eepromAddress, CAL_CURVE_MAGIC);
+    EEPROM.writeByte(eepromAddress + 1, this->_count);
+    EEPROM.writeByte(eepromAddress + 2, this->_mode);
+    int addr = eepromAddress + 3;
+    for (byte i = 0; i < this->_count; i++)
+    {
+        EEPROM.writeFloat(addr, this->_x[i]);
+        EEPROM.writeFloat(addr + (int)sizeof(float), this->_y[i]);
+        addr += 2 * (int)sizeof(float);
+    }
+}
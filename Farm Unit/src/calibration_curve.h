@@ -0,0 +1,50 @@
+/*
+ * calibration_curve.h
+ *
+ * N-point calibration curve shared by the pH and EC sensor classes.
+ * Points are collected during calibration, then precomputed once into a
+ * fixed table of segment coefficients (piecewise-linear or monotone cubic,
+ * Fritsch-Carlson) so a read costs at most CAL_CURVE_MAX_POINTS compares
+ * and one polynomial evaluation.
+ */
+
+#ifndef _CALIBRATION_CURVE_H_
+#define _CALIBRATION_CURVE_H_
+
+#include "Arduino.h"
+
+#define CAL_CURVE_MAX_POINTS 5 // e.g. pH 4/7/10 or EC 1.413/2.76/12.88 plus spares
+#define CAL_CURVE_LINEAR 0
+#define CAL_CURVE_MONOTONE 1
+#define CAL_CURVE_MAGIC 0xC5
+#define CAL_CURVE_EEPROM_SIZE (3 + CAL_CURVE_MAX_POINTS * 2 * (int)sizeof(float)) // magic, count, mode, points
+
+class CalibrationCurve
+{
+public:
+    CalibrationCurve();
+    void clear();
+    bool addPoint(float x, float y);          // a point with the same y replaces the previous one
+    bool build(byte mode = CAL_CURVE_MONOTONE); // sort points and precompute segment table
+    float evaluate(float x) const;
+    bool ready() const { return this->_ready; }
+    byte size() const { return this->_count; }
+    byte mode() const { return this->_mode; }
+    float pointX(byte i) const { return this->_x[i]; }
+    float pointY(byte i) const { return this->_y[i]; }
+    bool load(int eepromAddress);       // false if nothing valid is stored
+    void save(int eepromAddress) const; // caller commits EEPROM
+
+private:
+    float _x[CAL_CURVE_MAX_POINTS];
+    float _y[CAL_CURVE_MAX_POINTS];
+    // segment i: y = _y[i] + dx * (_b[i] + dx * (_c[i] + dx * _d[i])), dx = x - _x[i]
+    float _b[CAL_CURVE_MAX_POINTS];
+    float _c[CAL_CURVE_MAX_POINTS];
+    float _d[CAL_CURVE_MAX_POINTS];
+    byte _count;
+    byte _mode;
+    bool _ready;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "ccs811_irq.h"
+
+volatile bool CCS811Irq::_dataReady = false;
+volatile uint32_t CCS811Irq::_interrupts = 0;
+
+void IRAM_ATTR CCS811Irq::onDataReady() {
+    _dataReady = true;
+    _interrupts++;
+}
+
+bool CCS811Irq::startInterrupt(int mode) {
+    // nINT is open drain and stays low until the result registers are read
+    pinMode(_nint, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(_nint), onDataReady, FALLING);
+
+    uint8_t measMode = (uint8_t)(mode << 4) | CCS811_INT_DATARDY;
+    wake_up();
+    bool ok = i2cwrite(CCS811_REG_MEAS_MODE, 1, &measMode);
+    wake_down();
+    // a result may already be pending from before the interrupt was attached
+    if (digitalRead(_nint) == LOW) _dataReady = true;
+    return ok;
+}
+
+void CCS811Irq::pollLine() {
+    // the line stays low until the result is read, so the level is enough
+    if (digitalRead(_nint) == LOW) _dataReady = true;
+}
+
+bool CCS811Irq::setEnvironment(float temperature, float humidity) {
+    if (isnan(temperature) || isnan(humidity)) return false;
+    humidity = constrain(humidity, 0.0f, 100.0f);
+    temperature = constrain(temperature, -25.0f, 100.0f);
+    // ENV_DATA format: 1/512 steps, temperature offset by 25 °C
+    uint16_t t = (uint16_t)((temperature + 25.0f) * 512.0f + 0.5f);
+    uint16_t h = (uint16_t)(humidity * 512.0f + 0.5f);
+    return set_envdata(t, h);
+}
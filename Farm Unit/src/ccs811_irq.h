@@ -0,0 +1,33 @@
+#ifndef CCS811_IRQ_H
+#define CCS811_IRQ_H
+
+#include <Arduino.h>
+#include "ccs811.h"
+
+#define CCS811_REG_MEAS_MODE 0x01
+#define CCS811_INT_DATARDY 0x08 // MEAS_MODE bit: drive nINT low when a new result is ready
+
+// CCS811 driven by its nINT data-ready line. The library already asserts
+// nWAKE only around its own transactions; this adds the interrupt mode,
+// the data-ready flag and environmental compensation in real units.
+class CCS811Irq : public CCS811 {
+public:
+    CCS811Irq(int nwake, int nint) : CCS811(nwake), _nint(nint) {}
+
+    bool startInterrupt(int mode);          // CCS811_MODE_* with INT_DATARDY set
+    bool dataReady() const { return _dataReady; }
+    void clearDataReady() { _dataReady = false; }
+    void pollLine();                        // catch an edge missed while the chip slept
+    uint32_t interrupts() const { return _interrupts; }
+
+    // °C and %RH, written to ENV_DATA so eCO2/eTVOC use the real conditions
+    bool setEnvironment(float temperature, float humidity);
+
+private:
+    int _nint;
+    static volatile bool _dataReady;
+    static volatile uint32_t _interrupts;
+    static void IRAM_ATTR onDataReady();
+};
+
+#endif // CCS811_IRQ_H
@@ -0,0 +1,111 @@
+#include "chunked_response.h"
+#include <stdarg.h>
+
+// The compressor's window and hash heads, and printf's staging in front of it
+static GzipStream gzipStream;
+static char gzipLine[CHUNK_BUFFER_SIZE];
+
+void ChunkedResponse::begin(int code, const char* contentType, const char* extraHeaders, bool gzip) {
+    _startMs = millis();
+    char head[160];
+    snprintf(head, sizeof(head),
+             "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\nCache-Control: no-cache\r\n",
+             code, httpReason(code), contentType);
+    raw(head);
+    if (extraHeaders) raw(extraHeaders);
+    if (gzip) {
+        raw("Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n");
+        _gzip = &gzipStream;
+        _gzip->begin(_chunks);
+    }
+    raw("Connection: close\r\n\r\n");
+}
+
+size_t ChunkedResponse::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t ChunkedResponse::write(const uint8_t* data, size_t len) {
+    if (_gzip && !_failed) return _gzip->write(data, len);
+    return buffer(data, len);
+}
+
+size_t ChunkedResponse::buffer(const uint8_t* data, size_t len) {
+    if (_failed) return 0;
+    size_t done = 0;
+    while (done < len) {
+        size_t n = min(len - done, CHUNK_BUFFER_SIZE - _len);
+        memcpy(_buffer + _len, data + done, n);
+        _len += n;
+        done += n;
+        if (_len == CHUNK_BUFFER_SIZE) sendChunk();
+    }
+    return len;
+}
+
+size_t ChunkedResponse::printf(const char* format, ...) {
+    if (_gzip) {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(gzipLine, sizeof(gzipLine), format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        return write((const uint8_t*)gzipLine, min((size_t)n, sizeof(gzipLine) - 1));
+    }
+    for (uint8_t attempt = 0; attempt < 2 && !_failed; attempt++) {
+        size_t room = CHUNK_BUFFER_SIZE - _len;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf((char*)_buffer + _len, room, format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        if ((size_t)n < room) {
+            _len += n;
+            return n;
+        }
+        if (_len == 0) {  // longer than a whole chunk: cut short
+            _len = CHUNK_BUFFER_SIZE - 1;
+            return _len;
+        }
+        sendChunk();
+    }
+    return 0;
+}
+
+void ChunkedResponse::writeDeflated(const DeflatedText& text) {
+    if (_gzip && !_failed && _gzip->writeDeflated(text)) return;
+    write((const uint8_t*)text.text, text.size);
+}
+
+void ChunkedResponse::end() {
+    if (_gzip) _gzip->finish();
+    sendChunk();
+    raw("0\r\n\r\n");
+    _client.stop();
+    _doneMs = millis();
+}
+
+void ChunkedResponse::sendChunk() {
+    if (_len == 0) return;
+    char size[12];
+    snprintf(size, sizeof(size), "%X\r\n", (unsigned)_len);
+    raw(size);
+    raw(_buffer, _len);
+    raw("\r\n");
+    _sent += _len;
+    _len = 0;
+}
+
+void ChunkedResponse::raw(const uint8_t* data, size_t len) {
+    if (_failed) return;
+    if (_client.write(data, len) != len) _failed = true;
+}
+
+const char* httpReason(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        default: return "Error";
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef CHUNKED_RESPONSE_H
+#define CHUNKED_RESPONSE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "gzip_stream.h"
+
+// HTTP/1.1 response written straight to the client socket with chunked
+// transfer encoding. Whatever is printed collects in a fixed buffer and goes
+// out as one chunk each time it fills, so a page of any length costs this
+// buffer and no heap. A gzip body runs through one shared GzipStream
+// first; handlers answer one request at a time.
+#define CHUNK_BUFFER_SIZE 1024
+
+class ChunkedResponse : public Print {
+public:
+    explicit ChunkedResponse(WiFiClient client) : _client(client), _chunks(*this) {}
+
+    // Status line and headers; extraHeaders are whole "Name: value\r\n" lines
+    void begin(int code, const char* contentType, const char* extraHeaders = nullptr, bool gzip = false);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    using Print::write;
+    // Formats straight into the buffer; Print::printf allocates past 64 bytes
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    // Its deflated copy when it starts a gzip body, else the text
+    void writeDeflated(const DeflatedText& text);
+    // Last chunk, then the connection is closed
+    void end();
+
+    // False once the client went away; long loops should stop then
+    bool ok() const { return !_failed; }
+    size_t bytesSent() const { return _sent; }   // body bytes on the wire
+    uint32_t elapsedMs() const { return _doneMs - _startMs; }
+    // The body's compressor, nullptr unless begin() asked for gzip
+    const GzipStream* gzip() const { return _gzip; }
+
+private:
+    // Where the compressor's output goes: the chunk buffer
+    class Chunks : public Print {
+    public:
+        explicit Chunks(ChunkedResponse& owner) : _owner(owner) {}
+        size_t write(uint8_t c) override { return _owner.buffer(&c, 1); }
+        size_t write(const uint8_t* data, size_t len) override { return _owner.buffer(data, len); }
+        using Print::write;
+
+    private:
+        ChunkedResponse& _owner;
+    };
+
+    WiFiClient _client;
+    Chunks _chunks;
+    GzipStream* _gzip = nullptr;
+    uint8_t _buffer[CHUNK_BUFFER_SIZE];
+    size_t _len = 0;
+    size_t _sent = 0;
+    bool _failed = false;
+    unsigned long _startMs = 0;
+    unsigned long _doneMs = 0;
+
+    size_t buffer(const uint8_t* data, size_t len);
+    void sendChunk();
+    void raw(const uint8_t* data, size_t len);
+    void raw(const char* text) { raw((const uint8_t*)text, strlen(text)); }
+};
+
+const char* httpReason(int code);
+
+#endif // CHUNKED_RESPONSE_H
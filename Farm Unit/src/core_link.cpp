@@ -0,0 +1,31 @@
+#include "core_link.h"
+
+SpscQueue<RadioCommand, 4> commandQueue;
+SpscQueue<TelemetryFrame, 4> telemetryQueue;
+SpscQueue<LogLine, 32> logQueue;
+LogStream Log;
+SemaphoreHandle_t radioLock = nullptr;
+
+size_t LogStream::write(uint8_t c) {
+    if (c == '\r') return 1;
+    if (c == '\n') {
+        flushLine();
+        return 1;
+    }
+    if (_len >= LOG_LINE_LEN - 1) flushLine();  // over-long line continues on the next one
+    _line.text[_len++] = (char)c;
+    return 1;
+}
+
+void LogStream::flushLine() {
+    _line.text[_len] = '\0';
+    logQueue.push(_line);  // dropped (and counted) if the IO core falls behind
+    _len = 0;
+}
+
+void drainLog(Print& out) {
+    LogLine line;
+    while (logQueue.pop(line)) {
+        out.println(line.text);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CORE_LINK_H
+#define CORE_LINK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/semphr.h>
+
+// Lock-free single-producer/single-consumer ring. One core pushes, the other
+// pops; N must be a power of two. One slot is always kept free.
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    bool push(const T& item) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (N - 1);
+        if (next == _tail.load(std::memory_order_acquire)) {
+            _dropped++;
+            return false;  // full
+        }
+        _items[head] = item;
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) return false;  // empty
+        item = _items[tail];
+        _tail.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+    uint32_t dropped() const { return _dropped; }  // producer side only
+
+private:
+    T _items[N];
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+    uint32_t _dropped = 0;
+};
+
+// Messages between the control loop (core 1) and the radio/IO task (core 0)
+#define RADIO_MSG_LEN 256
+#define TELEMETRY_MSG_LEN 400   // RAK at+send limit is 800 hex chars
+#define LOG_LINE_LEN 120
+
+struct RadioCommand {   // core 0 -> core 1: JSON received from the hub
+    char json[RADIO_MSG_LEN];
+};
+
+struct TelemetryFrame { // core 1 -> core 0: serialized JSON to transmit
+    uint32_t seq;       // "q" in the JSON, what the hub acks
+    char json[TELEMETRY_MSG_LEN];
+};
+
+struct LogLine {        // core 1 -> core 0: one line for Serial
+    char text[LOG_LINE_LEN];
+};
+
+extern SpscQueue<RadioCommand, 4> commandQueue;
+extern SpscQueue<TelemetryFrame, 4> telemetryQueue;
+extern SpscQueue<LogLine, 32> logQueue;
+
+// Mutex the radio task holds for each pass, AT exchange included, and the
+// control loop holds from its last idle check until it is awake again, so
+// light sleep never stops the radio mid-exchange. Created in setup().
+extern SemaphoreHandle_t radioLock;
+
+// Print target for the control loop: collects a line and hands it to the IO
+// core instead of blocking on the 9600 baud UART. Use only from core 1.
+class LogStream : public Print {
+public:
+    size_t write(uint8_t c) override;
+    using Print::write;
+    uint32_t dropped() const { return logQueue.dropped(); }
+
+private:
+    LogLine _line;
+    size_t _len = 0;
+    void flushLine();
+};
+
+extern LogStream Log;
+
+// Drain queued log lines to Serial, called on core 0
+void drainLog(Print& out);
+
+#endif // CORE_LINK_H
@@ -0,0 +1,72 @@
+#include "dosing_controller.h"
+
+#define IN_BAND_SHIFT 5   // EWMA weight 1/32 per sample
+
+DosingController::DosingController(const DosingTuning& tuning)
+    : _direction(tuning.direction),
+      _kp(toQ16(tuning.kp)), _ki(toQ16(tuning.ki)), _kd(toQ16(tuning.kd)),
+      _deadband(toQ16(tuning.deadband)),
+      _minPulseMs(tuning.minPulseMs), _maxPulseMs(tuning.maxPulseMs),
+      _deadTimeMs(tuning.deadTimeMs), _stepMs(tuning.stepMs) {}
+
+void DosingController::setTarget(float target) {
+    q16_t t = toQ16(target);
+    if (t == _target) return;
+    _target = t;
+    _stepped = false;   // the old error history says nothing about the new target
+    _pendingMs = 0;
+}
+
+void DosingController::reset() {
+    _integral = 0;
+    _stepped = false;
+    _pendingMs = 0;
+    _holdUntilMs = 0;
+}
+
+bool DosingController::inBand() const {
+    return _error <= _deadband && _error >= -_deadband;
+}
+
+void DosingController::observe(float value, unsigned long nowMs, bool settled) {
+    _error = _direction * (_target - toQ16(value));
+
+    // in-band share, permille in Q16
+    uint32_t sample = inBand() ? (1000UL << Q16_SHIFT) : 0;
+    _inBand += ((int32_t)sample - (int32_t)_inBand) >> IN_BAND_SHIFT;
+
+    if ((long)(nowMs - _holdUntilMs) < 0) return;    // dead time after the last dose
+    if (!settled) return;
+    if (_stepped && nowMs - _lastStepMs < _stepMs) return;
+    step(nowMs);
+}
+
+void DosingController::step(unsigned long nowMs) {
+    q16_t e = inBand() ? 0 : _error;
+    int64_t maxQ = (int64_t)_maxPulseMs << Q16_SHIFT;
+
+    int64_t p = ((int64_t)_kp * e) >> Q16_SHIFT;
+    int64_t d = _stepped ? ((int64_t)_kd * (e - _lastStepError)) >> Q16_SHIFT : 0;
+
+    // integrate unless the output already saturates in the same direction
+    int64_t out = p + _integral + d;
+    if (!(out >= maxQ && e > 0)) {
+        int64_t i = _integral + (((int64_t)_ki * e) >> Q16_SHIFT);
+        _integral = (int32_t)constrain(i, (int64_t)0, maxQ);
+    }
+    out = constrain(p + _integral + d, (int64_t)0, maxQ);
+
+    uint32_t pulse = (uint32_t)(out >> Q16_SHIFT);
+    _pendingMs = (e > 0 && pulse >= _minPulseMs) ? pulse : 0;
+    _lastStepError = e;
+    _lastStepMs = nowMs;
+    _stepped = true;
+}
+
+void DosingController::doseStarted(uint32_t pulseMs, unsigned long nowMs) {
+    _pendingMs = 0;
+    _doses++;
+    _doseMsTotal += pulseMs;
+    _lastPulseMs = pulseMs;
+    _holdUntilMs = nowMs + pulseMs + _deadTimeMs;
+}
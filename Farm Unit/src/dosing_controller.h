@@ -0,0 +1,80 @@
+#ifndef DOSING_CONTROLLER_H
+#define DOSING_CONTROLLER_H
+
+#include <Arduino.h>
+
+// Q16.16 fixed point for measured values and errors
+typedef int32_t q16_t;
+#define Q16_SHIFT 16
+#define Q16_ONE (1L << Q16_SHIFT)
+
+enum DoseDirection : int8_t {
+    DOSE_LOWERS = -1,   // acid: a dose lowers the reading
+    DOSE_RAISES = 1     // nutrients: a dose raises the reading
+};
+
+struct DosingTuning {
+    DoseDirection direction;
+    float kp;               // ms of pulse per unit of error
+    float ki;               // ms added to the integral per unit of error and control step
+    float kd;               // ms per unit of error change between steps
+    float deadband;         // no dosing and no integration inside ±deadband
+    uint32_t minPulseMs;    // shorter requests are not worth a relay cycle
+    uint32_t maxPulseMs;
+    uint32_t deadTimeMs;    // dose to settled reading: mixing plus transport
+    uint32_t stepMs;        // minimum spacing of control steps
+};
+
+// Discrete PID for a one-sided dosing loop. One step per control period,
+// each step O(1) in fixed point; the output is a pulse width. After a dose
+// the loop holds for the dead time so it neither doses again nor winds the
+// integral up on error the previous dose has not removed yet.
+class DosingController {
+public:
+    explicit DosingController(const DosingTuning& tuning);
+
+    void setTarget(float target);
+    float target() const { return (float)_target / Q16_ONE; }
+    void reset();                               // drop integral and history, e.g. on manual mode
+
+    // Every sample; steps the controller when out of dead time, the reading
+    // has settled and a step period has passed since the last one.
+    void observe(float value, unsigned long nowMs, bool settled);
+
+    uint32_t pendingPulseMs() const { return _pendingMs; }  // 0: no dose wanted
+    void doseStarted(uint32_t pulseMs, unsigned long nowMs);
+
+    // Convergence metrics
+    float error() const { return (float)_error / Q16_ONE; }  // positive: dose needed
+    bool inBand() const;
+    uint16_t inBandPermille() const { return _inBand >> Q16_SHIFT; }
+    uint32_t doses() const { return _doses; }
+    uint32_t doseMsTotal() const { return _doseMsTotal; }
+    uint32_t lastPulseMs() const { return _lastPulseMs; }
+
+private:
+    int8_t _direction;
+    int32_t _kp, _ki, _kd;          // Q16 ms per unit
+    q16_t _deadband;
+    uint32_t _minPulseMs, _maxPulseMs;
+    uint32_t _deadTimeMs, _stepMs;
+
+    q16_t _target = 0;
+    q16_t _error = 0;               // latest error, sign so that positive asks for a dose
+    q16_t _lastStepError = 0;
+    int32_t _integral = 0;          // Q16 ms, clamped to [0, maxPulse]
+    bool _stepped = false;
+    unsigned long _lastStepMs = 0;
+    unsigned long _holdUntilMs = 0;
+    uint32_t _pendingMs = 0;
+
+    uint32_t _doses = 0;
+    uint32_t _doseMsTotal = 0;
+    uint32_t _lastPulseMs = 0;
+    uint32_t _inBand = 0;           // EWMA of in-band samples, permille in Q16
+
+    void step(unsigned long nowMs);
+    static q16_t toQ16(float v) { return (q16_t)lroundf(v * Q16_ONE); }
+};
+
+#endif // DOSING_CONTROLLER_H
@@ -0,0 +1,173 @@
+#include "frame_backlog.h"
+#include <rom/crc.h>
+
+static const char* BACKLOG_FRAMES = BACKLOG_DIR "/frames.bin";
+static const char* BACKLOG_HEAD = BACKLOG_DIR "/head";
+
+static uint32_t slotCrc(BacklogSlot& slot) {
+    uint32_t crc = slot.crc;
+    slot.crc = 0;
+    uint32_t sum = crc32_le(0, (const uint8_t*)&slot, offsetof(BacklogSlot, json) + slot.len);
+    slot.crc = crc;
+    return sum;
+}
+
+void FrameBacklog::begin(fs::FS& fs) {
+    _fs = &fs;
+    _fs->mkdir(BACKLOG_DIR);
+    _head = 0;
+    _tail = 0;
+    // Only the slots know how far the ring got: the newest intact one is the tail
+    File frames = _fs->open(BACKLOG_FRAMES, FILE_READ);
+    if (frames) {
+        uint32_t slots = min((uint32_t)(frames.size() / BACKLOG_SLOT_SIZE), (uint32_t)BACKLOG_MAX_FRAMES);
+        BacklogSlot slot;
+        for (uint32_t i = 0; i < slots; i++) {
+            if (readSlot(frames, i, slot) && slot.index % BACKLOG_MAX_FRAMES == i && slot.index >= _tail) {
+                _tail = slot.index + 1;
+            }
+        }
+        frames.close();
+    }
+    File head = _fs->open(BACKLOG_HEAD, FILE_READ);
+    if (head) {
+        head.read((uint8_t*)&_head, sizeof(_head));
+        head.close();
+    }
+    if (_head >= _tail) {
+        reset();
+    } else if (_tail - _head > BACKLOG_MAX_FRAMES) {
+        _head = _tail - BACKLOG_MAX_FRAMES;  // overwritten while the ring was full
+    }
+    _savedHead = _head;
+}
+
+void FrameBacklog::sent(const TelemetryFrame& frame, bool ok, unsigned long nowMs) {
+    if (!ok) {
+        store(frame);
+        return;
+    }
+    InFlight* slot = nullptr;
+    for (InFlight& entry : _inflight) {
+        if (!entry.used) { slot = &entry; break; }
+        if (!slot || (long)(entry.sentMs - slot->sentMs) < 0) slot = &entry;
+    }
+    if (slot->used) store(slot->frame);  // all waiting: the oldest makes room
+    slot->used = true;
+    slot->sentMs = nowMs;
+    slot->frame = frame;
+}
+
+void FrameBacklog::acked(uint32_t seq) {
+    _linkUp = true;
+    for (InFlight& entry : _inflight) {
+        if (entry.used && entry.frame.seq == seq) entry.used = false;
+    }
+}
+
+void FrameBacklog::expire(unsigned long nowMs) {
+    for (InFlight& entry : _inflight) {
+        if (entry.used && nowMs - entry.sentMs >= BACKLOG_ACK_TIMEOUT_MS) {
+            entry.used = false;
+            store(entry.frame);
+            _linkUp = false;
+        }
+    }
+}
+
+bool FrameBacklog::replayDue(unsigned long nowMs) const {
+    return _linkUp && _head < _tail && nowMs - _lastReplayMs >= BACKLOG_REPLAY_INTERVAL_MS;
+}
+
+bool FrameBacklog::nextReplay(TelemetryFrame& frame, unsigned long nowMs) {
+    _lastReplayMs = nowMs;
+    File frames = _fs->open(BACKLOG_FRAMES, FILE_READ);
+    if (!frames) return false;
+    bool found = false;
+    while (!found && _head < _tail) {
+        BacklogSlot slot;
+        bool ok = readSlot(frames, _head % BACKLOG_MAX_FRAMES, slot) && slot.index == _head &&
+                  slot.len < sizeof(frame.json);
+        _head++;
+        if (!ok) {
+            _dropped++;  // torn or unreadable slot
+            continue;
+        }
+        frame.seq = slot.seq;
+        memcpy(frame.json, slot.json, slot.len);
+        frame.json[slot.len] = '\0';
+        found = true;
+    }
+    frames.close();
+    if (found) _replayed++;
+    // The hub drops frames it already has, so the head only goes to the
+    // card every few replays and when the queue drains
+    if (_head >= _tail) {
+        reset();
+    } else if (_head - _savedHead >= BACKLOG_HEAD_SAVE_FRAMES) {
+        saveHead();
+    }
+    return found;
+}
+
+void FrameBacklog::store(const TelemetryFrame& frame) {
+    if (!_fs) {
+        _dropped++;
+        return;
+    }
+    if (_tail - _head >= BACKLOG_MAX_FRAMES) {
+        _head++;  // full: the oldest frame's slot is reused, begin() works the head out again
+        _dropped++;
+    }
+    BacklogSlot slot = {};
+    slot.index = _tail;
+    slot.seq = frame.seq;
+    slot.len = strnlen(frame.json, sizeof(frame.json) - 1);
+    memcpy(slot.json, frame.json, slot.len);
+    slot.crc = slotCrc(slot);
+    File frames = _fs->open(BACKLOG_FRAMES, "r+");
+    if (!frames) frames = _fs->open(BACKLOG_FRAMES, FILE_WRITE, true);
+    if (!frames) {
+        _dropped++;
+        return;
+    }
+    // Until the ring wraps the file grows slot by slot; a torn slot in front
+    // is padded out and then skipped on its CRC
+    size_t position = (size_t)(_tail % BACKLOG_MAX_FRAMES) * BACKLOG_SLOT_SIZE;
+    size_t size = frames.size();
+    if (size < position) {
+        static const uint8_t zeros[BACKLOG_SLOT_SIZE] = {};
+        frames.seek(size);
+        while (size < position) size += frames.write(zeros, min(position - size, sizeof(zeros)));
+    }
+    bool ok = frames.seek(position) && frames.write((const uint8_t*)&slot, sizeof(slot)) == sizeof(slot);
+    frames.close();
+    if (ok) {
+        _tail++;
+        _stored++;
+    } else {
+        _dropped++;
+    }
+}
+
+bool FrameBacklog::readSlot(File& frames, uint32_t position, BacklogSlot& slot) {
+    return frames.seek(position * BACKLOG_SLOT_SIZE) &&
+           frames.read((uint8_t*)&slot, sizeof(slot)) == sizeof(slot) &&
+           slot.len < sizeof(slot.json) && slot.crc == slotCrc(slot);
+}
+
+void FrameBacklog::saveHead() {
+    File head = _fs->open(BACKLOG_HEAD, FILE_WRITE);
+    if (!head) return;
+    if (head.write((const uint8_t*)&_head, sizeof(_head)) == sizeof(_head)) _savedHead = _head;
+    head.close();
+}
+
+// Everything replayed: start the ring over from an empty file
+void FrameBacklog::reset() {
+    _fs->remove(BACKLOG_FRAMES);
+    _fs->remove(BACKLOG_HEAD);
+    _head = 0;
+    _tail = 0;
+    _savedHead = 0;
+}
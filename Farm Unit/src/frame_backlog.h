@@ -0,0 +1,81 @@
+#ifndef FRAME_BACKLOG_H
+#define FRAME_BACKLOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "core_link.h"
+
+// Store-and-forward for uplink frames, owned by the radio task. A frame that
+// fails to send, or is not acked by the hub in time, goes to a queue file on
+// the SD card; once acks come back the queue is replayed oldest first, one
+// frame per interval and only while no live frame is waiting. The file is a
+// ring of BACKLOG_MAX_FRAMES slots, so a long outage overwrites the oldest
+// frames instead of growing it.
+#define BACKLOG_DIR "/queue"
+#define BACKLOG_SLOT_SIZE 512           // one frame per slot, the file is indexed by slot
+#define BACKLOG_MAX_FRAMES 2880         // a day of 30 s telemetry, 1.4 MB; the oldest goes first
+#define BACKLOG_INFLIGHT 8              // sent frames waiting for their ack
+#define BACKLOG_ACK_TIMEOUT_MS 90000
+#define BACKLOG_REPLAY_INTERVAL_MS 5000
+#define BACKLOG_HEAD_SAVE_FRAMES 16     // replays between head writes; a reboot sends at most this many again
+
+struct BacklogSlot {
+    uint32_t index;                     // frames stored before it; at index % BACKLOG_MAX_FRAMES
+    uint32_t seq;
+    uint16_t len;
+    uint16_t reserved;
+    uint32_t crc;                       // CRC-32 of the slot up to json[len], taken with crc 0
+    char json[BACKLOG_SLOT_SIZE - 16];
+};
+
+static_assert(sizeof(BacklogSlot) == BACKLOG_SLOT_SIZE, "backlog slot layout");
+static_assert(TELEMETRY_MSG_LEN <= sizeof(BacklogSlot::json), "frame does not fit a backlog slot");
+
+class FrameBacklog {
+public:
+    // Picks up a queue left by the last boot; without a card frames are
+    // still tracked but a lost one is gone
+    void begin(fs::FS& fs);
+
+    // After each send attempt of a numbered frame
+    void sent(const TelemetryFrame& frame, bool ok, unsigned long nowMs);
+    void acked(uint32_t seq);
+    // Unacked frames past the timeout go to the queue, the link counts as down
+    void expire(unsigned long nowMs);
+
+    bool replayDue(unsigned long nowMs) const;
+    // Oldest queued frame, as it was first sent
+    bool nextReplay(TelemetryFrame& frame, unsigned long nowMs);
+
+    bool linkUp() const { return _linkUp; }
+    uint32_t queued() const { return _tail - _head; }
+    uint32_t stored() const { return _stored; }
+    uint32_t replayed() const { return _replayed; }
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    struct InFlight {
+        bool used;
+        unsigned long sentMs;
+        TelemetryFrame frame;
+    };
+
+    fs::FS* _fs = nullptr;
+    uint32_t _head = 0;                 // index of the next frame to replay
+    uint32_t _tail = 0;                 // index the next stored frame gets
+    uint32_t _savedHead = 0;            // head as last written to the card
+    InFlight _inflight[BACKLOG_INFLIGHT] = {};
+    bool _linkUp = false;               // an ack arrived since the last timeout
+    unsigned long _lastReplayMs = 0;
+
+    uint32_t _stored = 0;
+    uint32_t _replayed = 0;
+    uint32_t _dropped = 0;
+
+    void store(const TelemetryFrame& frame);
+    bool readSlot(File& frames, uint32_t position, BacklogSlot& slot);
+    void saveHead();
+    void reset();
+};
+
+#endif // FRAME_BACKLOG_H
@@ -0,0 +1,388 @@
+#include "gzip_stream.h"
+#include <rom/crc.h>
+
+// RFC 1951 3.2.5: match lengths 3..258 and distances 1..DEFLATE_WINDOW
+static const uint16_t LENGTH_BASE[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DIST_BASE[24] = { 1,  2,  3,  4,   5,   7,   9,   13,  17,  25,   33,   49,
+                                        65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073 };
+static const uint8_t DIST_EXTRA[24] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10 };
+
+// Code length alphabet, 3.2.7: 16 repeats the last length, 17 and 18 are runs of zeros
+#define CL_CODES 19
+static const uint8_t CL_ORDER[CL_CODES] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+static const uint8_t CL_EXTRA[3] = { 2, 3, 7 };
+
+static inline uint16_t hash3(const uint8_t* p) {
+    uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    return (v * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+static inline uint8_t lengthSymbol(uint16_t length) {
+    uint8_t code = 28;
+    while (LENGTH_BASE[code] > length) code--;
+    return code;
+}
+
+static inline uint8_t distanceSymbol(uint16_t distance) {
+    uint8_t code = 23;
+    while (DIST_BASE[code] > distance) code--;
+    return code;
+}
+
+// Fixed literal/length code lengths, 3.2.6
+static inline uint8_t fixedLength(uint16_t symbol) {
+    return symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+}
+
+// Canonical codes from their lengths (3.2.2), bit-reversed: Huffman codes
+// are packed from their most significant bit
+static void buildCodes(const uint8_t* lengths, uint16_t count, uint16_t* codes) {
+    uint16_t lengthCount[16] = {};
+    uint16_t next[16];
+    for (uint16_t s = 0; s < count; s++) lengthCount[lengths[s]]++;
+    lengthCount[0] = 0;
+    uint16_t code = 0;
+    for (uint8_t bits = 1; bits < 16; bits++) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    for (uint16_t s = 0; s < count; s++) {
+        uint8_t length = lengths[s];
+        if (length == 0) continue;
+        uint16_t value = next[length]++;
+        uint16_t reversed = 0;
+        for (uint8_t i = 0; i < length; i++) {
+            reversed = (reversed << 1) | (value & 1);
+            value >>= 1;
+        }
+        codes[s] = reversed;
+    }
+}
+
+void GzipStream::begin(Print& out) {
+    _out = &out;
+    memset(_head, 0, sizeof(_head));
+    memset(_litFreq, 0, sizeof(_litFreq));
+    memset(_distFreq, 0, sizeof(_distFreq));
+    _pos = 0;
+    _end = 0;
+    _crc = 0;
+    _tokens = 0;
+    _blockStart = 0;
+    _blockBytes = 0;
+    _bits = 0;
+    _bitCount = 0;
+    _outLen = 0;
+    _bytesIn = 0;
+    _bytesOut = 0;
+    _cpuMicros = 0;
+    // Magic, deflate, no name or mtime, unknown OS
+    static const uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+    for (uint8_t b : header) putByte(b);
+}
+
+size_t GzipStream::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t GzipStream::write(const uint8_t* data, size_t len) {
+    if (!_out) return 0;
+    uint32_t start = micros();
+    _crc = crc32_le(_crc, data, len);
+    _bytesIn += len;
+    size_t done = 0;
+    while (done < len) {
+        size_t n = min(len - done, sizeof(_window) - _end);
+        memcpy(_window + _end, data + done, n);
+        _end += n;
+        done += n;
+        if (_end == sizeof(_window)) {
+            compress(false);
+            slide();
+        }
+    }
+    _cpuMicros += micros() - start;
+    return len;
+}
+
+bool GzipStream::writeDeflated(const DeflatedText& text) {
+    if (!_out || _bytesIn != 0) return false;
+    flushOut();
+    _out->write(text.deflated, text.length);
+    _bytesOut += text.length;
+    _crc = text.crc;
+    _bytesIn = text.size;
+    return true;
+}
+
+void GzipStream::finish() {
+    if (!_out) return;
+    uint32_t start = micros();
+    compress(true);
+    writeBlock(true);
+    if (_bitCount) putBits(0, 8 - _bitCount);
+    for (uint8_t i = 0; i < 32; i += 8) putByte(_crc >> i);
+    for (uint8_t i = 0; i < 32; i += 8) putByte(_bytesIn >> i);
+    flushOut();
+    _cpuMicros += micros() - start;
+    _out = nullptr;
+}
+
+// Matches up to the last DEFLATE_MAX_MATCH bytes, so none is cut short by
+// input still to come; all of it when final
+void GzipStream::compress(bool final) {
+    uint16_t limit = final ? _end : (_end > DEFLATE_MAX_MATCH ? _end - DEFLATE_MAX_MATCH : 0);
+    while (_pos < limit) {
+        uint16_t length = 0;
+        uint16_t distance = 0;
+        if (_end - _pos >= DEFLATE_MIN_MATCH) {
+            uint16_t hash = hash3(_window + _pos);
+            uint16_t candidate = _head[hash];
+            _head[hash] = _pos + 1;
+            if (candidate && _pos + 1 - candidate <= DEFLATE_WINDOW) {
+                const uint8_t* a = _window + candidate - 1;
+                const uint8_t* b = _window + _pos;
+                uint16_t most = min(_end - _pos, DEFLATE_MAX_MATCH);
+                while (length < most && a[length] == b[length]) length++;
+                distance = _pos + 1 - candidate;
+            }
+        }
+        if (length >= DEFLATE_MIN_MATCH) {
+            addMatch(length, distance);
+            uint16_t stop = _pos + length;
+            for (uint16_t p = _pos + 1; p < stop && _end - p >= DEFLATE_MIN_MATCH; p++) {
+                _head[hash3(_window + p)] = p + 1;
+            }
+            _pos = stop;
+        } else {
+            addLiteral(_window[_pos]);
+            _pos++;
+        }
+    }
+}
+
+// Drops the older half of the window once it is out of match range
+void GzipStream::slide() {
+    memmove(_window, _window + DEFLATE_WINDOW, _end - DEFLATE_WINDOW);
+    _end -= DEFLATE_WINDOW;
+    _pos -= DEFLATE_WINDOW;
+    _blockStart -= DEFLATE_WINDOW;
+    for (uint16_t& head : _head) head = head > DEFLATE_WINDOW ? head - DEFLATE_WINDOW : 0;
+}
+
+void GzipStream::addLiteral(uint8_t c) {
+    _tokenDist[_tokens] = 0;
+    _tokenValue[_tokens] = c;
+    _litFreq[c]++;
+    _blockBytes++;
+    if (++_tokens == DEFLATE_BLOCK_TOKENS) writeBlock(false);
+}
+
+void GzipStream::addMatch(uint16_t length, uint16_t distance) {
+    _tokenDist[_tokens] = distance;
+    _tokenValue[_tokens] = length - DEFLATE_MIN_MATCH;
+    _litFreq[257 + lengthSymbol(length)]++;
+    _distFreq[distanceSymbol(distance)]++;
+    _blockBytes += length;
+    if (++_tokens == DEFLATE_BLOCK_TOKENS) writeBlock(false);
+}
+
+// The open block with its own codes, or the fixed ones if they come out
+// shorter once the code table is counted, or stored as it is when neither
+// beats the raw bytes and those are still in the window
+void GzipStream::writeBlock(bool last) {
+    _litFreq[256] = 1;  // end of block
+    buildLengths(_litFreq, DEFLATE_LIT_CODES, 15, _litLen);
+    buildLengths(_distFreq, DEFLATE_DIST_CODES, 15, _distLen);
+    uint16_t litCount = DEFLATE_LIT_CODES;
+    while (litCount > 257 && _litLen[litCount - 1] == 0) litCount--;
+    uint16_t distCount = DEFLATE_DIST_CODES;
+    while (distCount > 1 && _distLen[distCount - 1] == 0) distCount--;
+
+    // Both length lists as one, run-length coded
+    uint16_t clFreq[CL_CODES] = {};
+    uint16_t rleCount = 0;
+    uint16_t total = litCount + distCount;
+    for (uint16_t i = 0; i < total;) {
+        uint8_t value = i < litCount ? _litLen[i] : _distLen[i - litCount];
+        uint16_t run = 1;
+        while (i + run < total && (i + run < litCount ? _litLen[i + run] : _distLen[i + run - litCount]) == value) run++;
+        i += run;
+        bool repeat = false;  // 16 repeats the length just sent
+        while (run > 0) {
+            uint8_t symbol = value;
+            uint16_t n = 1;
+            if (value == 0 && run >= 11) {
+                symbol = 18;
+                n = min(run, (uint16_t)138);
+            } else if (value == 0 && run >= 3) {
+                symbol = 17;
+                n = run;
+            } else if (repeat && run >= 3) {
+                symbol = 16;
+                n = min(run, (uint16_t)6);
+            }
+            repeat = value != 0;
+            _rle[rleCount] = symbol;
+            _rleExtra[rleCount] = symbol == 18 ? n - 11 : symbol >= 16 ? n - 3 : 0;
+            clFreq[symbol]++;
+            rleCount++;
+            run -= n;
+        }
+    }
+    uint8_t clLen[CL_CODES];
+    uint16_t clCode[CL_CODES];
+    buildLengths(clFreq, CL_CODES, 7, clLen);
+    uint8_t clCount = CL_CODES;
+    while (clCount > 4 && clLen[CL_ORDER[clCount - 1]] == 0) clCount--;
+
+    // Extra bits are the same either way
+    uint32_t dynamicBits = 14 + 3 * clCount;
+    uint32_t fixedBits = 0;
+    for (uint16_t i = 0; i < rleCount; i++) {
+        dynamicBits += clLen[_rle[i]] + (_rle[i] >= 16 ? CL_EXTRA[_rle[i] - 16] : 0);
+    }
+    for (uint16_t s = 0; s < DEFLATE_LIT_CODES; s++) {
+        dynamicBits += (uint32_t)_litFreq[s] * _litLen[s];
+        fixedBits += (uint32_t)_litFreq[s] * fixedLength(s);
+    }
+    for (uint16_t s = 0; s < DEFLATE_DIST_CODES; s++) {
+        dynamicBits += (uint32_t)_distFreq[s] * _distLen[s];
+        fixedBits += (uint32_t)_distFreq[s] * 5;
+    }
+
+    // LEN and NLEN start on a byte boundary
+    uint32_t storedBits = (8 - (_bitCount + 3) % 8) % 8 + 32 + 8 * _blockBytes;
+    bool stored = _blockStart >= 0 && storedBits < min(dynamicBits, fixedBits);
+
+    putBits(last ? 1 : 0, 1);
+    if (stored) {
+        putBits(0, 2);
+        if (_bitCount) putBits(0, 8 - _bitCount);
+        putBits(_blockBytes, 16);
+        putBits(~_blockBytes & 0xFFFF, 16);
+        for (uint32_t i = 0; i < _blockBytes; i++) putByte(_window[_blockStart + i]);
+    } else {
+        if (dynamicBits < fixedBits) {
+            putBits(2, 2);
+            putBits(litCount - 257, 5);
+            putBits(distCount - 1, 5);
+            putBits(clCount - 4, 4);
+            for (uint8_t i = 0; i < clCount; i++) putBits(clLen[CL_ORDER[i]], 3);
+            buildCodes(clLen, CL_CODES, clCode);
+            for (uint16_t i = 0; i < rleCount; i++) {
+                uint8_t symbol = _rle[i];
+                putBits(clCode[symbol], clLen[symbol]);
+                if (symbol >= 16) putBits(_rleExtra[i], CL_EXTRA[symbol - 16]);
+            }
+        } else {
+            putBits(1, 2);
+            for (uint16_t s = 0; s < DEFLATE_LIT_CODES; s++) _litLen[s] = fixedLength(s);
+            for (uint16_t s = 0; s < DEFLATE_DIST_CODES; s++) _distLen[s] = 5;
+        }
+        buildCodes(_litLen, DEFLATE_LIT_CODES, _litCode);
+        buildCodes(_distLen, DEFLATE_DIST_CODES, _distCode);
+
+        for (uint16_t t = 0; t < _tokens; t++) {
+            uint16_t distance = _tokenDist[t];
+            if (distance == 0) {
+                putBits(_litCode[_tokenValue[t]], _litLen[_tokenValue[t]]);
+                continue;
+            }
+            uint16_t length = _tokenValue[t] + DEFLATE_MIN_MATCH;
+            uint8_t code = lengthSymbol(length);
+            putBits(_litCode[257 + code], _litLen[257 + code]);
+            putBits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+            code = distanceSymbol(distance);
+            putBits(_distCode[code], _distLen[code]);
+            putBits(distance - DIST_BASE[code], DIST_EXTRA[code]);
+        }
+        putBits(_litCode[256], _litLen[256]);
+    }
+
+    _blockStart += _blockBytes;
+    _blockBytes = 0;
+    _tokens = 0;
+    memset(_litFreq, 0, sizeof(_litFreq));
+    memset(_distFreq, 0, sizeof(_distFreq));
+}
+
+// Huffman code lengths for freq[0..count), none longer than limit: the
+// counts are scaled down until the tree is shallow enough
+void GzipStream::buildLengths(const uint16_t* freq, uint16_t count, uint8_t limit, uint8_t* lengths) {
+    memset(lengths, 0, count);
+    for (uint8_t shift = 0;; shift++) {
+        // Used symbols, lightest first
+        uint16_t leaves = 0;
+        for (uint16_t s = 0; s < count; s++) {
+            if (freq[s] == 0) continue;
+            uint16_t weight = max(freq[s] >> shift, 1);
+            uint16_t i = leaves++;
+            for (; i > 0 && _weight[i - 1] > weight; i--) {
+                _weight[i] = _weight[i - 1];
+                _order[i] = _order[i - 1];
+            }
+            _weight[i] = weight;
+            _order[i] = s;
+        }
+        if (leaves == 0) return;
+        if (leaves == 1) {
+            lengths[_order[0]] = 1;
+            return;
+        }
+
+        // Leaves are already sorted and merged nodes come out in order:
+        // the two lightest are always at the head of one of the two runs
+        uint16_t leaf = 0;
+        uint16_t node = leaves;
+        uint16_t nodes = leaves;
+        while (nodes < 2 * leaves - 1) {
+            uint16_t pick[2];
+            for (uint16_t& p : pick) {
+                p = leaf < leaves && (node == nodes || _weight[leaf] <= _weight[node]) ? leaf++ : node++;
+            }
+            _weight[nodes] = _weight[pick[0]] + _weight[pick[1]];
+            _parent[pick[0]] = nodes;
+            _parent[pick[1]] = nodes;
+            nodes++;
+        }
+        // Depths from the root down, over the weights
+        uint8_t deepest = 0;
+        _weight[nodes - 1] = 0;
+        for (uint16_t i = nodes - 1; i-- > 0;) {
+            _weight[i] = _weight[_parent[i]] + 1;
+            if (i < leaves && _weight[i] > deepest) deepest = _weight[i];
+        }
+        if (deepest <= limit) {
+            for (uint16_t i = 0; i < leaves; i++) lengths[_order[i]] = _weight[i];
+            return;
+        }
+    }
+}
+
+void GzipStream::putBits(uint32_t value, uint8_t count) {
+    _bits |= value << _bitCount;
+    _bitCount += count;
+    while (_bitCount >= 8) {
+        putByte(_bits & 0xFF);
+        _bits >>= 8;
+        _bitCount -= 8;
+    }
+}
+
+void GzipStream::putByte(uint8_t b) {
+    _outBuffer[_outLen++] = b;
+    if (_outLen == sizeof(_outBuffer)) flushOut();
+}
+
+void GzipStream::flushOut() {
+    if (_outLen == 0) return;
+    uint32_t start = micros();
+    _out->write(_outBuffer, _outLen);
+    _cpuMicros -= micros() - start;  // time in the sink is not compression
+    _bytesOut += _outLen;
+    _outLen = 0;
+}
@@ -0,0 +1,94 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Arduino.h>
+
+// Streaming gzip (RFC 1952) for HTTP responses. LZ77 over a small window with
+// one hash probe per position; each block of matches and literals is then
+// coded with Huffman codes built for it, or the fixed ones when those come
+// out shorter, or stored when coding would only grow it. Everything is in
+// this object, about 24 KB, no heap.
+#define DEFLATE_WINDOW 4096        // longest match distance
+#define DEFLATE_HASH_BITS 11
+#define DEFLATE_BLOCK_TOKENS 2048  // literals and matches per Huffman block
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_LIT_CODES 288      // literals, end of block, match lengths; the
+                                   // last two only complete the fixed code
+#define DEFLATE_DIST_CODES 30
+
+// Text deflated ahead of time, e.g. a page shell in flash: whole blocks, not
+// final, ending on a byte boundary, no match reaching outside it
+struct DeflatedText {
+    const char* text;
+    size_t size;
+    const uint8_t* deflated;
+    size_t length;
+    uint32_t crc;                  // CRC-32 of text
+};
+
+class GzipStream : public Print {
+public:
+    // Header goes out at once; compressed bytes follow block by block
+    void begin(Print& out);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    using Print::write;
+    // As the first data only: the deflated copy goes out as it is
+    bool writeDeflated(const DeflatedText& text);
+    // Rest of the input, last block and the CRC/size trailer
+    void finish();
+
+    uint32_t bytesIn() const { return _bytesIn; }
+    uint32_t bytesOut() const { return _bytesOut; }
+    uint32_t cpuMicros() const { return _cpuMicros; }  // spent compressing
+
+private:
+    Print* _out = nullptr;
+    uint8_t _window[2 * DEFLATE_WINDOW];
+    uint16_t _head[1 << DEFLATE_HASH_BITS];  // last position + 1 per hash, 0: none
+    uint16_t _pos = 0;              // next byte to encode
+    uint16_t _end = 0;              // bytes in the window
+    uint32_t _crc = 0;
+
+    // The open block: distance 0 marks a literal
+    uint16_t _tokenDist[DEFLATE_BLOCK_TOKENS];
+    uint8_t _tokenValue[DEFLATE_BLOCK_TOKENS];  // literal, or match length - 3
+    uint16_t _tokens = 0;
+    int32_t _blockStart = 0;        // its bytes in the window, < 0: slid out
+    uint32_t _blockBytes = 0;
+    uint16_t _litFreq[DEFLATE_LIT_CODES];
+    uint16_t _distFreq[DEFLATE_DIST_CODES];
+
+    // Its codes, bit-reversed for output, and room to build them
+    uint16_t _litCode[DEFLATE_LIT_CODES];
+    uint8_t _litLen[DEFLATE_LIT_CODES];
+    uint16_t _distCode[DEFLATE_DIST_CODES];
+    uint8_t _distLen[DEFLATE_DIST_CODES];
+    uint16_t _weight[2 * DEFLATE_LIT_CODES];
+    uint16_t _parent[2 * DEFLATE_LIT_CODES];
+    uint16_t _order[DEFLATE_LIT_CODES];
+    uint8_t _rle[DEFLATE_LIT_CODES + DEFLATE_DIST_CODES];
+    uint8_t _rleExtra[DEFLATE_LIT_CODES + DEFLATE_DIST_CODES];
+
+    uint32_t _bits = 0;             // pending output bits, LSB first
+    uint8_t _bitCount = 0;
+    uint8_t _outBuffer[128];
+    uint8_t _outLen = 0;
+
+    uint32_t _bytesIn = 0;
+    uint32_t _bytesOut = 0;
+    uint32_t _cpuMicros = 0;
+
+    void compress(bool final);
+    void slide();
+    void addLiteral(uint8_t c);
+    void addMatch(uint16_t length, uint16_t distance);
+    void writeBlock(bool last);
+    void buildLengths(const uint16_t* freq, uint16_t count, uint8_t limit, uint8_t* lengths);
+    void putBits(uint32_t value, uint8_t count);
+    void putByte(uint8_t b);
+    void flushOut();
+};
+
+#endif // GZIP_STREAM_H
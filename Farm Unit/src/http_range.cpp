@@ -0,0 +1,43 @@
+#include "http_range.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Digits between spaces; false for an empty or non-numeric field
+static bool parseNumber(const char* from, const char* to, size_t& value, bool& empty) {
+    while (from < to && *from == ' ') from++;
+    while (to > from && to[-1] == ' ') to--;
+    empty = from == to;
+    value = 0;
+    for (const char* c = from; c < to; c++) {
+        if (!isdigit((unsigned char)*c)) return false;
+        size_t next = value * 10 + (*c - '0');
+        value = next < value ? SIZE_MAX : next;  // past the end of any file
+    }
+    return true;
+}
+
+bool parseRange(const char* header, size_t size, size_t& start, size_t& end, bool& satisfiable) {
+    static const char prefix[] = "bytes=";
+    if (strncmp(header, prefix, sizeof(prefix) - 1) != 0 || strchr(header, ',')) return false;
+    header += sizeof(prefix) - 1;
+    const char* dash = strchr(header, '-');
+    if (!dash) return false;
+    size_t first, last;
+    bool noFirst, noLast;
+    if (!parseNumber(header, dash, first, noFirst) || !parseNumber(dash + 1, dash + strlen(dash), last, noLast)) {
+        return false;
+    }
+    if (noFirst) {
+        if (noLast) return false;
+        satisfiable = last > 0 && size > 0;  // "bytes=-0" asks for nothing
+        start = last < size ? size - last : 0;
+        end = size - 1;
+        return true;
+    }
+    if (!noLast && last < first) return false;
+    start = first;
+    end = noLast || last >= size ? size - 1 : last;
+    satisfiable = start < size;
+    return true;
+}
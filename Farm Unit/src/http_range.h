@@ -0,0 +1,11 @@
+#ifndef HTTP_RANGE_H
+#define HTTP_RANGE_H
+
+#include <Arduino.h>
+
+// One "bytes=a-b", "bytes=a-" or "bytes=-n" Range header against a body of
+// size bytes, end inclusive. False for anything else (multiple ranges too),
+// which gets the whole file with 200. True with satisfiable false is a 416.
+bool parseRange(const char* header, size_t size, size_t& start, size_t& end, bool& satisfiable);
+
+#endif // HTTP_RANGE_H
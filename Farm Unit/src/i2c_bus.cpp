@@ -0,0 +1,65 @@
+#include "i2c_bus.h"
+
+I2CBusManager::I2CBusManager(CCS811Irq& ccs, BH1750& light, Adafruit_BMP280& bmp)
+    : _ccs(ccs), _light(light), _bmp(bmp) {}
+
+void I2CBusManager::begin(uint32_t clockHz) {
+    Wire.setClock(clockHz);
+    Wire.setTimeOut(50); // ms, bounds a stuck clock stretch instead of hanging the loop
+}
+
+bool I2CBusManager::step() {
+    if (_pending == 0) return false;
+
+    I2CDevice device = I2C_DEV_CCS811;
+    while (!(_pending & I2C_MASK(device))) device = (I2CDevice)(device + 1);
+    _pending &= ~I2C_MASK(device);
+
+    bool ok = readDevice(device);
+    _transactions++;
+    if (ok) {
+        _snap.updated[device] = millis();
+    } else {
+        _snap.errors[device]++;
+    }
+    if (_callback) _callback(device, ok);
+    return _pending != 0;
+}
+
+bool I2CBusManager::readDevice(I2CDevice device) {
+    switch (device) {
+        case I2C_DEV_CCS811: {
+            uint16_t eco2, etvoc, errstat, raw;
+            _ccs.clearDataReady();
+            _ccs.read(&eco2, &etvoc, &errstat, &raw);
+            if (errstat != CCS811_ERRSTAT_OK) return false;
+            _snap.eco2 = eco2;
+            _snap.etvoc = etvoc;
+            return true;
+        }
+        case I2C_DEV_BH1750: {
+            float lux = _light.readLightLevel();
+            if (lux < 0) return false;
+            _snap.lux = lux;
+            return true;
+        }
+        case I2C_DEV_BMP280: {
+            float t = _bmp.readTemperature();
+            if (isnan(t)) return false;
+            _snap.airTemperature = t;
+            _snap.pressure = _bmp.readPressure();
+            // refresh CCS811 compensation only when the temperature really moved
+            if (isnan(_compTemperature) || fabs(t - _compTemperature) >= 0.5) {
+                request(I2C_MASK(I2C_DEV_CCS811_ENV));
+            }
+            return true;
+        }
+        case I2C_DEV_CCS811_ENV: {
+            if (!_ccs.setEnvironment(_snap.airTemperature, _humidity)) return false;
+            _compTemperature = _snap.airTemperature;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
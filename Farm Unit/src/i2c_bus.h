@@ -0,0 +1,68 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_BMP280.h>
+#include <BH1750.h>
+#include "ccs811_irq.h"
+
+// Devices on the shared I2C bus, also the bit index in a request mask
+enum I2CDevice : uint8_t {
+    I2C_DEV_CCS811 = 0,
+    I2C_DEV_BH1750,
+    I2C_DEV_BMP280,
+    I2C_DEV_CCS811_ENV,   // compensation write to the CCS811 from the BMP280 reading
+    I2C_DEV_COUNT
+};
+#define I2C_MASK(dev) (1 << (dev))
+#define I2C_MASK_ALL ((1 << I2C_DEV_COUNT) - 1)
+
+// Latest environmental readings. Written only by the bus manager, read by
+// telemetry and the control code without touching the bus.
+struct EnvSnapshot {
+    uint16_t eco2 = 0;            // ppm
+    uint16_t etvoc = 0;           // ppb
+    float lux = 0;
+    float airTemperature = 0;     // °C
+    float pressure = 0;           // Pa
+    unsigned long updated[I2C_DEV_COUNT] = {0}; // millis() of the last good read, 0 = never
+    uint32_t errors[I2C_DEV_COUNT] = {0};
+};
+
+typedef void (*I2CReadCallback)(I2CDevice device, bool ok);
+
+// Queues reads for all devices and runs them back-to-back, one transaction
+// per step() so the scheduler keeps running between devices.
+class I2CBusManager {
+public:
+    I2CBusManager(CCS811Irq& ccs, BH1750& light, Adafruit_BMP280& bmp);
+
+    void begin(uint32_t clockHz);
+    void onRead(I2CReadCallback callback) { _callback = callback; }
+
+    void request(uint8_t deviceMask) { _pending |= deviceMask & I2C_MASK_ALL; }
+    bool busy() const { return _pending != 0; }
+    bool step();  // one transaction; false once the queue is empty
+
+    // BMP280 has no humidity channel, compensation uses this value (%RH)
+    void setHumidity(float humidity) { _humidity = humidity; }
+
+    const EnvSnapshot& snapshot() const { return _snap; }
+    uint32_t transactions() const { return _transactions; }
+
+private:
+    CCS811Irq& _ccs;
+    BH1750& _light;
+    Adafruit_BMP280& _bmp;
+    EnvSnapshot _snap;
+    uint8_t _pending = 0;
+    uint32_t _transactions = 0;
+    I2CReadCallback _callback = nullptr;
+    float _humidity = 50.0;           // CCS811 power-on default
+    float _compTemperature = NAN;     // last temperature written to the CCS811
+
+    bool readDevice(I2CDevice device);
+};
+
+#endif // I2C_BUS_H
@@ -0,0 +1,81 @@
+#include "idle_sleep.h"
+
+void IdleSleep::addUart(uart_port_t uart) {
+    if (_uartCount >= IDLE_MAX_UARTS || uart > UART_NUM_1) return;
+    _uarts[_uartCount++] = uart;
+}
+
+void IdleSleep::addWakePin(uint8_t pin) {
+    if (_wakeCount < IDLE_MAX_WAKE_PINS) _wakePins[_wakeCount++] = { pin, false };
+}
+
+void IdleSleep::addListenPin(uint8_t pin) {
+    if (_wakeCount < IDLE_MAX_WAKE_PINS) _wakePins[_wakeCount++] = { pin, true };
+}
+
+void IdleSleep::holdPin(uint8_t pin) {
+    if (_heldCount < IDLE_MAX_HELD_PINS) _heldPins[_heldCount++] = pin;
+}
+
+void IdleSleep::begin() {
+    for (uint8_t i = 0; i < _uartCount; i++) {
+        uart_set_wakeup_threshold(_uarts[i], IDLE_UART_WAKE_EDGES);
+        esp_sleep_enable_uart_wakeup(_uarts[i]);
+    }
+    esp_sleep_enable_gpio_wakeup();
+}
+
+void IdleSleep::stayAwake(uint32_t ms) {
+    unsigned long until = millis() + ms;
+    if ((long)(until - _awakeUntil) > 0) _awakeUntil = until;
+}
+
+uint32_t IdleSleep::sleep(uint32_t maxMs) {
+    if (!_enabled || maxMs < IDLE_SLEEP_MIN_MS) return 0;
+    if ((long)(millis() - _awakeUntil) < 0) return 0;
+    if (maxMs > IDLE_SLEEP_MAX_MS) maxMs = IDLE_SLEEP_MAX_MS;
+
+    // pending output would be cut off mid-character
+    for (uint8_t i = 0; i < _uartCount; i++) uart_wait_tx_idle_polling(_uarts[i]);
+    for (uint8_t i = 0; i < _heldCount; i++) gpio_hold_en((gpio_num_t)_heldPins[i]);
+
+    for (uint8_t i = 0; i < _wakeCount; i++) gpio_wakeup_enable((gpio_num_t)_wakePins[i].pin, GPIO_INTR_LOW_LEVEL);
+
+    esp_sleep_enable_timer_wakeup((uint64_t)maxMs * 1000);
+    int64_t start = esp_timer_get_time();
+    esp_light_sleep_start();
+    int64_t slept = esp_timer_get_time() - start;
+
+    // back to the edge interrupt before the low line can retrigger the ISR;
+    // a listen pin has none
+    for (uint8_t i = 0; i < _wakeCount; i++) {
+        gpio_num_t pin = (gpio_num_t)_wakePins[i].pin;
+        gpio_wakeup_disable(pin);
+        if (!_wakePins[i].listen) gpio_set_intr_type(pin, GPIO_INTR_NEGEDGE);
+    }
+    for (uint8_t i = 0; i < _heldCount; i++) gpio_hold_dis((gpio_num_t)_heldPins[i]);
+
+    _lastCause = esp_sleep_get_wakeup_cause();
+    if (_lastCause == ESP_SLEEP_WAKEUP_UART) stayAwake(IDLE_LISTEN_WINDOW_MS);
+    if (_lastCause == ESP_SLEEP_WAKEUP_GPIO) stayAwake(listenWindow());
+    _asleepUs += slept;
+    _sleeps++;
+    return slept / 1000;
+}
+
+// A wake pin stays low until serviced, so if none is low the wake came from
+// a listen pin, whose start bit is long over by now. If one is, either may
+// have: long enough for the hub's command after its wake frame.
+uint32_t IdleSleep::listenWindow() const {
+    bool listening = false;
+    bool held = false;
+    for (uint8_t i = 0; i < _wakeCount; i++) {
+        if (_wakePins[i].listen) {
+            listening = true;
+        } else if (gpio_get_level((gpio_num_t)_wakePins[i].pin) == 0) {
+            held = true;
+        }
+    }
+    if (!listening) return 0;
+    return held ? IDLE_SHARED_WAKE_MS : IDLE_LISTEN_WINDOW_MS;
+}
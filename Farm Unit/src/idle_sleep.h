@@ -0,0 +1,71 @@
+#ifndef IDLE_SLEEP_H
+#define IDLE_SLEEP_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/uart.h>
+#include <driver/gpio.h>
+
+#define IDLE_SLEEP_MIN_MS 10          // entry/exit costs a few ms, not worth it below this
+#define IDLE_SLEEP_MAX_MS 60000
+#define IDLE_LISTEN_WINDOW_MS 3000    // stay awake after a UART wake for the rest of the message
+#define IDLE_SHARED_WAKE_MS 500      // a listen pin may have woken us with a wake pin low;
+                                      // longer than the hub's NODE_WAKE_DELAY_S
+#define IDLE_UART_WAKE_EDGES 3        // RX edges that wake the chip; those bytes are lost
+#define IDLE_MAX_HELD_PINS 8
+#define IDLE_MAX_WAKE_PINS 2
+#define IDLE_MAX_UARTS 2              // UART0/1 only, and only with RX on its IO_MUX pin
+                                      // (GPIO3 for UART0; UART1's GPIO9 is flash on WROOM)
+
+// ESP32 light sleep between scheduler deadlines. Wakes on the timer, on
+// RX activity of the registered UARTs or on a low level of a wake pin.
+// The level wakeup is only armed across the sleep itself: awake, the pin
+// keeps its falling-edge interrupt, as a low level would fire the ISR
+// without end while the line stays low.
+// A listen pin is the RX line of a UART routed through the GPIO matrix: its
+// start bit wakes the chip and those bytes are lost. A GPIO wake with no
+// wake pin low gets the listen window; with one low, either pin may have
+// woken the chip, so it gets a shorter one.
+// Relay outputs are latched with gpio_hold across the sleep.
+class IdleSleep {
+public:
+    void addUart(uart_port_t uart);       // call after the port's begin()
+    void addWakePin(uint8_t pin);         // active-low line with a FALLING interrupt attached,
+                                          // held low until serviced
+    void addListenPin(uint8_t pin);       // UART RX on a GPIO matrix pin, no interrupt attached
+    void holdPin(uint8_t pin);            // output kept as-is while asleep
+    void begin();
+
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool enabled() const { return _enabled; }
+    void stayAwake(uint32_t ms);          // defer sleep, e.g. while a reply is expected
+
+    // Sleep for up to maxMs; returns the time actually spent asleep
+    uint32_t sleep(uint32_t maxMs);
+
+    esp_sleep_wakeup_cause_t lastWakeCause() const { return _lastCause; }
+    uint64_t asleepMs() const { return _asleepUs / 1000; }
+    uint32_t sleeps() const { return _sleeps; }
+
+private:
+    uart_port_t _uarts[IDLE_MAX_UARTS];
+    uint8_t _uartCount = 0;
+    uint8_t _heldPins[IDLE_MAX_HELD_PINS];
+    uint8_t _heldCount = 0;
+    struct WakePin {
+        uint8_t pin;
+        bool listen;
+    };
+    WakePin _wakePins[IDLE_MAX_WAKE_PINS];
+    uint8_t _wakeCount = 0;
+
+    uint32_t listenWindow() const;
+    bool _enabled = true;
+    unsigned long _awakeUntil = 0;
+    esp_sleep_wakeup_cause_t _lastCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    uint64_t _asleepUs = 0;
+    uint32_t _sleeps = 0;
+};
+
+#endif // IDLE_SLEEP_H
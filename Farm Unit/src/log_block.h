@@ -0,0 +1,69 @@
+#ifndef LOG_BLOCK_H
+#define LOG_BLOCK_H
+
+#include <Arduino.h>
+
+// On-card block format shared by the sensor log and its readers: 512-byte
+// blocks, each with a header and a CRC, so a file is always a whole number
+// of blocks and a torn write costs at most the blocks of that flush.
+#define LOG_BLOCK_SIZE 512
+#define LOG_MAGIC 0x4C48           // "HL" little-endian
+
+enum LogBlockType : uint8_t {
+    LOG_BLOCK_RAW = 1,             // payload: count LogRecords
+    LOG_BLOCK_SERIES = 2,          // payload: one series, first LogRecord + bit-packed samples (series_codec.h)
+    LOG_BLOCK_PACKED = 3           // payload: short series back to back, each a LogSegment + its series payload
+};
+
+#define LOG_FLAG_UPTIME 0x01       // times are seconds since boot, no hub clock yet
+
+struct LogBlockHeader {
+    uint16_t magic;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t count;                // records in the block
+    uint16_t length;               // payload bytes used
+    uint32_t seq;                  // block number, increasing per unit
+    uint32_t crc;                  // CRC-32 of the whole block with this field 0
+};
+
+struct LogRecord {
+    uint32_t time;                 // seconds, epoch or uptime (LOG_FLAG_UPTIME)
+    uint16_t ms;
+    uint8_t signal;                // AlertSignal
+    uint8_t zone;
+    int32_t value;                 // milli-units, as the alert engine sees them
+};
+
+// One series in a LOG_BLOCK_PACKED block; the block's count is the sum of its segments'
+struct LogSegment {
+    uint16_t count;                // samples
+    uint16_t length;               // series payload bytes after this header
+};
+
+#define LOG_PAYLOAD_SIZE (LOG_BLOCK_SIZE - sizeof(LogBlockHeader))
+#define LOG_RECORDS_PER_BLOCK (LOG_PAYLOAD_SIZE / sizeof(LogRecord))
+
+struct LogBlock {
+    LogBlockHeader header;
+    uint8_t payload[LOG_PAYLOAD_SIZE];
+};
+
+// Sparse time index beside each log file (.idx next to .bin): one entry per
+// write, appended after its blocks. maxTime never decreases along the file,
+// so a reader binary-searches it for the first write that can hold a time.
+struct LogIndexEntry {
+    uint32_t block;                // first block of the write
+    uint16_t blocks;
+    uint16_t reserved;
+    uint32_t minTime;              // earliest sample in these blocks, seconds
+    uint32_t maxTime;              // latest sample in these or any earlier blocks
+};
+
+static_assert(sizeof(LogBlockHeader) == 16, "block header layout");
+static_assert(sizeof(LogRecord) == 12, "record layout");
+static_assert(sizeof(LogBlock) == LOG_BLOCK_SIZE, "block layout");
+static_assert(sizeof(LogIndexEntry) == 16, "index entry layout");
+static_assert(sizeof(LogSegment) == 4, "segment layout");
+
+#endif // LOG_BLOCK_H
@@ -0,0 +1,271 @@
+#include "log_query.h"
+#include "sensor_log.h"
+
+void LogQuery::begin(fs::FS& fs, uint32_t from, uint32_t to, uint8_t signal, uint8_t zone) {
+    end();
+    _fs = &fs;
+    _from = from;
+    _to = to;
+    _signal = signal;
+    _zone = zone;
+    _lastDay = to / 86400;
+    _blocksRead = 0;
+    _matched = 0;
+    listDays(from / 86400);
+    if (!openNextDay()) _block = _blockEnd = 0;
+}
+
+bool LogQuery::begin(fs::FS& fs, const char* path, uint32_t from, uint32_t to) {
+    end();
+    _fs = &fs;
+    _from = from;
+    _to = to;
+    _signal = LOG_QUERY_ANY;
+    _zone = LOG_QUERY_ANY;
+    _lastDay = 0;
+    _dayCount = _dayNext = 0;
+    _moreDays = false;
+    _blocksRead = 0;
+    _matched = 0;
+    // the index sits beside the log, .idx for .bin
+    char index[48];
+    snprintf(index, sizeof(index), "%s", path);
+    char* dot = strrchr(index, '.');
+    if (dot && strlen(dot) == 4) strcpy(dot, ".idx");
+    if (openFile(path, index)) return true;
+    end();
+    return false;
+}
+
+void LogQuery::end() {
+    closeDay();
+    _fs = nullptr;
+}
+
+bool LogQuery::next(LogRecord& record) {
+    if (!_fs) return false;
+    for (;;) {
+        if (_loaded && decode(record)) {
+            _matched++;
+            return true;
+        }
+        if (!nextBlock()) {
+            end();
+            return false;
+        }
+    }
+}
+
+// Next matching sample of the loaded block
+bool LogQuery::decode(LogRecord& record) {
+    for (;;) {
+        if (_buffer.header.type == LOG_BLOCK_SERIES) {
+            if (!_decoder.next(record)) break;
+        } else if (_buffer.header.type == LOG_BLOCK_PACKED) {
+            if (!_decoder.next(record)) {
+                if (!nextSegment()) break;
+                continue;
+            }
+        } else {
+            if (_record >= _buffer.header.count || _record >= LOG_RECORDS_PER_BLOCK) break;
+            memcpy(&record, _buffer.payload + _record++ * sizeof(record), sizeof(record));
+            if (_signal != LOG_QUERY_ANY && record.signal != _signal) continue;
+            if (_zone != LOG_QUERY_ANY && record.zone != _zone) continue;
+        }
+        if (record.time >= _from && record.time <= _to) return true;
+    }
+    _loaded = false;
+    return false;
+}
+
+// A series' first record says whether to decode it at all
+bool LogQuery::wanted(const uint8_t* series) const {
+    LogRecord first;
+    memcpy(&first, series, sizeof(first));
+    if (_signal != LOG_QUERY_ANY && first.signal != _signal) return false;
+    if (_zone != LOG_QUERY_ANY && first.zone != _zone) return false;
+    return first.time <= _to;
+}
+
+// Next series of the loaded packed block that can match
+bool LogQuery::nextSegment() {
+    LogSegment segment;
+    while (const uint8_t* data = SensorLog::segment(_buffer, _record, segment)) {
+        if (!wanted(data)) continue;
+        _decoder.start(data, segment.count, segment.length);
+        return true;
+    }
+    return false;
+}
+
+bool LogQuery::nextBlock() {
+    for (;;) {
+        while (_block < _blockEnd) {
+            uint32_t n = _block++;
+            if (!_data.seek(n * LOG_BLOCK_SIZE) || _data.read((uint8_t*)&_buffer, sizeof(_buffer)) != sizeof(_buffer)) {
+                _block = _blockEnd;
+                break;
+            }
+            _blocksRead++;
+            if (_buffer.header.magic != LOG_MAGIC || _buffer.header.crc != SensorLog::blockCrc(_buffer)) continue;
+            if (_buffer.header.type == LOG_BLOCK_SERIES) {
+                if (!wanted(_buffer.payload)) continue;
+                _decoder.start(_buffer);
+            } else if (_buffer.header.type == LOG_BLOCK_PACKED) {
+                _record = 0;
+                _decoder.start(_buffer.payload, 0, 0);  // decode() opens the first segment
+            } else if (_buffer.header.type == LOG_BLOCK_RAW) {
+                _record = 0;
+            } else {
+                continue;
+            }
+            _loaded = true;
+            return true;
+        }
+        if (nextWrite()) continue;
+        // On to the next day's file
+        closeDay();
+        if (!openNextDay()) return false;
+    }
+}
+
+// Blocks of the next write that can overlap the range, or the unindexed tail
+bool LogQuery::nextWrite() {
+    if (!_data) return false;
+    LogIndexEntry entry;
+    while (_entry < _entries && readEntry(_entry, entry)) {
+        _entry++;
+        if (entry.minTime > _to) continue;  // later writes may still reach back
+        _block = entry.block;
+        _blockEnd = min(entry.block + entry.blocks, _fileBlocks);
+        return true;
+    }
+    _entry = _entries;
+    if (_indexed < _fileBlocks) {
+        _block = _indexed;
+        _blockEnd = _fileBlocks;
+        _indexed = _fileBlocks;
+        return true;
+    }
+    return false;
+}
+
+// "20251019.bin" to its day number; false for anything else in the directory
+static bool parseDay(const char* name, uint32_t& day) {
+    const char* slash = strrchr(name, '/');
+    if (slash) name = slash + 1;
+    if (strlen(name) != 12 || strcmp(name + 8, ".bin") != 0) return false;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!isdigit((unsigned char)name[i])) return false;
+    }
+    int year = (name[0] - '0') * 1000 + (name[1] - '0') * 100 + (name[2] - '0') * 10 + (name[3] - '0');
+    int month = (name[4] - '0') * 10 + (name[5] - '0');
+    int date = (name[6] - '0') * 10 + (name[7] - '0');
+    if (year < 1970 || month < 1 || month > 12 || date < 1 || date > 31) return false;
+    // days from civil date, March-based year
+    int y = year - (month <= 2);
+    int era = y / 400;
+    int yearOfEra = y - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + date - 1;
+    day = era * 146097 + yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear - 719468;
+    // a date that does not exist, e.g. 0231, comes back as another name
+    char path[32];
+    SensorLog::filePath(path, sizeof(path), day, 0);
+    return strcmp(strrchr(path, '/') + 1, name) == 0;
+}
+
+// The earliest LOG_QUERY_DAYS hub-clock day files in [first, _lastDay], one
+// pass over the directory
+void LogQuery::listDays(uint32_t first) {
+    _dayCount = _dayNext = 0;
+    _moreDays = false;
+    File dir = _fs->open(LOG_DIR, FILE_READ);
+    if (!dir) return;
+    for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+        uint32_t day;
+        bool inRange = !file.isDirectory() && parseDay(file.name(), day) && day >= first && day <= _lastDay;
+        file.close();
+        if (!inRange) continue;
+        // sorted insert; once full, the latest day drops out for a later pass
+        uint8_t i = _dayCount;
+        if (i == LOG_QUERY_DAYS) {
+            _moreDays = true;
+            if (day >= _days[i - 1]) continue;
+            i--;
+        } else {
+            _dayCount++;
+        }
+        while (i > 0 && _days[i - 1] > day) {
+            _days[i] = _days[i - 1];
+            i--;
+        }
+        _days[i] = day;
+    }
+    dir.close();
+}
+
+bool LogQuery::openNextDay() {
+    for (;;) {
+        while (_dayNext < _dayCount) {
+            if (openDay(_days[_dayNext++])) return true;
+        }
+        if (!_moreDays || _days[_dayCount - 1] >= _lastDay) return false;
+        listDays(_days[_dayCount - 1] + 1);
+    }
+}
+
+bool LogQuery::openDay(uint32_t day) {
+    char path[32], index[32];
+    SensorLog::filePath(path, sizeof(path), day, 0);
+    SensorLog::filePath(index, sizeof(index), day, 0, "idx");
+    return openFile(path, index);
+}
+
+bool LogQuery::openFile(const char* path, const char* indexPath) {
+    _data = _fs->open(path, FILE_READ);
+    if (!_data) return false;
+    _fileBlocks = _data.size() / LOG_BLOCK_SIZE;
+    _block = _blockEnd = 0;
+    _entry = _entries = 0;
+    _indexed = 0;
+
+    _index = _fs->open(indexPath, FILE_READ);
+    if (_index && _index.size() % sizeof(LogIndexEntry) == 0) _entries = _index.size() / sizeof(LogIndexEntry);
+    LogIndexEntry entry;
+    if (_entries > 0 && readEntry(_entries - 1, entry)) {
+        _indexed = min(entry.block + entry.blocks, _fileBlocks);
+    } else {
+        _entries = 0;  // no usable index: the whole file is scanned
+    }
+
+    // First write whose blocks reach _from; maxTime is a running maximum
+    uint32_t lo = 0, hi = _entries;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (readEntry(mid, entry) && entry.maxTime < _from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    _entry = lo;
+    return true;
+}
+
+void LogQuery::formatCsv(char* out, size_t size, const LogRecord& record) {
+    uint32_t magnitude = record.value < 0 ? -(uint32_t)record.value : record.value;
+    snprintf(out, size, "%lu.%03u,%u,%u,%s%lu.%03lu", (unsigned long)record.time, record.ms, record.signal, record.zone,
+             record.value < 0 ? "-" : "", (unsigned long)(magnitude / 1000), (unsigned long)(magnitude % 1000));
+}
+
+bool LogQuery::readEntry(uint32_t n, LogIndexEntry& entry) {
+    return _index && _index.seek(n * sizeof(entry)) && _index.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+}
+
+void LogQuery::closeDay() {
+    if (_data) _data.close();
+    if (_index) _index.close();
+    _data = File();
+    _index = File();
+    _loaded = false;
+}
@@ -0,0 +1,78 @@
+#ifndef LOG_QUERY_H
+#define LOG_QUERY_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "log_block.h"
+#include "series_codec.h"
+
+#define LOG_QUERY_ANY 0xFF          // signal or zone wildcard
+#define LOG_QUERY_CSV_HEADER "time,signal,zone,value"
+#define LOG_QUERY_CSV_LEN 48
+#define LOG_QUERY_DAYS 32           // day files taken per pass over the log directory
+
+// Streams the logged samples of a time range back off the card. Per day file
+// the index is binary-searched for the first write that can reach the range,
+// then only writes whose blocks overlap it are read, one block at a time.
+// The day files come from a listing of the log directory, so a wide range
+// costs one pass per LOG_QUERY_DAYS files on the card, not one open per day.
+// A time range searches hub-clock files only; samples still in RAM are not seen.
+class LogQuery {
+public:
+    // Epoch seconds, both ends inclusive
+    void begin(fs::FS& fs, uint32_t from, uint32_t to, uint8_t signal = LOG_QUERY_ANY, uint8_t zone = LOG_QUERY_ANY);
+    // One log file, uptime-stamped ones too; false if it cannot be opened
+    bool begin(fs::FS& fs, const char* path, uint32_t from = 0, uint32_t to = UINT32_MAX);
+    bool next(LogRecord& record);
+    void end();
+    bool active() const { return _fs != nullptr; }
+
+    // One CSV line, no newline: epoch s with ms, signal, zone, value
+    static void formatCsv(char* out, size_t size, const LogRecord& record);
+
+    uint32_t blocksRead() const { return _blocksRead; }
+    uint32_t matched() const { return _matched; }
+
+private:
+    fs::FS* _fs = nullptr;
+    uint32_t _from = 0;
+    uint32_t _to = 0;
+    uint8_t _signal = LOG_QUERY_ANY;
+    uint8_t _zone = LOG_QUERY_ANY;
+
+    uint32_t _lastDay = 0;
+    uint32_t _days[LOG_QUERY_DAYS];  // day files still to search, ascending
+    uint8_t _dayCount = 0;
+    uint8_t _dayNext = 0;
+    bool _moreDays = false;         // the listing was cut at LOG_QUERY_DAYS
+    File _data;
+    File _index;
+    uint32_t _entry = 0;            // next index entry
+    uint32_t _entries = 0;
+    uint32_t _indexed = 0;          // blocks the index covers; the rest is scanned
+    uint32_t _fileBlocks = 0;
+    uint32_t _block = 0;            // blocks of the current write still to read
+    uint32_t _blockEnd = 0;
+
+    LogBlock _buffer;
+    SeriesDecoder _decoder;
+    uint16_t _record = 0;           // next record of a RAW block, next segment offset of a PACKED one
+    bool _loaded = false;
+
+    uint32_t _blocksRead = 0;
+    uint32_t _matched = 0;
+
+    bool decode(LogRecord& record);
+    bool wanted(const uint8_t* series) const;
+    bool nextSegment();
+    bool nextBlock();
+    bool nextWrite();
+    void listDays(uint32_t first);
+    bool openNextDay();
+    bool openDay(uint32_t day);
+    bool openFile(const char* path, const char* indexPath);
+    bool readEntry(uint32_t n, LogIndexEntry& entry);
+    void closeDay();
+};
+
+#endif // LOG_QUERY_H
@@ -0,0 +1,295 @@
+#include "log_rollup.h"
+
+static const char* const LEVEL_DIRS[ROLLUP_LEVELS] = { "1m", "1h", "1d" };
+
+void RollupSum::add(int32_t value) {
+    sum += value;
+    if (value < min) min = value;
+    if (value > max) max = value;
+    count++;
+}
+
+void RollupSum::add(const RollupBucket& bucket) {
+    if (bucket.count == 0) return;
+    sum += (int64_t)bucket.mean * bucket.count;
+    if (bucket.min < min) min = bucket.min;
+    if (bucket.max > max) max = bucket.max;
+    count += bucket.count;
+}
+
+void RollupSum::add(const RollupSum& other) {
+    if (other.count == 0) return;
+    sum += other.sum;
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+    count += other.count;
+}
+
+RollupBucket RollupSum::bucket() const {
+    RollupBucket out = { 0, 0, 0, 0 };
+    if (count == 0) return out;
+    int64_t half = sum >= 0 ? count / 2 : -(int64_t)(count / 2);
+    out.min = min;
+    out.max = max;
+    out.mean = (int32_t)((sum + half) / (int64_t)count);
+    out.count = count;
+    return out;
+}
+
+void LogRollup::begin(fs::FS& fs) {
+    _fs = &fs;
+    _fs->mkdir(ROLLUP_DIR);
+    char path[32];
+    for (uint8_t level = 0; level < ROLLUP_LEVELS; level++) {
+        snprintf(path, sizeof(path), "%s/%s", ROLLUP_DIR, LEVEL_DIRS[level]);
+        _fs->mkdir(path);
+    }
+    for (Series& series : _series) series.used = false;
+    _pendingCount = 0;
+}
+
+void LogRollup::add(uint8_t signal, uint8_t zone, int32_t value, uint32_t time, unsigned long nowMs) {
+    if (!_fs) return;
+    Series& series = slot(signal, zone, time, nowMs);
+    for (uint8_t level = 0; level < ROLLUP_LEVELS; level++) {
+        uint32_t start = time - time % ROLLUP_WIDTHS[level];
+        if (start != series.start[level]) {
+            close(series, level, nowMs);
+            series.start[level] = start;
+            series.open[level] = RollupSum();
+        }
+        series.open[level].add(value);
+    }
+    series.lastMs = nowMs;
+}
+
+// The series' slot. A new one starts with what the card already holds for
+// its hour and day, e.g. from before a reboot.
+LogRollup::Series& LogRollup::slot(uint8_t signal, uint8_t zone, uint32_t time, unsigned long nowMs) {
+    Series* stalest = &_series[0];
+    for (Series& series : _series) {
+        if (series.used && series.signal == signal && series.zone == zone) return series;
+    }
+    for (Series& series : _series) {
+        if (!series.used) {
+            stalest = &series;
+            break;
+        }
+        if ((long)(series.lastMs - stalest->lastMs) < 0) stalest = &series;
+    }
+    // Its minute goes out as it is; hour and day are rebuilt from the
+    // finer levels if it comes back
+    if (stalest->used) close(*stalest, 0, nowMs);
+    stalest->used = false;
+
+    Series& series = *stalest;
+    series.signal = signal;
+    series.zone = zone;
+    for (uint8_t level = 0; level < ROLLUP_LEVELS; level++) {
+        series.start[level] = time - time % ROLLUP_WIDTHS[level];
+        series.open[level] = RollupSum();
+    }
+    collect(0, signal, zone, series.start[1], series.start[0] - series.start[1], series.open[1]);
+    collect(1, signal, zone, series.start[2], series.start[1] - series.start[2], series.open[2]);
+    series.open[2].add(series.open[1]);
+    series.used = true;
+    return series;
+}
+
+void LogRollup::close(const Series& series, uint8_t level, unsigned long nowMs) {
+    if (series.open[level].count == 0) return;
+    if (_pendingCount >= ROLLUP_PENDING) {
+        _dropped++;  // the card is not keeping up
+        return;
+    }
+    Pending& pending = _pending[_pendingCount];
+    pending.level = level;
+    pending.signal = series.signal;
+    pending.zone = series.zone;
+    pending.start = series.start[level];
+    pending.bucket = series.open[level].bucket();
+    if (_pendingCount == 0) _pendingSinceMs = nowMs;
+    _pendingCount++;
+}
+
+bool LogRollup::flushDue(unsigned long nowMs) const {
+    if (!_fs) return false;
+    return _pendingCount >= ROLLUP_FLUSH_BUCKETS || (_pendingCount > 0 && nowMs - _pendingSinceMs >= ROLLUP_MAX_AGE_MS);
+}
+
+uint8_t LogRollup::flush(unsigned long nowMs) {
+    if (!_fs) return 0;
+    uint8_t done = 0;
+    while (done < _pendingCount && write(_pending[done])) done++;
+    if (done == 0) return 0;
+    memmove(_pending, _pending + done, (_pendingCount - done) * sizeof(Pending));
+    _pendingCount -= done;
+    if (_pendingCount > 0) _pendingSinceMs = nowMs;
+    return done;
+}
+
+// Into its slot, padding the file with empty buckets up to it; a slot that
+// is already there (the clock stepped back, an evicted series came back)
+// is merged
+bool LogRollup::write(const Pending& pending) {
+    char path[ROLLUP_PATH_LEN];
+    filePath(path, sizeof(path), pending.level, pending.signal, pending.zone);
+    RollupFileHeader header;
+    File file = openFile(path, pending.level, pending.start, header);
+    if (!file) {
+        _writeErrors++;
+        return false;
+    }
+    if (pending.start < header.base) {
+        file.close();
+        _dropped++;  // before the file's first bucket
+        return true;
+    }
+
+    size_t pos = sizeof(header) + (size_t)((pending.start - header.base) / header.width) * sizeof(RollupBucket);
+    size_t size = file.size() - (file.size() - sizeof(header)) % sizeof(RollupBucket);  // a torn bucket is overwritten
+    if (pos > size + ROLLUP_MAX_GAP * sizeof(RollupBucket)) {
+        // Padding days of empty minutes would hold up the control loop for
+        // seconds: the file becomes a segment and a new one starts here
+        file.close();
+        char segment[ROLLUP_PATH_LEN];
+        filePath(segment, sizeof(segment), pending.level, pending.signal, pending.zone, header.base);
+        _fs->remove(segment);
+        if (!_fs->rename(path, segment) ||
+            !(file = createFile(path, pending.level, pending.start, header.base, header))) {
+            _writeErrors++;
+            return false;
+        }
+        pos = sizeof(header);
+        size = pos;
+    }
+    RollupBucket bucket = pending.bucket;
+    bool ok = true;
+    if (pos < size) {
+        RollupSum sum;
+        RollupBucket stored;
+        if (file.seek(pos) && file.read((uint8_t*)&stored, sizeof(stored)) == sizeof(stored)) sum.add(stored);
+        sum.add(bucket);
+        bucket = sum.bucket();
+    } else if (pos > size) {
+        static const RollupBucket empty[8] = {};
+        ok = file.seek(size);
+        while (ok && size < pos) {
+            size_t n = min(pos - size, sizeof(empty));
+            ok = file.write((const uint8_t*)empty, n) == n;
+            size += n;
+        }
+    }
+    ok = ok && file.seek(pos) && file.write((const uint8_t*)&bucket, sizeof(bucket)) == sizeof(bucket);
+    file.close();
+    if (!ok) {
+        _writeErrors++;
+        return false;
+    }
+    _bucketsWritten++;
+    return true;
+}
+
+// The level file with its header read, or a new one starting at base
+File LogRollup::openFile(const char* path, uint8_t level, uint32_t base, RollupFileHeader& header) {
+    File file = _fs->exists(path) ? _fs->open(path, "r+") : File();
+    if (!file) return createFile(path, level, base, 0, header);
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != ROLLUP_MAGIC ||
+        header.width != ROLLUP_WIDTHS[level]) {
+        file.close();
+        _fs->remove(path);  // not ours, start over
+        return createFile(path, level, base, 0, header);
+    }
+    return file;
+}
+
+File LogRollup::createFile(const char* path, uint8_t level, uint32_t base, uint32_t previous,
+                           RollupFileHeader& header) {
+    header = { ROLLUP_MAGIC, ROLLUP_WIDTHS[level], base, previous };
+    File file = _fs->open(path, FILE_WRITE, true);
+    if (file && file.write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+        file.close();
+        return File();
+    }
+    return file;
+}
+
+uint8_t LogRollup::levelFor(uint32_t from, uint32_t to, uint16_t points) {
+    uint32_t step = (to - from) / (points ? points : 1);
+    uint8_t level = 0;
+    while (level + 1 < ROLLUP_LEVELS && ROLLUP_WIDTHS[level + 1] <= step) level++;
+    return level;
+}
+
+RollupBucket LogRollup::read(uint8_t level, uint8_t signal, uint8_t zone, uint32_t start, uint32_t span) {
+    RollupSum sum;
+    if (_fs) collect(level, signal, zone, start, span, sum);
+    return sum.bucket();
+}
+
+// Written, pending and open buckets of a level starting in [start, start + span)
+void LogRollup::collect(uint8_t level, uint8_t signal, uint8_t zone, uint32_t start, uint32_t span, RollupSum& sum) {
+    if (span == 0) return;
+    collectFile(level, signal, zone, start, span, sum);
+    for (uint8_t i = 0; i < _pendingCount; i++) {
+        const Pending& pending = _pending[i];
+        if (pending.level == level && pending.signal == signal && pending.zone == zone &&
+            pending.start - start < span) {
+            sum.add(pending.bucket);
+        }
+    }
+    for (const Series& series : _series) {
+        if (series.used && series.signal == signal && series.zone == zone && series.start[level] - start < span) {
+            sum.add(series.open[level]);
+        }
+    }
+}
+
+// The file being written, then back through its segments while the range
+// reaches before the one in hand
+void LogRollup::collectFile(uint8_t level, uint8_t signal, uint8_t zone, uint32_t start, uint32_t span, RollupSum& sum) {
+    char path[ROLLUP_PATH_LEN];
+    uint32_t end = start + span;
+    uint32_t segment = 0;
+    do {
+        filePath(path, sizeof(path), level, signal, zone, segment);
+        File file = _fs->open(path, FILE_READ);
+        if (!file) return;
+        RollupFileHeader header;
+        if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != ROLLUP_MAGIC ||
+            header.width != ROLLUP_WIDTHS[level]) {
+            file.close();
+            return;
+        }
+        if (end > header.base) {
+            uint32_t first = start > header.base ? (start - header.base + header.width - 1) / header.width : 0;
+            uint32_t last = (end - header.base + header.width - 1) / header.width;  // exclusive
+            uint32_t stored = (file.size() - sizeof(header)) / sizeof(RollupBucket);
+            if (last > stored) last = stored;
+            if (first < last && file.seek(sizeof(header) + first * sizeof(RollupBucket))) {
+                RollupBucket buckets[8];
+                for (uint32_t n = first; n < last;) {
+                    size_t want = min(last - n, (uint32_t)(sizeof(buckets) / sizeof(buckets[0])));
+                    size_t got = file.read((uint8_t*)buckets, want * sizeof(RollupBucket)) / sizeof(RollupBucket);
+                    for (size_t i = 0; i < got; i++) sum.add(buckets[i]);
+                    if (got < want) break;
+                    n += got;
+                }
+            }
+        }
+        file.close();
+        if (start >= header.base || header.previous >= header.base) return;
+        segment = header.previous;
+    } while (segment != 0);
+}
+
+// ROLLUP_DIR/1m/s<signal>z<zone>.bin, likewise 1h and 1d; segments add their
+// base: s<signal>z<zone>_<base hex>.bin
+void LogRollup::filePath(char* out, size_t size, uint8_t level, uint8_t signal, uint8_t zone, uint32_t segment) {
+    if (segment == 0) {
+        snprintf(out, size, "%s/%s/s%uz%u.bin", ROLLUP_DIR, LEVEL_DIRS[level], signal, zone);
+    } else {
+        snprintf(out, size, "%s/%s/s%uz%u_%08lx.bin", ROLLUP_DIR, LEVEL_DIRS[level], signal, zone,
+                 (unsigned long)segment);
+    }
+}
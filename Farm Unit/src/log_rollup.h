@@ -0,0 +1,117 @@
+#ifndef LOG_ROLLUP_H
+#define LOG_ROLLUP_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Min/max/mean/count pyramid beside the sensor log, at 1 min, 1 h and 1 day.
+// Each sample updates the open bucket of every level in RAM. A closed bucket
+// is written to one file per level and series, where bucket n always sits at
+// the same offset, so any bucket range is one seek and one read. After a
+// reboot a series' open hour and day are rebuilt from the finer levels.
+// A gap longer than ROLLUP_MAX_GAP buckets (power off, a clock step) is not
+// padded out: the file is kept as a segment named by its base and a new
+// one starts, linked back to it. Hub-clock samples only.
+#define ROLLUP_DIR "/rollup"
+#define ROLLUP_LEVELS 3
+#define ROLLUP_SERIES_MAX 13       // as LOG_SERIES_MAX; the stalest series makes room
+#define ROLLUP_PENDING 32          // closed buckets waiting for the card
+#define ROLLUP_FLUSH_BUCKETS 16
+#define ROLLUP_MAX_AGE_MS 60000    // a closed bucket waits at most this for its write
+#define ROLLUP_MAX_GAP 256         // empty buckets padded in place, 4 KB
+#define ROLLUP_PATH_LEN 40
+#define ROLLUP_MAGIC 0x52554C48    // "HLUR" little-endian
+
+static const uint32_t ROLLUP_WIDTHS[ROLLUP_LEVELS] = { 60, 3600, 86400 };
+
+struct RollupBucket {
+    int32_t min;                   // milli-units, as in the log
+    int32_t max;
+    int32_t mean;
+    uint32_t count;                // 0: nothing logged
+};
+
+struct RollupFileHeader {
+    uint32_t magic;
+    uint32_t width;                // bucket seconds
+    uint32_t base;                 // start of bucket 0, epoch s
+    uint32_t previous;             // base of the segment before this file, 0: none
+};
+
+// Running sums behind an open bucket, and for merging stored ones
+struct RollupSum {
+    int64_t sum = 0;
+    int32_t min = INT32_MAX;
+    int32_t max = INT32_MIN;
+    uint32_t count = 0;
+
+    void add(int32_t value);
+    void add(const RollupBucket& bucket);
+    void add(const RollupSum& other);
+    RollupBucket bucket() const;
+};
+
+static_assert(sizeof(RollupBucket) == 16, "rollup bucket layout");
+static_assert(sizeof(RollupFileHeader) == sizeof(RollupBucket), "rollup header layout");
+
+class LogRollup {
+public:
+    void begin(fs::FS& fs);
+    bool active() const { return _fs != nullptr; }
+
+    // One sample at epoch time; the first one of a series reads back its open hour and day
+    void add(uint8_t signal, uint8_t zone, int32_t value, uint32_t time, unsigned long nowMs);
+
+    bool flushDue(unsigned long nowMs) const;
+    // Writes the closed buckets; returns how many
+    uint8_t flush(unsigned long nowMs);
+
+    // Coarsest level that still gives a bucket per point over the window
+    static uint8_t levelFor(uint32_t from, uint32_t to, uint16_t points);
+    // Buckets [start, start + span) of a level merged, written or not
+    RollupBucket read(uint8_t level, uint8_t signal, uint8_t zone, uint32_t start, uint32_t span);
+
+    uint32_t bucketsWritten() const { return _bucketsWritten; }
+    uint32_t dropped() const { return _dropped; }
+    uint32_t writeErrors() const { return _writeErrors; }
+
+private:
+    struct Series {
+        bool used;
+        uint8_t signal;
+        uint8_t zone;
+        unsigned long lastMs;
+        uint32_t start[ROLLUP_LEVELS];
+        RollupSum open[ROLLUP_LEVELS];
+    };
+
+    struct Pending {
+        uint8_t level;
+        uint8_t signal;
+        uint8_t zone;
+        uint32_t start;
+        RollupBucket bucket;
+    };
+
+    fs::FS* _fs = nullptr;
+    Series _series[ROLLUP_SERIES_MAX] = {};
+    Pending _pending[ROLLUP_PENDING];
+    uint8_t _pendingCount = 0;
+    unsigned long _pendingSinceMs = 0;
+
+    uint32_t _bucketsWritten = 0;
+    uint32_t _dropped = 0;
+    uint32_t _writeErrors = 0;
+
+    Series& slot(uint8_t signal, uint8_t zone, uint32_t time, unsigned long nowMs);
+    void close(const Series& series, uint8_t level, unsigned long nowMs);
+    bool write(const Pending& pending);
+    File openFile(const char* path, uint8_t level, uint32_t base, RollupFileHeader& header);
+    File createFile(const char* path, uint8_t level, uint32_t base, uint32_t previous, RollupFileHeader& header);
+    void collect(uint8_t level, uint8_t signal, uint8_t zone, uint32_t start, uint32_t span, RollupSum& sum);
+    void collectFile(uint8_t level, uint8_t signal, uint8_t zone, uint32_t start, uint32_t span, RollupSum& sum);
+    // segment 0: the file being written, else the one with that base
+    static void filePath(char* out, size_t size, uint8_t level, uint8_t signal, uint8_t zone, uint32_t segment = 0);
+};
+
+#endif // LOG_ROLLUP_H
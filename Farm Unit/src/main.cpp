@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #define _TASK_SCHEDULING_OPTIONS
+#define _TASK_STATUS_REQUEST   // event-triggered tasks (Task::waitFor)
 #include <TaskScheduler.h>
 #include <WiFi.h>              //Built-in
 #include <ESP32WebServer.h>    //https://github.com/Pedroalbuquerque/ESP32WebServer download and place in your Libraries folder
@@ -16,21 +17,38 @@
 #include "EEPROM.h"
 #include <max6675.h>
 #include "DFRobot_ESP_PH_WITH_ADC.h"    // New pH library header
+#include "sensor_filter.h"
+#include "running_stats.h"
+#include "adaptive_rate.h"
+#include "i2c_bus.h"
+#include "core_link.h"   // queues between the control loop and the radio task
+#include "idle_sleep.h"
+#include "actuator_manager.h"
+#include "dosing_controller.h"
+#include "alert_engine.h"
+#include "zones.h"
+#include "sensor_registry.h"
+#include "sensor_log.h"
+#include "frame_backlog.h"
+#include "log_query.h"
+#include "log_rollup.h"
 #include <LoRa.h>
-#include "ccs811.h"  // CCS811 library
+#include "ccs811_irq.h"  // CCS811 library + nINT data-ready handling
 #include <BH1750.h>
 #include <HardwareSerial.h>
 #include <ArduinoJson.h>
 
-// LoRa Serial for RAK4270
+// LoRa Serial for RAK4270. UART wakeup needs RX on the port's IO_MUX pin,
+// which UART2 on 16/17 is not, so its RX line wakes the chip as a GPIO
 #define RAK_SERIAL_PORT_HW Serial2
+#define RAK_RX_PIN 16
+#define RAK_TX_PIN 17
 //temp
 #define BMP_SCK  (13)
 #define BMP_MISO (12)
 #define BMP_MOSI (11)
 #define BMP_CS   (10)
 Adafruit_BMP280 bmp; // I2C
-float atmosphericTemperature = 0.0;
 // brightness
 BH1750 lightMeter;
 // Define your SPI pins for temp sensor 
@@ -40,30 +58,43 @@ BH1750 lightMeter;
 
 // ec
 #define EC_PIN 35// Use an available analog pin
-DFRobot_ESP_EC ec;
+DFRobot_ESP_EC ec[ZONE_COUNT];       // one calibration curve per zone probe
 // Adafruit_ADS1115 ads;
-float voltage, ecValue, temperature = 25;
+float temperature = 25;       // shared water temperature probe, compensates every zone
 bool ecCalibrationRequested = false;  // Flag to trigger calibration
-// ecCalStep: 0 = idle, 1 = waiting for low-point calibration, 2 = waiting for high-point calibration
+// Calibration buffers, one step each: buffer value and the reading window that tells the
+// probe is sitting in it (adjust as needed). Steps after the second are optional, a timeout
+// there saves the points captured so far instead of aborting.
+struct CalibrationStep { float buffer; float readingLow; float readingHigh; };
+const CalibrationStep EC_CAL_STEPS[] = {
+  { 1.413, 1.14, 2.7 },   // low point
+  { 2.76,  18.0, 20.5 },  // high point
+  { 12.88, 25.0, 60.0 },  // top of the hydroponic range
+};
+const int EC_CAL_STEP_COUNT = sizeof(EC_CAL_STEPS) / sizeof(EC_CAL_STEPS[0]);
+// ecCalStep: 0 = idle, n = waiting for EC_CAL_STEPS[n - 1]
 int ecCalStep = 0;
 // Global variables for calibration timeout
 unsigned long ecCalibrationStartTime = 0;
+uint8_t ecCalZone = 0;               // zone whose probe is being calibrated
 unsigned long EC_CALIBRATION_TIMEOUT = 30000;  // 30 seconds timeout
-// Nutrient control thresholds and timings (adjust as needed)
-const float EC_LOW_THRESHOLD = 1.0;    // When EC is below this value, nutrients are needed
-const float EC_HIGH_THRESHOLD = 2.5;   // Optional: when EC is above, nutrients are sufficient
-const unsigned long nutrientDosingDuration = 8000; // 8 seconds dosing period
+// Nutrient dosing timings (adjust as needed), EC is closed-loop on each zone's target
+const unsigned long nutrientDosingDuration = 8000; // longest nutrient pulse (8 seconds)
+const unsigned long NUTRIENT_DEAD_TIME = 120000;   // dose reaching the EC probe through circulation
+const float EC_STABLE_SLOPE = 0.01;                // ms/cm per minute
 // (You can add a mixing period if your system requires additional circulation)
 
-// Nutrient dosing state machine
-enum NutrientState { NUTRIENT_IDLE, NUTRIENT_DOSING };
-NutrientState nutrientState = NUTRIENT_IDLE;
-unsigned long nutrientStateStartTime = 0;
-bool f_NutrientsActive = false;
-
 //co2
-CCS811 ccs811(23);  // 23 is the pin connected to nWAKE (adjust as needed)
-uint16_t eco2 = 0;   // measured CO₂ in ppm
+#define CCS811_NWAKE_PIN 23
+#define CCS811_NINT_PIN 25
+// New result every 10 s: three per 30 s telemetry frame, none read for nothing
+#define CCS811_MEAS_MODE CCS811_MODE_10SEC
+CCS811Irq ccs811(CCS811_NWAKE_PIN, CCS811_NINT_PIN);  // nWAKE asserted by the library only around transactions
+
+// Environmental I2C sensors (CCS811, BH1750, BMP280) are read in one queued batch;
+// telemetry reads the snapshot and never touches the bus.
+I2CBusManager i2cBus(ccs811, lightMeter, bmp);
+#define I2C_CLOCK_HZ 100000
 
 // ACTIONEURS
 #define WATER_PUMP_RELAY_PIN 4
@@ -71,29 +102,89 @@ uint16_t eco2 = 0;   // measured CO₂ in ppm
 #define NUTRIENTS_RELAY_PIN 2
 
 MAX6675 thermocouple( MAX6675_SCK, MAX6675_CS,  MAX6675_SO   );
-// flag for water pump 
-bool f_WaterPumpOn= false;
 
 //pH
 #define PH_PIN 33 // Pin for pH sensor
-DFRobot_ESP_PH_WITH_ADC phSensor;
-float pH_max = 8; // Maximum acceptable pH value
-bool f_ShotpH = false;
-// Global for pH variation update:
-float last_pH = 0;
-unsigned long lastVarCheck = 0;
-unsigned long varInterval = 20000; // sample every 20 seconds
-float var_pH = 0;
-
-// pH dosing state machine globals:
-enum PHState { PH_IDLE, PH_DOSING, PH_MIXING };
-PHState phState = PH_IDLE;
-unsigned long stateStartTime = 0;
-const unsigned long shotDuration = 10000; // dosing duration (10 seconds)
+DFRobot_ESP_PH_WITH_ADC phSensor[ZONE_COUNT];
+
+// Zones: wiring per zone, scalar state in the struct-of-arrays table,
+// per-zone objects in arrays indexed by zone.
+// One row per zone: pH ADC, EC ADC, water pump, pH relay, nutrient relay
+const ZonePins ZONE_PINS[] = {
+  { PH_PIN, EC_PIN, WATER_PUMP_RELAY_PIN, PH_RELAY_PIN, NUTRIENTS_RELAY_PIN },
+};
+static_assert(sizeof(ZONE_PINS) / sizeof(ZONE_PINS[0]) == ZONE_COUNT, "one ZONE_PINS row per zone");
+ZoneTable zones;
+// EEPROM, one calibration region per zone: EC K pair, EC table, pH voltages,
+// pH table. Zone 0 keeps the addresses it used before zones had their own
+// curves, zones 1.. follow zone 0's pH table.
+#define CAL_EEPROM_SIZE 512
+#define CAL_PAIR_SIZE (2 * (int)sizeof(float))
+#define CAL_ZONE_SIZE (2 * (CAL_PAIR_SIZE + CAL_CURVE_EEPROM_SIZE))
+#define CAL_ZONE_BASE (PHTABLEADDR + CAL_CURVE_EEPROM_SIZE)
+static_assert(CAL_ZONE_BASE + (ZONE_MAX - 1) * CAL_ZONE_SIZE <= CAL_EEPROM_SIZE, "calibration regions overflow the EEPROM");
+// Outlier rejection + Kalman: process noise, ADC noise, MAD floor
+#define PH_FILTER(z) { 0.0001, 0.01, 0.05 }
+#define EC_FILTER(z) { 0.0001, 0.0025, 0.02 }
+SensorFilter phFilter[ZONE_COUNT] = { ZONE_EACH(PH_FILTER) };
+SensorFilter ecFilter[ZONE_COUNT] = { ZONE_EACH(EC_FILTER) };
+// Rolling statistics per sensor: window (ms), EWMA weight
+#define WATER_WINDOW(z) { 120000, 0.1 }
+RunningStats phStats[ZONE_COUNT] = { ZONE_EACH(WATER_WINDOW) };
+RunningStats ecStats[ZONE_COUNT] = { ZONE_EACH(WATER_WINDOW) };
+RunningStats tempStats(300000, 0.05);
+RunningStats co2Stats(300000, 0.05);
+RunningStats airTempStats(300000, 0.05);
+RunningStats levelStats(300000, 0.05);
+// pH counts as settled when both the spread and the trend over the window are small
+const float PH_STABLE_STDDEV = 0.05;
+const float PH_STABLE_SLOPE = 0.02;  // pH per minute
+
+// Adaptive sampling: floor while a signal moves, ceiling when it is stable.
+// Limits can be changed from the hub ("ar"), the activity scales are fixed.
+AdaptiveRate waterRate(1000, 10000);       // pH / EC / water temperature
+AdaptiveRate envRate(5000, 60000);         // BH1750 + BMP280 batch
+AdaptiveRate levelRate(5000, 60000);       // ultrasonic water level
+AdaptiveRate telemetryRate(30000, 300000);
+const float PH_ACTIVE_SLOPE = 0.1;         // pH per minute that counts as fully active
+const float PH_ACTIVE_STDDEV = 0.1;
+const float EC_ACTIVE_SLOPE = 0.05;        // ms/cm per minute
+const float EC_ACTIVE_STDDEV = 0.05;
+const float AIR_TEMP_ACTIVE_SLOPE = 0.5;   // °C per minute
+const float AIR_TEMP_ACTIVE_STDDEV = 0.5;
+const float LEVEL_ACTIVE_SLOPE = 0.5;      // cm per minute
+const float LEVEL_ACTIVE_STDDEV = 0.5;
+float waterActivity = 1, envActivity = 1, levelActivity = 1;
+
+// pH dosing timings, the state machine itself is per zone (zones.phState)
+const unsigned long shotDuration = 10000; // longest acid shot (10 seconds)
 const unsigned long mixDuration = 10000;  // mixing duration (10 seconds)
+const unsigned long PH_DEAD_TIME = mixDuration + 20000;  // shot to settled reading: mixing plus probe lag
+
+// Closed-loop dosing toward the hub setpoints. Gains are ms of pulse per unit
+// of error (pH, ms/cm), one step at most every 30 s once the reading settled.
+//                           direction    kp     ki    kd  deadband min  max                     dead time           step
+const DosingTuning PH_TUNING = { DOSE_LOWERS, 6000,  1500, 0,  0.1,     500, shotDuration,           PH_DEAD_TIME,       30000 };
+const DosingTuning EC_TUNING = { DOSE_RAISES, 20000, 4000, 0,  0.05,    500, nutrientDosingDuration, NUTRIENT_DEAD_TIME, 30000 };
+#define PH_CONTROLLER(z) DosingController(PH_TUNING)
+#define EC_CONTROLLER(z) DosingController(EC_TUNING)
+DosingController phControl[ZONE_COUNT] = { ZONE_EACH(PH_CONTROLLER) };
+DosingController ecControl[ZONE_COUNT] = { ZONE_EACH(EC_CONTROLLER) };
+
+// Alert rules pushed by the hub ("ru"), fed by every sampling task;
+// transitions go out right away in their own frame ("al").
+AlertEngine alerts;
+#define ALERTS_PER_FRAME 4
 // calibration 
 bool phCalibrationRequested = false;      // For pH calibration
-int phCalStep = 0;                        // 0 = idle, 1 = acid (pH~4), 2 = neutral (pH~7)
+const CalibrationStep PH_CAL_STEPS[] = {
+  { 4.0,  0.3, 0.5 },   // acid
+  { 7.0,  2.0, 2.5 },   // neutral
+  { 10.0, 3.8, 5.0 },   // alkaline
+};
+const int PH_CAL_STEP_COUNT = sizeof(PH_CAL_STEPS) / sizeof(PH_CAL_STEPS[0]);
+int phCalStep = 0;                        // 0 = idle, n = waiting for PH_CAL_STEPS[n - 1]
+uint8_t phCalZone = 0;
 unsigned long phCalibrationStartTime = 0;
  unsigned long PH_CALIBRATION_TIMEOUT = 30000;
 
@@ -101,9 +192,7 @@ unsigned long phCalibrationStartTime = 0;
 int pumpOnInterval = 30000; // Time between pump starts (default: 30 sec)
 int pumpOffInterval = 20000; // Time pump stays on (default: 20 sec)
 
-// Ultrasonic Sensor Pins
-const int trig_pin = 5;
-const int echo_pin = 18;
+// Ultrasonic sensor, pins in the sensor registry (WaterLevel)
 #define SOUND_SPEED 340 // Sound speed in air
 #define TRIG_PULSE_DURATION_US 10
 long ultrason_duration;
@@ -117,8 +206,21 @@ bool ManualMode = false; // Set to true to disable automatic control
 //sd
 ESP32WebServer server(80);
 #define servername "MCserver" //Define the name to your server... 
+// SD card pages over Wi-Fi in station mode; an empty SSID leaves Wi-Fi and
+// the server off. Light sleep would drop the link, so it is off while they run.
+#define WIFI_SSID ""
+#define WIFI_PASSWORD ""
+#define WEB_POLL_MS 20              // handleClient() period
 //#define SD_pin 16 //G16 in my case
 bool   SD_present = false; //Controls if the SD card is present or not
+// Every filtered sample goes to the card in 512-byte blocks, one file per day
+SensorLog sensorLog;
+LogQuery serialQuery;           // one Serial QUERY at a time
+LogRollup rollups;              // 1 min / 1 h / 1 day min/max/mean per series, for charts
+// Uplink frames are numbered ("q") for the hub's acks; the radio task queues
+// unacked ones on the card and replays them once the link is back
+uint32_t frameSeq = 0;
+FrameBacklog backlog;
 
 // //mqtt
 // const char* ssid = "El FabSpace Lac";       // Change this to your Wifi SSID
@@ -140,49 +242,129 @@ void StopNutrients();
 void ReadPHTask();
 void ecCalibration();
 void phCalibrationTask();
+void finishECCalibration();
+void finishPHCalibration();
 void pH_calibrattion_inwater();
-void updateVarPH();
+void stepPHDosing(uint8_t zone);
+bool phStable(uint8_t zone);
+bool ecSettled(uint8_t zone);
 void controlNutrients();
-void readCO2Sensor();
+void stepNutrients(uint8_t zone);
+void sampleZone(uint8_t zone, unsigned long now);
+void pollI2CSensors();
+void runI2CBus();
+void onI2CRead(I2CDevice device, bool ok);
+void checkCO2DataReady();
 void processManualCommands();
 void checkWaterLevelTask();
-void readLightSensor();
-void readBMP280Sensor();
 void sendTelemetryTask();
+void sampleWaterSensors();
+void processCommandInput();
+void processRadioCommands();
+void reportTaskStats();
+void handlePulseDone();
+void logPulse(uint8_t zone, const RelayPulse& pulse);
+void logZone(uint8_t zone);
+int commandZone(String& cmd);
+bool requestActuator(uint8_t zone, Actuator act, ActuatorSource source, uint32_t ms, ActuatorResult* outcome = nullptr);
+void idleUntilNextTask();
+void applyRate(Task& task, uint32_t periodMs);
+void applyRateConfig(JsonObjectConst config);
+void applyAlertRule(JsonArrayConst rule);
+void feedAlert(AlertSignal signal, float value, float ratePerMin);
+void uplinkAlerts();
+void logSample(AlertSignal signal, uint8_t zone, float value);
+void flushSensorLog();
+void streamLogQuery();
+void sendSensorSchema();
+bool queueFrame(JsonDocument& doc);
+void armTask(Task& task, StatusRequest& event, unsigned long interval = 0, long iterations = TASK_ONCE);
+bool startWebServer();
+void serviceWebServer();
 // Task Definitions
 Task tStartPump(pumpOnInterval, TASK_FOREVER, &StartPump);
-Task tStopPump(pumpOffInterval, TASK_ONCE, &StopPump);
 Task tStartPH(60000, TASK_FOREVER, &StartPH);        // Every 60s
-Task tStopPH(10000, TASK_ONCE, &StopPH);             // Run 10s
 Task tStartNutrients(90000, TASK_FOREVER, &StartNutrients);  // Every 90s
-Task tStopNutrients(5000, TASK_ONCE, &StopNutrients);       // Run 15s
-
+Task tPulseDone(TASK_IMMEDIATE, TASK_ONCE, &handlePulseDone);  // a relay pulse timer expired
+
+// Relay on-times are ended by esp_timer one-shots, not by the scheduler
+const unsigned long scheduledPHShot = 10000;        // Run 10s
+const unsigned long scheduledNutrientShot = 5000;   // Run 5s
+#define PUMP_PULSE(z) { ZONE_PINS[z].pumpRelay, "Water pump" }
+#define PH_PULSE(z) { ZONE_PINS[z].phRelay, "pH relay" }
+#define NUTRIENT_PULSE(z) { ZONE_PINS[z].nutrientRelay, "Nutrient relay" }
+RelayPulse pumpPulse[ZONE_COUNT] = { ZONE_EACH(PUMP_PULSE) };
+RelayPulse phPulse[ZONE_COUNT] = { ZONE_EACH(PH_PULSE) };
+RelayPulse nutrientPulse[ZONE_COUNT] = { ZONE_EACH(NUTRIENT_PULSE) };
+// Only a zone's manager switches its relays; everything else asks it
+#define ZONE_ACTUATORS(z) { pumpPulse[z], phPulse[z], nutrientPulse[z] }
+ActuatorManager actuators[ZONE_COUNT] = { ZONE_EACH(ZONE_ACTUATORS) };
+#define PUMP_MIN_OFF_MS 15000     // protects the pump from short cycling
+#define DOSING_MIN_OFF_MS 5000
+
+Task tSampleWater(TASK_IMMEDIATE, TASK_FOREVER, &sampleWaterSensors); // pH/EC/temperature into the filters, period from the registry
 Task tReadPH(30000, TASK_FOREVER, &ReadPHTask); // Executes every 60 seconds
 
-Task tECCalibration(5000, TASK_FOREVER, &ecCalibration); // Executes every 5 seconds
-Task tPHCalibration(PH_CALIBRATION_TIMEOUT/6, TASK_FOREVER, &phCalibrationTask); // pH calibration check
+// Event-triggered tasks: parked on a StatusRequest until the event they
+// handle happens, instead of polling on a fixed period.
+StatusRequest srCommandInput;   // Serial line waiting
+StatusRequest srRadioCommand;   // hub command queued by the radio task
+StatusRequest srECCalibration;  // CAL_EC requested
+StatusRequest srPHCalibration;  // CALPH requested
+StatusRequest srPHDose;         // a zone's pH state machine has a step to take (zones.phWake)
+StatusRequest srECDose;         // a zone's nutrient state machine has a step to take (zones.nutrientWake)
+StatusRequest srPulseDone;      // a relay pulse ended in its timer callback
+
+#define EC_CALIBRATION_INTERVAL 5000  // reading interval while a calibration runs
+#define PH_CALIBRATION_INTERVAL 5000
 
-Task tPHDosing(8000, TASK_FOREVER, &pH_calibrattion_inwater);
-Task tPHVarUpdate(5000, TASK_FOREVER, &updateVarPH);
+Task tECCalibration(EC_CALIBRATION_INTERVAL, TASK_FOREVER, &ecCalibration);
+Task tPHCalibration(PH_CALIBRATION_INTERVAL, TASK_FOREVER, &phCalibrationTask);
 
-Task tNutrients(15000, TASK_FOREVER, &controlNutrients);
+Task tPHDosing(TASK_IMMEDIATE, TASK_ONCE, &pH_calibrattion_inwater);   // one step per woken zone
 
-Task tReadCO2(5000, TASK_FOREVER, &readCO2Sensor); 
+Task tNutrients(TASK_IMMEDIATE, TASK_ONCE, &controlNutrients);
 
-Task tManualCommands(1000, TASK_FOREVER, &processManualCommands); // Check for manual commands every second
-Task tCheckWaterLevel(5000, TASK_FOREVER, &checkWaterLevelTask);
+Task tI2CPoll(TASK_IMMEDIATE, TASK_FOREVER, &pollI2CSensors);  // queue one batch of reads per period
+Task tI2CBus(TASK_IMMEDIATE, TASK_FOREVER, &runI2CBus);   // drains the queue, one transaction per pass
+
+Task tManualCommands(TASK_IMMEDIATE, TASK_ONCE, &processCommandInput); // Serial commands, manual or automatic mode
+Task tRadioCommands(TASK_IMMEDIATE, TASK_ONCE, &processRadioCommands);
+Task tCheckWaterLevel(TASK_IMMEDIATE, TASK_FOREVER, &checkWaterLevelTask);
 
-Task tReadLight(5000, TASK_FOREVER, &readLightSensor); // every 5 seconds
-Task tReadBMP280(5000, TASK_FOREVER, &readBMP280Sensor); // every 5 seconds
 
 Task tSendTelemetry(30000, TASK_FOREVER, &sendTelemetryTask);
+Task tTaskStats(60000, TASK_FOREVER, &reportTaskStats);
+Task tLogFlush(TASK_IMMEDIATE, TASK_ONCE, &flushSensorLog);  // blocks to the SD card, a few writes a minute
+StatusRequest srLogFlush;       // enough log blocks for one write, or the oldest is due
+Task tLogQuery(50, TASK_FOREVER, &streamLogQuery);  // Serial QUERY results, enabled per query
+#define LOG_QUERY_LINES_PER_PASS 8     // well inside the log queue, which must be empty first
+Task tWebServer(WEB_POLL_MS, TASK_FOREVER, &serviceWebServer);  // enabled by startWebServer()
+
+// Scheduler passes that ran at least one task callback
+uint32_t schedulerWakeups = 0;
+uint32_t wakeupsPerMinute = 0;
+
+// Periodic tasks whose deadlines bound the idle sleep; event-triggered
+// tasks report no deadline and wake the loop through their sources.
+Task* const scheduledTasks[] = {
+  &tStartPump, &tStartPH, &tStartNutrients, &tPulseDone,
+  &tSampleWater, &tReadPH, &tECCalibration, &tPHCalibration, &tPHDosing, &tNutrients,
+  &tI2CPoll, &tI2CBus, &tManualCommands, &tRadioCommands, &tCheckWaterLevel,
+  &tSendTelemetry, &tTaskStats, &tLogFlush, &tLogQuery, &tWebServer
+};
+
+// Light sleep between task deadlines (solar/off-grid units)
+#define IDLE_SLEEP_ENABLED true
+IdleSleep idleSleep;
+uint64_t lastAsleepMs = 0;
+uint32_t asleepPermille = 0;   // share of the last minute spent asleep
 //Functions calls
 void parseConfig();
 void setup_wifi();
 void callback(char* topic, byte* payload, unsigned int length);
 void pH_calibrattion_inwater() ;
 //float readPHValue(int phPin, float acidVoltage, float neutralVoltage);
-void updateVarPH() ;
 float getWaterTemperature();
 void processSerialCommands();
 void pauseAutomationTasks();
@@ -195,6 +377,8 @@ float getWaterLevel();
 void generateHydroponicsJson(JsonDocument& doc);
 void processRPiCommand(const String& jsonCommandString);
 void sendTelemetryTask();
+void radioTask(void* parameter);
+void applyUplinkAcks(const String& json);
 ///test p2p lora
 class RAK4270_ESP {
 public:
@@ -210,6 +394,11 @@ public:
     bool sendJson(const JsonDocument& doc) {
         String jsonString;
         serializeJson(doc, jsonString);
+        return sendPayload(jsonString);
+    }
+
+    // Blocks for the AT round trips, run it from the radio task on core 0
+    bool sendPayload(const String& jsonString) {
         Serial.print("Attempting to send JSON: ");
         Serial.println(jsonString);
 
@@ -392,114 +581,281 @@ private:
         return true;
     }
 };
-RAK4270_ESP rakModule(RAK_SERIAL_PORT_HW, 16, 17, 115200);
-float target_ph = 6.5;
-float target_ec = 1.2;
+RAK4270_ESP rakModule(RAK_SERIAL_PORT_HW, RAK_RX_PIN, RAK_TX_PIN, 115200);
+
+// Radio AT handling and Serial output run on core 0 (next to the WiFi stack),
+// the scheduler and control code keep core 1 to themselves.
+#define RADIO_TASK_CORE 0
+#define RADIO_TASK_STACK 6144
+#define RADIO_TASK_PRIORITY 1
+TaskHandle_t radioTaskHandle = NULL;
+// pH / EC setpoints are per zone (zones.targetPH / targetEC), these until the hub sends its own
+const float DEFAULT_TARGET_PH = 6.5;
+const float DEFAULT_TARGET_EC = 1.2;
 float target_temperature = 25.0;
 int target_humidity = 60;
 int target_co2 = 800;
 int target_light = 300;
 String cropVariety = "Default";
 
+// Sensor registry: each periodic sensor once, with its pins, sampling task and
+// period, and each "sv"/"ss" telemetry channel once, with its slot and scale.
+// setup(), the telemetry encoder and the schema frame for the hub ("sc")
+// expand from the two lists below (sensor_registry.h).
+struct WaterChemistry {   // pH/EC probes of every zone, shared thermocouple
+  static void begin() {
+    ec[0].begin(0);          // zone 0: K pair at 0, table at ECTABLEADDR
+    phSensor[0].begin(32);   // pH voltages after the K pair, table at PHTABLEADDR
+    for (uint8_t z = 1; z < ZONE_COUNT; z++) {
+      int base = CAL_ZONE_BASE + (z - 1) * CAL_ZONE_SIZE;
+      ec[z].begin(base, base + CAL_PAIR_SIZE);
+      base += CAL_PAIR_SIZE + CAL_CURVE_EEPROM_SIZE;
+      phSensor[z].begin(base, base + CAL_PAIR_SIZE);
+    }
+    for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+      pinMode(ZONE_PINS[z].phAdc, INPUT);
+      pinMode(ZONE_PINS[z].ecAdc, INPUT);
+    }
+  }
+  static Task& task() { return tSampleWater; }
+  static uint32_t periodMs() { return waterRate.periodMs(); }
+};
+
+struct EnvironmentBatch { // BH1750 + BMP280, one queued I2C batch
+  static void begin() {
+    lightMeter.begin();
+    bmp.begin(0x76);
+    bmp.setSampling(Adafruit_BMP280::MODE_NORMAL,     /* Operating Mode. */
+                    Adafruit_BMP280::SAMPLING_X2,     /* Temp. oversampling */
+                    Adafruit_BMP280::SAMPLING_X16,    /* Pressure oversampling */
+                    Adafruit_BMP280::FILTER_X16,      /* Filtering. */
+                    Adafruit_BMP280::STANDBY_MS_500);
+  }
+  static Task& task() { return tI2CPoll; }
+  static uint32_t periodMs() { return envRate.periodMs(); }
+};
+
+struct WaterLevel {       // ultrasonic distance to the reservoir surface
+  static const uint8_t TRIG_PIN = 5;
+  static const uint8_t ECHO_PIN = 18;
+  static void begin() {
+    pinMode(TRIG_PIN, OUTPUT);
+    pinMode(ECHO_PIN, INPUT);
+  }
+  static Task& task() { return tCheckWaterLevel; }
+  static uint32_t periodMs() { return levelRate.periodMs(); }
+};
+
+struct AirQuality {       // CCS811, results pushed through nINT: no task of its own
+  static uint32_t periodMs() { return 10000; }  // CCS811_MEAS_MODE
+};
+
+typedef SensorTable<WaterChemistry, EnvironmentBatch, WaterLevel> Sensors;
+
+// Single-zone channels describe zone 0, "zn" carries every zone
+struct PHChannel : SensorChannel<0, 10, WaterChemistry> {
+  static const char* name() { return "pH"; }
+  static const char* unit() { return ""; }
+  static float value() { return zones.pH[0]; }
+  static float setpoint() { return zones.targetPH[0]; }
+};
+
+struct ECChannel : SensorChannel<1, 100, WaterChemistry> {
+  static const char* name() { return "EC"; }
+  static const char* unit() { return "mS/cm"; }
+  static float value() { return zones.ec[0]; }
+  static float setpoint() { return zones.targetEC[0]; }
+};
+
+struct AirTempChannel : SensorChannel<2, 10, EnvironmentBatch> {
+  static const char* name() { return "air_temperature"; }
+  static const char* unit() { return "C"; }
+  static float value() { return i2cBus.snapshot().airTemperature; }
+  static float setpoint() { return target_temperature; }
+};
+
+struct CO2Channel : SensorChannel<3, 1, AirQuality> {
+  static const char* name() { return "CO2"; }
+  static const char* unit() { return "ppm"; }
+  static float value() { return i2cBus.snapshot().eco2; }
+  static float setpoint() { return target_co2; }
+};
+
+struct LightChannel : SensorChannel<4, 1, EnvironmentBatch> {
+  static const char* name() { return "light"; }
+  static const char* unit() { return "lux"; }
+  static float value() { return i2cBus.snapshot().lux; }
+  static float setpoint() { return target_light; }
+};
+
+typedef TelemetryLayout<PHChannel, ECChannel, AirTempChannel, CO2Channel, LightChannel> Telemetry;
+
 /*********  SETUP  **********/
 void setup(void)
 {  
   Serial.begin(9600);
   Wire.begin();  // Ensure I2C is started
-
-  // pin modes
-  pinMode(WATER_PUMP_RELAY_PIN, OUTPUT);
-  digitalWrite(WATER_PUMP_RELAY_PIN, LOW); // Ensure pump is off
-  pinMode(PH_RELAY_PIN, OUTPUT);
-  digitalWrite(PH_RELAY_PIN, LOW); // Make sure it's off
-  pinMode(NUTRIENTS_RELAY_PIN, OUTPUT);
-  digitalWrite(NUTRIENTS_RELAY_PIN, LOW);
-  // pH 
-  pinMode(PH_PIN, INPUT); //
-  pinMode(EC_PIN, INPUT); // EC sensor pin
+  i2cBus.begin(I2C_CLOCK_HZ);
+  i2cBus.onRead(&onI2CRead);
+
+  // pin modes, every zone: relays off, probes in
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    pinMode(ZONE_PINS[z].pumpRelay, OUTPUT);
+    digitalWrite(ZONE_PINS[z].pumpRelay, LOW); // Ensure pump is off
+    pinMode(ZONE_PINS[z].phRelay, OUTPUT);
+    digitalWrite(ZONE_PINS[z].phRelay, LOW); // Make sure it's off
+    pinMode(ZONE_PINS[z].nutrientRelay, OUTPUT);
+    digitalWrite(ZONE_PINS[z].nutrientRelay, LOW);
+  }
+  // SD card (HSPI, pins in sd_manager.h) for the local sensor log
+  SD_init(SD_CS_PIN);
+  SD_collectHeaders();  // the request headers the web handlers read
+  if (SD_present) {
+    sensorLog.begin(SD);
+    rollups.begin(SD);
+    backlog.begin(SD);  // before the radio task starts, it owns the backlog from then on
+  }
   // ec 
-  EEPROM.begin(512);//needed EEPROM.begin to store calibration k in eeprom
-	ec.begin(0);//by default lib store calibration k since 10 change it by set ec.begin(30); to start from 30
-  phSensor.begin(32);  // pH sensor: use EEPROM start address 0
-  //
-  lightMeter.begin();
+  EEPROM.begin(CAL_EEPROM_SIZE);//needed EEPROM.begin to store calibration k in eeprom
   //co2 
   ccs811.set_i2cdelay(50); // Needed for ESP32 because it doesn't handle I2C clock stretch correctly
   ccs811.begin();
-  ccs811.start(CCS811_MODE_1SEC);
-  // echo 
-  pinMode(trig_pin, OUTPUT); // We configure the trig as output
-  pinMode(echo_pin, INPUT); // We configure the echo as input
-  //temp 
-  bmp.begin(0x76);
-  bmp.setSampling(Adafruit_BMP280::MODE_NORMAL,     /* Operating Mode. */
-                 Adafruit_BMP280::SAMPLING_X2,    /* Temp. oversampling */
-                 Adafruit_BMP280::SAMPLING_X16,   /* Pressure oversampling */
-                 Adafruit_BMP280::FILTER_X16,     /* Filtering. */
-                 Adafruit_BMP280::STANDBY_MS_500); 
+  ccs811.startInterrupt(CCS811_MEAS_MODE);
   // Add Tasks
   schedule.init();
 
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    actuators[z].begin();
+    actuators[z].setMinOffTime(ACT_WATER_PUMP, PUMP_MIN_OFF_MS);
+    actuators[z].setMinOffTime(ACT_PH_RELAY, DOSING_MIN_OFF_MS);
+    actuators[z].setMinOffTime(ACT_NUTRIENT_RELAY, DOSING_MIN_OFF_MS);
+    actuators[z].setMergeable(ACT_WATER_PUMP, true);             // circulation and pH mixing share runs
+    actuators[z].setExclusive(ACT_PH_RELAY, ACT_NUTRIENT_RELAY); // never dose acid and nutrients together
+  }
+  schedule.addTask(tPulseDone);
+  armTask(tPulseDone, srPulseDone);
+
   schedule.addTask(tStartPump);
-  schedule.addTask(tStopPump);
   
   // Enable Tasks
   tStartPump.enable(); // Start the automatic pump control task
+  // Timed acid/nutrient shots stay off: pH and EC are closed-loop (tPHDosing, tNutrients)
   schedule.addTask(tStartPH);
-  schedule.addTask(tStopPH);
-  tStartPH.enable();
-  
   schedule.addTask(tStartNutrients);
-  schedule.addTask(tStopNutrients);
-  tStartNutrients.enable();
+  Sensors::begin(schedule);  // probes, I2C batch and level sensor with their sampling tasks
     // Add the new pH reading task
   schedule.addTask(tReadPH);
   tReadPH.enable(); // Enable the pH reading task
 
   schedule.addTask(tECCalibration);
-  tECCalibration.enable();
+  armTask(tECCalibration, srECCalibration, EC_CALIBRATION_INTERVAL, TASK_FOREVER);
 
   schedule.addTask(tPHCalibration);
-  tPHCalibration.enable();
+  armTask(tPHCalibration, srPHCalibration, PH_CALIBRATION_INTERVAL, TASK_FOREVER);
 
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    zones.targetPH[z] = DEFAULT_TARGET_PH;
+    zones.targetEC[z] = DEFAULT_TARGET_EC;
+    phControl[z].setTarget(zones.targetPH[z]);
+    ecControl[z].setTarget(zones.targetEC[z]);
+  }
   schedule.addTask(tPHDosing);
-  tPHDosing.enable();
-  schedule.addTask(tPHVarUpdate);
-  tPHVarUpdate.enable();
+  armTask(tPHDosing, srPHDose);
   schedule.addTask(tNutrients);
-  tNutrients.enable();
-  schedule.addTask(tReadCO2);
-  tReadCO2.enable();
-  schedule.addTask(tCheckWaterLevel);
-  tCheckWaterLevel.enable();
+  armTask(tNutrients, srECDose);
+  schedule.addTask(tI2CBus);   // enabled by tI2CPoll when a batch is queued
   schedule.addTask(tManualCommands);
-  tManualCommands.enable();
-  schedule.addTask(tReadLight);
-  tReadLight.enable();
-  schedule.addTask(tReadBMP280);
-  tReadBMP280.enable();
+  armTask(tManualCommands, srCommandInput);
+  schedule.addTask(tRadioCommands);
+  armTask(tRadioCommands, srRadioCommand);
 
   schedule.addTask(tSendTelemetry);
   tSendTelemetry.enable();
+  schedule.addTask(tTaskStats);
+  tTaskStats.enable();
+  schedule.addTask(tLogFlush);
+  armTask(tLogFlush, srLogFlush);
+  schedule.addTask(tLogQuery);
 
   delay(500); // Allow sensor to initialize
   if (!rakModule.begin()) {
         Serial.println("Halting: RAK Module initialization failed.");
         while (1);
     }
+    radioLock = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(radioTask, "radio", RADIO_TASK_STACK, NULL,
+                            RADIO_TASK_PRIORITY, &radioTaskHandle, RADIO_TASK_CORE);
+
+    // Wake on console or RAK RX, the CCS811 result line, or the next deadline
+    idleSleep.addUart(UART_NUM_0);
+    idleSleep.addListenPin(RAK_RX_PIN);
+    idleSleep.addWakePin(CCS811_NINT_PIN);
+    for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+      idleSleep.holdPin(ZONE_PINS[z].pumpRelay);
+      idleSleep.holdPin(ZONE_PINS[z].phRelay);
+      idleSleep.holdPin(ZONE_PINS[z].nutrientRelay);
+    }
+    bool webServer = startWebServer();
+    idleSleep.setEnabled(IDLE_SLEEP_ENABLED && !webServer);
+    idleSleep.begin();
+    sendSensorSchema();  // the hub decodes "sv"/"ss" with it
     Serial.println("System Setup Complete. Ready.");
 }
 
 void loop(void)
 {
   //Modecheck(); // Check and set the mode based on ManualMode flag
-  temperature = getWaterTemperature(); // Use your thermocouple function
-  updateVarPH();
-  pH_calibrattion_inwater();
-  voltage = analogRead(EC_PIN) / 4095.0 * 3.3; // ESP32 ADC: 0-4095, 0-3.3V
-  ecValue = ec.readEC(voltage, temperature);
-  // Serial.print("EC Value: ");
-  // Serial.println(ecValue, 4); 
+  // Only raise events here; the tasks waiting on them do the work
+  checkCO2DataReady(); // flag set from the CCS811 nINT interrupt, no bus access
+  if (Serial.available()) srCommandInput.signalComplete();
+  if (!commandQueue.empty()) srRadioCommand.signalComplete(); // filled by the radio task
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {  // relay timers
+    if (pumpPulse[z].done() || phPulse[z].done() || nutrientPulse[z].done()) srPulseDone.signalComplete();
+  }
+
+  if (!schedule.execute()) {
+    schedulerWakeups++;
+  } else {
+    idleUntilNextTask();  // execute() returns true on an idle pass
+  }
+}
+
+/*********  Task Implementations  **********/
+// Wi-Fi joins in the background (and rejoins after a drop); the routes are
+// served from the loop, next to the SD log they read
+bool startWebServer() {
+  if (strlen(WIFI_SSID) == 0) {
+    Serial.println("Web: no Wi-Fi SSID set, SD pages off.");
+    return false;
+  }
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  SD_routes();
+  server.begin();  // after SD_collectHeaders()
+  schedule.addTask(tWebServer);
+  tWebServer.enable();
+  return true;
+}
+
+void serviceWebServer() {
+  static bool announced = false;
+  if (!announced && WiFi.status() == WL_CONNECTED) {
+    announced = true;
+    MDNS.begin(servername);
+    Log.print("Web: SD pages at http://");
+    Log.print(WiFi.localIP().toString());
+    Log.println("/");
+  }
+  server.handleClient();
+}
+
+// Re-park an event-triggered task; it runs again once the event is signalled
+void armTask(Task& task, StatusRequest& event, unsigned long interval, long iterations) {
+  event.setWaiting();
+  task.waitFor(&event, interval, iterations);
+}
+
+void processCommandInput() {
   if (ManualMode) {
     // When in manual mode, only process manual commands.
     processManualCommands();
@@ -507,77 +863,329 @@ void loop(void)
     // When not in manual mode, process the usual serial commands.
     processSerialCommands();
   }
-  // Check for and process commands from RPi
-String rpiCommandJson = rakModule.checkForReceivedMessage();
-if (rpiCommandJson.length() > 0 && !(rpiCommandJson.startsWith("HEX_") && rpiCommandJson.endsWith("ERROR"))) {
-    processRPiCommand(rpiCommandJson);
+  armTask(tManualCommands, srCommandInput);
 }
 
-  schedule.execute();
+void processRadioCommands() {
+  // Commands from the RPi, received and validated by the radio task
+  RadioCommand command;
+  while (commandQueue.pop(command)) {
+    processRPiCommand(String(command.json));
+  }
+  armTask(tRadioCommands, srRadioCommand);
+}
+
+void reportTaskStats() {
+  wakeupsPerMinute = schedulerWakeups;
+  schedulerWakeups = 0;
+  uint64_t asleep = idleSleep.asleepMs();
+  asleepPermille = (asleep - lastAsleepMs) * 1000 / tTaskStats.getInterval();
+  if (asleepPermille > 1000) asleepPermille = 1000;
+  lastAsleepMs = asleep;
+  Log.print("Scheduler: ");
+  Log.print(wakeupsPerMinute);
+  Log.print(" task wakeups/min, asleep ");
+  Log.print(asleepPermille / 10.0, 1);
+  Log.println("%");
+  Log.print("Sample periods: water ");
+  Log.print(waterRate.periodMs() / 1000.0, 1);
+  Log.print(" s, env ");
+  Log.print(envRate.periodMs() / 1000.0, 1);
+  Log.print(" s, level ");
+  Log.print(levelRate.periodMs() / 1000.0, 1);
+  Log.print(" s, telemetry ");
+  Log.print(telemetryRate.periodMs() / 1000.0, 1);
+  Log.println(" s");
+  if (sensorLog.active()) {
+    Log.print("SD log: ");
+    Log.print(sensorLog.records());
+    Log.print(" records, ");
+    Log.print(sensorLog.blocksWritten());
+    Log.print(" blocks in ");
+    Log.print(sensorLog.writes());
+    Log.print(" writes, ");
+    if (sensorLog.recordsWritten() > 0) {
+      Log.print((float)sensorLog.blocksWritten() * LOG_BLOCK_SIZE / sensorLog.recordsWritten(), 2);
+      Log.print(" bytes/record, ");
+    }
+    Log.print("dropped ");
+    Log.print(sensorLog.dropped());
+    Log.print(", write errors ");
+    Log.println(sensorLog.writeErrors());
+    Log.print("Rollups: ");
+    Log.print(rollups.bucketsWritten());
+    Log.print(" buckets written, dropped ");
+    Log.print(rollups.dropped());
+    Log.print(", write errors ");
+    Log.println(rollups.writeErrors());
+  }
+  Log.print("Uplink backlog: ");
+  Log.print(backlog.queued());
+  Log.print(" queued, ");
+  Log.print(backlog.stored());
+  Log.print(" stored, ");
+  Log.print(backlog.replayed());
+  Log.print(" replayed, ");
+  Log.print(backlog.dropped());
+  Log.print(" dropped, link ");
+  Log.println(backlog.linkUp() ? "up" : "down");
+}
+
+// Only touch the interval on a change, setInterval() also restarts the delay
+void applyRate(Task& task, uint32_t periodMs) {
+  if (task.getInterval() != periodMs) task.setInterval(periodMs);
+}
+
+// {"w":[min_s,max_s], "e":[...], "l":[...], "t":[...]} from the hub
+void applyRateConfig(JsonObjectConst config) {
+  struct { const char* key; AdaptiveRate& rate; } rates[] = {
+    {"w", waterRate}, {"e", envRate}, {"l", levelRate}, {"t", telemetryRate}
+  };
+  for (auto& entry : rates) {
+    JsonArrayConst limits = config[entry.key];
+    if (limits.isNull() || limits.size() < 2) continue;
+    entry.rate.setLimits(limits[0].as<uint32_t>() * 1000, limits[1].as<uint32_t>() * 1000);
+    Log.print("Sampling ");
+    Log.print(entry.key);
+    Log.print(": ");
+    Log.print(entry.rate.minMs() / 1000);
+    Log.print("-");
+    Log.print(entry.rate.maxMs() / 1000);
+    Log.println(" s");
+  }
+}
+
+// [id, hold_s, code...] adds or replaces a rule, [id] removes it
+void applyAlertRule(JsonArrayConst rule) {
+  if (rule.isNull() || rule.size() == 0) return;
+  uint8_t id = rule[0].as<uint8_t>();
+  if (rule.size() == 1) {
+    Log.print("Alert rule ");
+    Log.print(id);
+    Log.println(alerts.removeRule(id) ? " removed" : " not found");
+    uplinkAlerts();
+    return;
+  }
+  int32_t code[ALERT_MAX_CODE];
+  size_t len = rule.size() - 2;
+  if (len > ALERT_MAX_CODE) len = 0;  // too long, setRule refuses an empty program
+  for (size_t i = 0; i < len; i++) code[i] = rule[i + 2].as<int32_t>();
+  bool ok = alerts.setRule(id, rule[1].as<uint16_t>(), code, len);
+  Log.print("Alert rule ");
+  Log.print(id);
+  Log.println(ok ? " set" : " rejected (bad code or no free slot)");
+  uplinkAlerts();
+}
+
+// Samples are buffered in RAM; the flush task only runs once a write is worth it
+void logSample(AlertSignal signal, uint8_t zone, float value) {
+  if (!sensorLog.active()) return;
+  unsigned long now = millis();
+  sensorLog.append(signal, zone, value, now);
+  if (sensorLog.hasEpoch()) rollups.add(signal, zone, (int32_t)lroundf(value * 1000), sensorLog.epoch(now), now);
+  if (sensorLog.flushDue(now) || rollups.flushDue(now)) srLogFlush.signalComplete();
+}
+
+void flushSensorLog() {
+  if (sensorLog.flush(millis()) == 0 && sensorLog.flushDue(millis())) {
+    Log.println("SD log: write failed, blocks kept in RAM.");
+  }
+  if (rollups.flush(millis()) == 0 && rollups.flushDue(millis())) {
+    Log.println("Rollups: write failed, buckets kept in RAM.");
+  }
+  armTask(tLogFlush, srLogFlush);
+}
+
+// "QUERY <from> <to> [signal] [zone]", epoch s: logged samples as CSV lines
+void startLogQuery(const String& cmd) {
+  unsigned long from, to;
+  unsigned int signal = LOG_QUERY_ANY, zone = LOG_QUERY_ANY;
+  if (!SD_present || sscanf(cmd.c_str() + 5, "%lu %lu %u %u", &from, &to, &signal, &zone) < 2) {
+    Log.println("QUERY: needs an SD card and <from> <to> [signal] [zone]");
+    return;
+  }
+  serialQuery.begin(SD, from, to, signal, zone);
+  Log.println(LOG_QUERY_CSV_HEADER);
+  tLogQuery.enable();
+}
+
+void streamLogQuery() {
+  if (!logQueue.empty()) return;  // drained at UART speed by the radio task
+  LogRecord record;
+  char line[LOG_QUERY_CSV_LEN];
+  for (uint8_t i = 0; i < LOG_QUERY_LINES_PER_PASS; i++) {
+    if (!serialQuery.next(record)) {
+      Log.print("QUERY: ");
+      Log.print(serialQuery.matched());
+      Log.print(" samples from ");
+      Log.print(serialQuery.blocksRead());
+      Log.println(" blocks");
+      tLogQuery.disable();
+      return;
+    }
+    LogQuery::formatCsv(line, sizeof(line), record);
+    Log.println(line);
+  }
+}
+
+void feedAlert(AlertSignal signal, float value, float ratePerMin) {
+  alerts.sample(signal, value, ratePerMin, millis());
+  if (alerts.pending()) uplinkAlerts();
+}
+
+// Pending transitions as {"i":"R1","al":[[id, 1 fired / 0 cleared, value * 1000], ...]}.
+// Events leave the engine only once their frame is queued for the radio.
+void uplinkAlerts() {
+  while (alerts.pending()) {
+    StaticJsonDocument<200> doc;
+    doc["i"] = "R1";
+    JsonArray events = doc["al"].to<JsonArray>();
+    AlertEvent event;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < ALERTS_PER_FRAME; i++) {
+      if (!alerts.peekEvent(event, i)) break;
+      JsonArray entry = events.add<JsonArray>();
+      entry.add(event.id);
+      entry.add(event.active ? 1 : 0);
+      entry.add(event.value);
+      count++;
+    }
+    if (!queueFrame(doc)) return;  // radio busy, retried on the next sample
+    for (uint8_t i = 0; i < count; i++) alerts.popEvent();
+    Log.print("Alerts: ");
+    Log.print(count);
+    Log.println(" transition(s) queued for uplink");
+  }
+}
+
+// Channel layout for the hub, slot order: {"i":"R1","sc":[[name, scale, unit, period_s], ...]}
+void sendSensorSchema() {
+  StaticJsonDocument<256> doc;
+  doc["i"] = "R1";
+  Telemetry::describe(doc["sc"].to<JsonArray>());
+  if (!queueFrame(doc)) Log.println("Schema: frame not queued.");
+}
+
+// Every uplink frame carries its number ("q") and, once the hub clock is known,
+// its time ("ts"): the hub acks by number and files replayed frames by time.
+bool queueFrame(JsonDocument& doc) {
+  doc["q"] = frameSeq;
+  uint32_t ts = sensorLog.epoch(millis());
+  if (ts) doc["ts"] = ts;
+  TelemetryFrame frame;
+  frame.seq = frameSeq;
+  size_t len = serializeJson(doc, frame.json, sizeof(frame.json));
+  if (len == 0 || len >= sizeof(frame.json) - 1) {
+    Log.println("Uplink: frame too long, skipped.");
+    return false;
+  }
+  if (!telemetryQueue.push(frame)) return false;
+  frameSeq++;
+  return true;
+}
+
+// Light sleep until the earliest periodic task deadline, unless anything
+// is still in flight between the cores or waiting on a UART.
+void idleUntilNextTask() {
+  if (!idleSleep.enabled()) return;
+  if (Serial.available() || RAK_SERIAL_PORT_HW.available()) return;
+  if (ccs811.dataReady()) return;
+  // esp_timer does not wake the chip, stay up while a dose is timed
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    if (actuators[z].timedRunActive()) return;
+  }
+  // Not while the radio task is in a pass; it cannot start one until we are awake
+  if (xSemaphoreTake(radioLock, 0) != pdTRUE) return;
+  if (!commandQueue.empty() || !telemetryQueue.empty() || !logQueue.empty()) {
+    xSemaphoreGive(radioLock);
+    return;
+  }
+
+  long next = -1;
+  for (Task* task : scheduledTasks) {
+    long due = schedule.timeUntilNextIteration(*task);  // -1: disabled or waiting on an event
+    if (due >= 0 && (next < 0 || due < next)) next = due;
+  }
+  if (next < 0) next = IDLE_SLEEP_MAX_MS;
+
+  uint32_t slept = idleSleep.sleep(next);
+  xSemaphoreGive(radioLock);
+  if (slept > 0 && idleSleep.lastWakeCause() == ESP_SLEEP_WAKEUP_GPIO) {
+    ccs811.pollLine();  // the falling edge may have come while the CPU was stopped
+  }
 }
 
-/*********  Task Implementations  **********/
 void processManualCommands() {
   if (ManualMode){
   // Process Serial manual commands
   if (Serial.available()) {
     String cmd = Serial.readStringUntil('\n');
     cmd.trim();
-    Serial.print("Manual Serial cmd: ");
-    Serial.println(cmd);
+    Log.print("Manual Serial cmd: ");
+    Log.println(cmd);
+    int zone = commandZone(cmd);  // relay and calibration commands take an optional zone: "PUMP_ON 1"
         // EC Calibration and pH calibration commands
         // Mode switching commands
-    if (cmd.equalsIgnoreCase("MANUAL")) {
+    if (zone < 0) {
+      Log.println("Manual: no such zone.");
+    }
+    else if (cmd.equalsIgnoreCase("MANUAL")) {
       ManualMode = true;
-      Serial.println("Switching to MANUAL mode.");
+      Log.println("Switching to MANUAL mode.");
       Modecheck();
     } 
     else if (cmd.equalsIgnoreCase("AUTO")) {
       ManualMode = false;
-      Serial.println("Switching to AUTOMATIC mode.");
+      Log.println("Switching to AUTOMATIC mode.");
       Modecheck();
     }    
     else if (cmd.equalsIgnoreCase("CAL_EC")) {
       ecCalibrationRequested = true;
-      tECCalibration.enable();
+      srECCalibration.signalComplete();
+      ecCalZone = zone;
+      ec[zone].startCalibration();
       ecCalStep = 1;  // Start with low-point calibration
       ecCalibrationStartTime = millis();
-      Serial.println("EC Calibration initiated. Please put the sensor in the LOW calibration solution.");
+      logZone(zone);
+      Log.println("EC Calibration initiated. Please put the sensor in the LOW calibration solution.");
     } 
     else if (cmd.equalsIgnoreCase("CALPH")) {
       phCalibrationRequested = true;
-      tPHCalibration.enable();
+      srPHCalibration.signalComplete();
+      phCalZone = zone;
+      phSensor[zone].startCalibration();
       phCalStep = 1;  // Start with acid calibration (pH ~4)
       phCalibrationStartTime = millis();
-      Serial.println("pH Calibration initiated. Please put the probe into the ACID solution (pH ~4.0).");
+      logZone(zone);
+      Log.println("pH Calibration initiated. Please put the probe into the ACID solution (pH ~4.0).");
     } 
     
     else if (cmd.equalsIgnoreCase("PUMP_ON")) {
-      digitalWrite(WATER_PUMP_RELAY_PIN, HIGH);
-      Serial.println("Manual: Water pump turned ON.");
+      actuators[zone].request(ACT_WATER_PUMP, SRC_MANUAL, 0);
+      Log.println("Manual: Water pump turned ON.");
     }
     else if (cmd.equalsIgnoreCase("PUMP_OFF")) {
-      digitalWrite(WATER_PUMP_RELAY_PIN, LOW);
-      Serial.println("Manual: Water pump turned OFF.");
+      actuators[zone].release(ACT_WATER_PUMP, SRC_MANUAL);
+      Log.println("Manual: Water pump turned OFF.");
     }
     else if (cmd.equalsIgnoreCase("PH_ON")) {
-      digitalWrite(PH_RELAY_PIN, HIGH);
-      Serial.println("Manual: pH relay activated.");
+      actuators[zone].request(ACT_PH_RELAY, SRC_MANUAL, 0);
+      Log.println("Manual: pH relay activated.");
     }
     else if (cmd.equalsIgnoreCase("PH_OFF")) {
-      digitalWrite(PH_RELAY_PIN, LOW);
-      Serial.println("Manual: pH relay deactivated.");
+      actuators[zone].release(ACT_PH_RELAY, SRC_MANUAL);
+      Log.println("Manual: pH relay deactivated.");
     }
     else if (cmd.equalsIgnoreCase("NUT_ON")) {
-      digitalWrite(NUTRIENTS_RELAY_PIN, HIGH);
-      Serial.println("Manual: Nutrient relay activated.");
+      actuators[zone].request(ACT_NUTRIENT_RELAY, SRC_MANUAL, 0);
+      Log.println("Manual: Nutrient relay activated.");
     }
     else if (cmd.equalsIgnoreCase("NUT_OFF")) {
-      digitalWrite(NUTRIENTS_RELAY_PIN, LOW);
-      Serial.println("Manual: Nutrient relay deactivated.");
+      actuators[zone].release(ACT_NUTRIENT_RELAY, SRC_MANUAL);
+      Log.println("Manual: Nutrient relay deactivated.");
     }
     else {
-      Serial.println("Manual: Unknown serial command.");
+      Log.println("Manual: Unknown serial command.");
     }
   }
   
@@ -589,35 +1197,39 @@ void processManualCommands() {
       loraCmd += (char) LoRa.read();
     }
     loraCmd.trim();
-    Serial.print("Manual LoRa cmd: ");
-    Serial.println(loraCmd);
+    Log.print("Manual LoRa cmd: ");
+    Log.println(loraCmd);
+    int zone = commandZone(loraCmd);
     
-    if (loraCmd.equalsIgnoreCase("PUMP_ON")) {
-      digitalWrite(WATER_PUMP_RELAY_PIN, HIGH);
-      Serial.println("Manual: Water pump turned ON via LoRa.");
+    if (zone < 0) {
+      Log.println("Manual: no such zone.");
+    }
+    else if (loraCmd.equalsIgnoreCase("PUMP_ON")) {
+      actuators[zone].request(ACT_WATER_PUMP, SRC_MANUAL, 0);
+      Log.println("Manual: Water pump turned ON via LoRa.");
     }
     else if (loraCmd.equalsIgnoreCase("PUMP_OFF")) {
-      digitalWrite(WATER_PUMP_RELAY_PIN, LOW);
-      Serial.println("Manual: Water pump turned OFF via LoRa.");
+      actuators[zone].release(ACT_WATER_PUMP, SRC_MANUAL);
+      Log.println("Manual: Water pump turned OFF via LoRa.");
     }
     else if (loraCmd.equalsIgnoreCase("PH_ON")) {
-      digitalWrite(PH_RELAY_PIN, HIGH);
-      Serial.println("Manual: pH relay activated via LoRa.");
+      actuators[zone].request(ACT_PH_RELAY, SRC_MANUAL, 0);
+      Log.println("Manual: pH relay activated via LoRa.");
     }
     else if (loraCmd.equalsIgnoreCase("PH_OFF")) {
-      digitalWrite(PH_RELAY_PIN, LOW);
-      Serial.println("Manual: pH relay deactivated via LoRa.");
+      actuators[zone].release(ACT_PH_RELAY, SRC_MANUAL);
+      Log.println("Manual: pH relay deactivated via LoRa.");
     }
     else if (loraCmd.equalsIgnoreCase("NUT_ON")) {
-      digitalWrite(NUTRIENTS_RELAY_PIN, HIGH);
-      Serial.println("Manual: Nutrient relay activated via LoRa.");
+      actuators[zone].request(ACT_NUTRIENT_RELAY, SRC_MANUAL, 0);
+      Log.println("Manual: Nutrient relay activated via LoRa.");
     }
     else if (loraCmd.equalsIgnoreCase("NUT_OFF")) {
-      digitalWrite(NUTRIENTS_RELAY_PIN, LOW);
-      Serial.println("Manual: Nutrient relay deactivated via LoRa.");
+      actuators[zone].release(ACT_NUTRIENT_RELAY, SRC_MANUAL);
+      Log.println("Manual: Nutrient relay deactivated via LoRa.");
     }
     else {
-      Serial.println("Manual: Unknown LoRa command received.");
+      Log.println("Manual: Unknown LoRa command received.");
     }
   }
 }
@@ -625,293 +1237,491 @@ void processManualCommands() {
 
 //test water 
 void StartPump() {
-  if (!ManualMode && !f_WaterPumpOn ) {  // circulating water in ph 
-    digitalWrite(WATER_PUMP_RELAY_PIN, HIGH); // REVERSE LOGIC FOR RELAYS 
-    Serial.println("Automatic: Scheduled Water pump activated");
-    tStopPump.restartDelayed(); // Schedule stop after 10 seconds
-    f_WaterPumpOn= true;
+  if (ManualMode) return;
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {  // circulating water in ph; merges into a mixing run already going
+    if (requestActuator(z, ACT_WATER_PUMP, SRC_SCHEDULE, pumpOffInterval)) {
+      logZone(z);
+      Log.println("Automatic: Scheduled Water pump activated");
+    }
   }
 }
 
+// Stop* run after the pulse timer already switched the relay off
 void StopPump() {
-  digitalWrite(WATER_PUMP_RELAY_PIN, LOW);
-  Serial.println("Automatic: Scheduled Water pump deactivated");
-  f_WaterPumpOn= false;
+  Log.println("Automatic: Scheduled Water pump deactivated");
 }
 
 void StartPH() {
-  if (!ManualMode && !f_ShotpH) {
-    digitalWrite(PH_RELAY_PIN, HIGH); // Assuming reverse logic relay
-    Serial.println("Automatic: Scheduled pH tank relay activated");
-    f_ShotpH = true;
-    tStopPH.restartDelayed();
+  if (ManualMode) return;
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    if (zones.phState[z] == PH_IDLE && requestActuator(z, ACT_PH_RELAY, SRC_SCHEDULE, scheduledPHShot)) {
+      logZone(z);
+      Log.println("Automatic: Scheduled pH tank relay activated");
+    }
   }
 }
 
 void StopPH() {
-  digitalWrite(PH_RELAY_PIN, LOW);
-  Serial.println("Automatic: Scheduled pH tank relay deactivated");
-  f_ShotpH = false;
+  Log.println("Automatic: Scheduled pH tank relay deactivated");
 }
 
 void StartNutrients() {
-  if (!ManualMode && !f_NutrientsActive) {
-    digitalWrite(NUTRIENTS_RELAY_PIN, HIGH);
-    Serial.println("Automatic: Scheduled Nutrients tank relay activated");
-    f_NutrientsActive = true;
-    tStopNutrients.restartDelayed();
+  if (ManualMode) return;
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    if (zones.nutrientState[z] == NUTRIENT_IDLE && requestActuator(z, ACT_NUTRIENT_RELAY, SRC_SCHEDULE, scheduledNutrientShot)) {
+      logZone(z);
+      Log.println("Automatic: Scheduled Nutrients tank relay activated");
+    }
   }
 }
 
 void StopNutrients() {
-  digitalWrite(NUTRIENTS_RELAY_PIN, LOW);
-  Serial.println("Automatic: Scheduled Nutrients tank relay deactivated");
-  f_NutrientsActive = false;
+  Log.println("Automatic: Scheduled Nutrients tank relay deactivated");
+}
+
+// A relay run ended: log it and hand over to every source that shared it.
+// The dosing state machines continue in their zone on the next pass.
+void handlePulseDone() {
+  uint8_t sources;
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    ActuatorManager& zoneActuators = actuators[z];
+    if (zoneActuators.takeDone(ACT_PH_RELAY, sources)) {
+      logPulse(z, zoneActuators.relay(ACT_PH_RELAY));
+      if ((sources & SRC_MASK(SRC_CONTROL)) && zones.phState[z] == PH_DOSING) zones.phWake |= ZONE_BIT(z);
+      if (sources & SRC_MASK(SRC_SCHEDULE)) StopPH();
+    }
+    if (zoneActuators.takeDone(ACT_WATER_PUMP, sources)) {
+      logPulse(z, zoneActuators.relay(ACT_WATER_PUMP));
+      if ((sources & SRC_MASK(SRC_CONTROL)) && zones.phState[z] == PH_MIXING) zones.phWake |= ZONE_BIT(z);
+      if (sources & SRC_MASK(SRC_SCHEDULE)) StopPump();
+    }
+    if (zoneActuators.takeDone(ACT_NUTRIENT_RELAY, sources)) {
+      logPulse(z, zoneActuators.relay(ACT_NUTRIENT_RELAY));
+      if ((sources & SRC_MASK(SRC_CONTROL)) && zones.nutrientState[z] == NUTRIENT_DOSING) zones.nutrientWake |= ZONE_BIT(z);
+      if (sources & SRC_MASK(SRC_SCHEDULE)) StopNutrients();
+    }
+  }
+  if (zones.phWake) srPHDose.signalComplete();
+  if (zones.nutrientWake) srECDose.signalComplete();
+  armTask(tPulseDone, srPulseDone);
+}
+
+// Ask the zone's actuator manager for a run; refusals are logged, merges count as granted
+// Refusal last logged per zone, actuator and source (ACT_STARTED: none). The
+// dosing loops ask again on every sample while a dose is due, so a refusal
+// is logged when it starts or its reason changes, not on each retry.
+static ActuatorResult loggedRefusal[ZONE_COUNT][ACT_COUNT][SRC_COUNT];
+
+bool requestActuator(uint8_t zone, Actuator act, ActuatorSource source, uint32_t ms, ActuatorResult* outcome) {
+  ActuatorResult result = actuators[zone].request(act, source, ms);
+  if (outcome) *outcome = result;
+  ActuatorResult& logged = loggedRefusal[zone][act][source];
+  if (result == ACT_STARTED || result == ACT_MERGED) {
+    logged = ACT_STARTED;
+    return true;
+  }
+  if (result == logged) return false;
+  logged = result;
+  logZone(zone);
+  Log.print(actuators[zone].relay(act).name());
+  switch (result) {
+    case ACT_BUSY:        Log.println(": request refused, held by a higher source"); break;
+    case ACT_MIN_OFF:     Log.println(": request refused, minimum off-time"); break;
+    case ACT_INTERLOCKED: Log.println(": request refused, interlocked"); break;
+    default:              Log.println(": request refused"); break;
+  }
+  return false;
+}
+
+void logPulse(uint8_t zone, const RelayPulse& pulse) {
+  logZone(zone);
+  Log.print("Pulse ");
+  Log.print(pulse.name());
+  if (pulse.requestedMs() == 0) {
+    Log.print(": latched, on for ");
+  } else {
+    Log.print(": requested ");
+    Log.print(pulse.requestedMs());
+    Log.print(" ms, actual ");
+  }
+  Log.print(pulse.actualMs(), 1);
+  Log.println(" ms");
+}
+
+// "Zone n: " in front of per-zone log lines, nothing on a single-zone build
+void logZone(uint8_t zone) {
+  if (ZONE_COUNT == 1) return;
+  Log.print("Zone ");
+  Log.print(zone);
+  Log.print(": ");
+}
+
+// Strips a trailing " <zone>" from a command; 0 without one, -1 when out of range
+int commandZone(String& cmd) {
+  int space = cmd.lastIndexOf(' ');
+  if (space < 0) return 0;
+  String arg = cmd.substring(space + 1);
+  cmd = cmd.substring(0, space);
+  cmd.trim();
+  if (arg.length() == 0 || !isDigit(arg[0])) return -1;
+  int zone = arg.toInt();
+  return zone < ZONE_COUNT ? zone : -1;
 }
 //ph 
 void phCalibrationTask() {
   if (phCalibrationRequested) {
-    // Abort if timeout:
+    // Abort if timeout, unless only an optional buffer is left:
     if (millis() - phCalibrationStartTime > PH_CALIBRATION_TIMEOUT) {
-      Serial.println("pH Calibr_ation timeout. Calibration aborted.");
+      if (phSensor[phCalZone].calibrationPoints() >= 2) {
+        Log.println("pH Calibration timeout on an optional buffer. Saving the points captured.");
+        finishPHCalibration();
+        return;
+      }
+      Log.println("pH Calibr_ation timeout. Calibration aborted.");
       phCalStep = 0;
       phCalibrationRequested = false;
+      armTask(tPHCalibration, srPHCalibration, PH_CALIBRATION_INTERVAL, TASK_FOREVER);
       return;
     }
     // Use the library's readPH; you can base the calibration step on the measured pH.
-    float voltagePH = analogRead(PH_PIN) / 4095.0 * 3300;
-    float currentPH = phSensor.readPH(voltagePH, temperature);
-    Serial.print("Auto pH Calibration, Step ");
-    Serial.print(phCalStep);
-    Serial.print(" | pH reading: ");
-    Serial.println(currentPH, 4);
-
-    if (phCalStep == 1) {
-      // Wait for acid solution: expecting around pH 4.0 (adjust threshold as necessary)
-      if (currentPH > 0.3 && currentPH < 0.5) {
-        // Issue the library command for acid calibration (the library “CALPH” command sets acid voltage)
-        char acidCalCmd[] = "CALPH";
-        phSensor.calibration(voltagePH, temperature, acidCalCmd);
-        Serial.println("Acid calibration successful. Please now put the probe into the NEUTRAL solution (pH ~7.0).");
-        phCalStep = 2;
+    float voltagePH = analogRead(ZONE_PINS[phCalZone].phAdc) / 4095.0 * 3300;
+    float currentPH = phSensor[phCalZone].readPH(voltagePH, temperature);
+    logZone(phCalZone);
+    Log.print("Auto pH Calibration, Step ");
+    Log.print(phCalStep);
+    Log.print(" | pH reading: ");
+    Log.println(currentPH, 4);
+
+    const CalibrationStep& step = PH_CAL_STEPS[phCalStep - 1];
+    if (currentPH > step.readingLow && currentPH < step.readingHigh) {
+      phSensor[phCalZone].addCalibrationPoint(voltagePH, step.buffer);
+      Log.print("pH ");
+      Log.print(step.buffer, 1);
+      Log.println(" calibration point captured.");
+      if (phCalStep < PH_CAL_STEP_COUNT) {
+        phCalStep++;
         phCalibrationStartTime = millis();
+        Log.print("Please now put the probe into the pH ");
+        Log.print(PH_CAL_STEPS[phCalStep - 1].buffer, 1);
+        Log.println(" solution.");
       } else {
-        Serial.println("Waiting for sensor in ACID calibration solution (pH ~4.0)...");
+        finishPHCalibration();
       }
+    } else {
+      Log.print("Waiting for sensor in pH ");
+      Log.print(step.buffer, 1);
+      Log.println(" calibration solution...");
     }
-    else if (phCalStep == 2) {
-      // Wait for neutral solution: expecting around pH 7.0
-      if (currentPH > 2 && currentPH < 2.5) {
-        // Use "EXITPH" to save the calibration and exit
-        char neutreCalCmd[] = "EXITPH";
-        phSensor.calibration(voltagePH, temperature, neutreCalCmd);
-        Serial.println("Neutral calibration successful. pH Calibration complete.");
-        phCalStep = 0;
-        phCalibrationRequested = false;
-        tPHCalibration.enable();
+  }
+}
 
-      } else {
-        Serial.println("Waiting for sensor in NEUTRAL calibration solution (pH ~7.0)...");
-      }
-    }
+void finishPHCalibration() {
+  // Precompute the segment table once, reads then stay constant cost
+  byte points = phSensor[phCalZone].calibrationPoints();
+  logZone(phCalZone);
+  if (phSensor[phCalZone].saveCalibration()) {
+    Log.print("pH Calibration complete, ");
+    Log.print(points);
+    Log.println(" point table saved.");
+  } else {
+    Log.println("pH Calibration failed: buffer readings not usable.");
   }
+  phCalStep = 0;
+  phCalibrationRequested = false;
+  armTask(tPHCalibration, srPHCalibration, PH_CALIBRATION_INTERVAL, TASK_FOREVER);
 }
 //EC 
 
 void ecCalibration() {
   if (ecCalibrationRequested) {
-    float currentEC = ec.readEC(voltage, temperature);
-    Serial.print("Auto EC Calibration, Step ");
-    Serial.print(ecCalStep);
-    Serial.print(" | EC reading: ");
-    Serial.println(currentEC, 4);
-
-    if (ecCalStep == 1) {
-      // Waiting for low-point calibration solution (e.g., ~1.413 μS/cm)
-      if (currentEC > 1.14 && currentEC < 2.7) { // adjust thresholds as needed
-        // Trigger calibration command (the library will check _rawEC internally)
-        char calCmd[] = "CALEC";    // Use a mutable char array!
-        ec.calibration(voltage, temperature, calCmd);
-        Serial.println("Low-point calibration successful. Please now put the sensor in the high-point solution.");
-        ecCalStep = 2;  // move to high-point step
-        ecCalibrationStartTime = millis(); // Restart timeout for high-point calibration
+    float voltage = zones.ecVoltage[ecCalZone];
+    float currentEC = ec[ecCalZone].readEC(voltage, temperature);
+    logZone(ecCalZone);
+    Log.print("Auto EC Calibration, Step ");
+    Log.print(ecCalStep);
+    Log.print(" | EC reading: ");
+    Log.println(currentEC, 4);
+
+    const CalibrationStep& step = EC_CAL_STEPS[ecCalStep - 1];
+    if (currentEC > step.readingLow && currentEC < step.readingHigh) {
+      ec[ecCalZone].addCalibrationPoint(voltage, temperature, step.buffer);
+      Log.print("EC ");
+      Log.print(step.buffer, 3);
+      Log.println(" ms/cm calibration point captured.");
+      if (ecCalStep < EC_CAL_STEP_COUNT) {
+        ecCalStep++;
+        ecCalibrationStartTime = millis(); // Restart timeout for the next point
+        Log.print("Please now put the sensor in the ");
+        Log.print(EC_CAL_STEPS[ecCalStep - 1].buffer, 3);
+        Log.println(" ms/cm solution.");
       } else {
-        Serial.println("Waiting for sensor to be in LOW calibration solution...");
-      }
-    }
-    else if (ecCalStep == 2) {
-      // Waiting for high-point calibration solution (e.g., ~2.76 ms/cm; adjust as needed)
-      if (currentEC > 18 && currentEC < 20.5) {
-          char lowCalCmd[] = "CALEC";
-        ec.calibration(voltage, temperature, lowCalCmd);
-        Serial.println("High-point calibration successful.");
-        // Save calibration values and exit calibration mode
-        char exitCmd[] = "EXITEC";
-        ec.calibration(voltage, temperature, exitCmd);
-        Serial.println("EC Calibration complete and values saved.");
-        ecCalStep = 0;
-        ecCalibrationRequested = false;  // reset flag
-        tECCalibration.disable();  // Disable calibration task
-
-      } else {
-        Serial.println("Waiting for sensor to be in HIGH calibration solution...");
+        finishECCalibration();
+        return;
       }
+    } else {
+      Log.print("Waiting for sensor to be in the ");
+      Log.print(step.buffer, 3);
+      Log.println(" ms/cm calibration solution...");
     }
     // Check for timeout
     if (millis() - ecCalibrationStartTime > EC_CALIBRATION_TIMEOUT) {
-      Serial.println("EC Calibration timeout. Calibration aborted.");
+      if (ec[ecCalZone].calibrationPoints() >= 2) {
+        Log.println("EC Calibration timeout on an optional point. Saving the points captured.");
+        finishECCalibration();
+        return;
+      }
+      Log.println("EC Calibration timeout. Calibration aborted.");
       ecCalStep = 0;
       ecCalibrationRequested = false;
+      armTask(tECCalibration, srECCalibration, EC_CALIBRATION_INTERVAL, TASK_FOREVER);
       return;
     }
   }
 }
 
+void finishECCalibration() {
+  logZone(ecCalZone);
+  if (ec[ecCalZone].saveCalibration()) {
+    Log.println("EC Calibration complete and table saved.");
+  } else {
+    Log.println("EC Calibration: K values saved, not enough points for a table.");
+  }
+  ecCalStep = 0;
+  ecCalibrationRequested = false;  // reset flag
+  armTask(tECCalibration, srECCalibration, EC_CALIBRATION_INTERVAL, TASK_FOREVER);  // idle until the next CAL_EC
+}
+
+
+// Water chemistry sampling: every reading goes through its filter once,
+// controllers and telemetry only see the filtered estimates.
+void sampleWaterSensors() {
+  temperature = getWaterTemperature(); // Use your thermocouple function
+  unsigned long now = millis();
+  tempStats.add(temperature, now);
+  feedAlert(SIG_WATER_TEMP, temperature, tempStats.slopePerMin());
+  logSample(SIG_WATER_TEMP, 0, temperature);
+  waterActivity = 0;
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    sampleZone(z, now);
+  }
+  if (zones.phWake) srPHDose.signalComplete();
+  if (zones.nutrientWake) srECDose.signalComplete();
+  applyRate(tSampleWater, waterRate.update(waterActivity));
+}
+
+void sampleZone(uint8_t z, unsigned long now) {
+  float voltagePH = analogRead(ZONE_PINS[z].phAdc) / 4095.0 * 3300;
+  zones.rawPH[z] = phSensor[z].readPH(voltagePH, temperature);
+  zones.pH[z] = phFilter[z].update(zones.rawPH[z]);
+  zones.ecVoltage[z] = analogRead(ZONE_PINS[z].ecAdc) / 4095.0 * 3.3; // ESP32 ADC: 0-4095, 0-3.3V
+  zones.rawEC[z] = ec[z].readEC(zones.ecVoltage[z], temperature);
+  zones.ec[z] = ecFilter[z].update(zones.rawEC[z]);
+  if (phFilter[z].primed()) phStats[z].add(zones.pH[z], now);
+  if (ecFilter[z].primed()) ecStats[z].add(zones.ec[z], now);
+  if (phFilter[z].primed()) logSample(SIG_PH, z, zones.pH[z]);
+  if (ecFilter[z].primed()) logSample(SIG_EC, z, zones.ec[z]);
+  // Alert rules read zone 0's chemistry
+  if (z == 0 && phFilter[z].primed()) feedAlert(SIG_PH, zones.pH[z], phStats[z].slopePerMin());
+  if (z == 0 && ecFilter[z].primed()) feedAlert(SIG_EC, zones.ec[z], ecStats[z].slopePerMin());
+  if (phFilter[z].lastRejected()) {
+    logZone(z);
+    Log.print("pH outlier rejected: ");
+    Log.println(zones.rawPH[z], 4);
+  }
+  if (ecFilter[z].lastRejected()) {
+    logZone(z);
+    Log.print("EC outlier rejected: ");
+    Log.println(zones.rawEC[z], 4);
+  }
+  // Controllers only step on settled readings in auto mode; a pulse they ask
+  // for wakes the zone's dosing state machine
+  if (phFilter[z].primed()) phControl[z].observe(zones.pH[z], now, !ManualMode && phStable(z));
+  if (ecFilter[z].primed()) ecControl[z].observe(zones.ec[z], now, !ManualMode && ecSettled(z));
+  if (zones.phState[z] == PH_IDLE && phControl[z].pendingPulseMs() > 0) {
+    zones.phWake |= ZONE_BIT(z);
+  }
+  if (zones.nutrientState[z] == NUTRIENT_IDLE && ecControl[z].pendingPulseMs() > 0) {
+    zones.nutrientWake |= ZONE_BIT(z);
+  }
+
+  // Sample fast while any zone doses/mixes or while its pH or EC is still moving
+  float activity;
+  if (zones.phState[z] != PH_IDLE || zones.nutrientState[z] != NUTRIENT_IDLE || actuators[z].isOn(ACT_WATER_PUMP)) {
+    activity = 1;
+  } else {
+    activity = max(AdaptiveRate::activity(phStats[z], PH_ACTIVE_SLOPE, PH_ACTIVE_STDDEV),
+                   AdaptiveRate::activity(ecStats[z], EC_ACTIVE_SLOPE, EC_ACTIVE_STDDEV));
+  }
+  waterActivity = max(waterActivity, activity);
+}
 
 //pH 
 void ReadPHTask() {
-  float voltagePH = analogRead(PH_PIN) / 4095.0 * 3300;
-  float pHValue = phSensor.readPH(voltagePH, temperature);
-  Serial.print("Raw pH voltage (mV): ");
-Serial.println(voltagePH);
-  Serial.print("Scheduled Task: pH Value = ");
-  Serial.println(pHValue, 4);
-  Serial.print("Water temperature: ");
-  Serial.println(temperature, 2);
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    logZone(z);
+    Log.print("Raw pH: ");
+    Log.println(zones.rawPH[z], 4);
+    logZone(z);
+    Log.print("Scheduled Task: pH Value = ");
+    Log.print(zones.pH[z], 4);
+    Log.print(" (noise sd ");
+    Log.print(sqrt(phFilter[z].noiseVariance()), 4);
+    Log.print(", rejected ");
+    Log.print(phFilter[z].rejected());
+    Log.println(")");
+    logZone(z);
+    Log.print("pH window: mean ");
+    Log.print(phStats[z].mean(), 3);
+    Log.print(", sd ");
+    Log.print(phStats[z].stddev(), 4);
+    Log.print(", slope ");
+    Log.print(phStats[z].slopePerMin(), 4);
+    Log.println("/min");
+  }
+  Log.print("Water temperature: ");
+  Log.println(temperature, 2);
 }
 
 
 // --------- pH dosing & mixing state machine ---------
+// Woken by srPHDose; takes one step in every zone flagged in zones.phWake
+// (a dose was asked for, or the zone's shot or mixing pulse ended).
 void pH_calibrattion_inwater() {
-  // Read sensor voltage and calculate current pH (with temperature compensation)
-  float voltagePH = analogRead(PH_PIN) / 4095.0 * 3300;
-  float current_pH = phSensor.readPH(voltagePH, temperature);
+  uint8_t wake = zones.phWake;
+  zones.phWake = 0;
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    if (wake & ZONE_BIT(z)) stepPHDosing(z);
+  }
+  armTask(tPHDosing, srPHDose);
+}
+
+void stepPHDosing(uint8_t z) {
+  // zones.pH is the filtered reading, a single glitch no longer starts a shot
   // State machine to decide dosing and mixing without blocking delays.
-  switch (phState) {
-    case PH_IDLE:
-      // If conditions are met, initiate a dosing cycle.
-      if (!ManualMode && !f_ShotpH && (current_pH > pH_max) && (var_pH < 0.1)) {
-        digitalWrite(PH_RELAY_PIN, HIGH); // Activate acid dosing relay
-        Serial.println("Asserv Automatic: pH shot activated");
-        stateStartTime = millis();
-        phState = PH_DOSING;
-        f_ShotpH = true;  // Mark that dosing is underway
+  switch (zones.phState[z]) {
+    case PH_IDLE: {
+      // Shot length comes from the zone's pH controller, 0 when no dose is due
+      uint32_t pulse = phControl[z].pendingPulseMs();
+      if (!ManualMode && pulse > 0 &&
+          requestActuator(z, ACT_PH_RELAY, SRC_CONTROL, pulse)) { // acid dosing relay, the timer ends the shot
+        phControl[z].doseStarted(pulse, millis());
+        logZone(z);
+        Log.print("Asserv Automatic: pH shot activated, ms ");
+        Log.println(pulse);
+        zones.phStateStart[z] = millis();
+        zones.phState[z] = PH_DOSING;  // Mark that dosing is underway
       }
       break;
+    }
       
     case PH_DOSING:
-      // When dosing time has elapsed, turn off the dosing relay and start mixing.
-      if (millis() - stateStartTime >= shotDuration) {
-        digitalWrite(PH_RELAY_PIN, LOW); // Turn off dosing relay
-        Serial.println("Asserv Automatic: pH shot deactivated");
-        // Start water mixing
-        digitalWrite(WATER_PUMP_RELAY_PIN, HIGH); // Activate mixing pump
-        Serial.println("Asserv Water pump activated for pH adjustment");
-        stateStartTime = millis();  // Reset timer for mixing
-        phState = PH_MIXING;
-        f_WaterPumpOn = true;
+      // The shot pulse has ended (relay already off), start mixing.
+      logZone(z);
+      Log.println("Asserv Automatic: pH shot deactivated");
+      // Start water mixing, or extend a circulation run already going
+      if (!requestActuator(z, ACT_WATER_PUMP, SRC_CONTROL, mixDuration)) {
+        logZone(z);
+        Log.println("Asserv pH mixing skipped");
+        zones.phState[z] = PH_IDLE;
+        phStats[z].reset();
+        break;
       }
+      logZone(z);
+      Log.println("Asserv Water pump activated for pH adjustment");
+      zones.phStateStart[z] = millis();  // Reset timer for mixing
+      zones.phState[z] = PH_MIXING;
       break;
       
     case PH_MIXING:
-      // Once mixing time has elapsed, turn off the pump and reset the state.
-      if (millis() - stateStartTime >= mixDuration) {
-        digitalWrite(WATER_PUMP_RELAY_PIN, LOW); // Deactivate mixing pump
-        Serial.println("Asserv Water pump deactivated for pH adjustment");
-        f_WaterPumpOn = false;
-        // Reset state machine for next cycle
-        phState = PH_IDLE;
-        f_ShotpH = false;
-        var_pH = 0;
-      }
+      // The mixing pulse has ended (pump already off), reset the state.
+      logZone(z);
+      Log.println("Asserv Water pump deactivated for pH adjustment");
+      // Reset state machine for next cycle
+      zones.phState[z] = PH_IDLE;
+      phStats[z].reset();  // wait for a fresh settled window before the next shot
       break;
   }
 }
 
 
-// --------- pH Variation Calculation ---------
-void updateVarPH() {
-  static bool firstRun = true;
-  // Read pH sensor voltage and calculate current pH
-  float voltagePH = analogRead(PH_PIN) / 4095.0 * 3300;
-  float current_pH = phSensor.readPH(voltagePH, temperature);
-  if (firstRun) {
-    last_pH = current_pH;
-    lastVarCheck = millis();
-    firstRun = false;
-    var_pH = 0;
-    return;
-  }
-  // Update variation only when the sampling interval has passed.
-  if (millis() - lastVarCheck >= varInterval) {
-    var_pH = fabs(current_pH - last_pH);
-    last_pH = current_pH;
-    lastVarCheck = millis();
-  }
+// --------- pH stability ---------
+bool phStable(uint8_t z) {
+  return phStats[z].ready() && phStats[z].stddev() < PH_STABLE_STDDEV && fabs(phStats[z].slopePerMin()) < PH_STABLE_SLOPE;
+}
+
+bool ecSettled(uint8_t z) {
+  return ecStats[z].ready() && fabs(ecStats[z].slopePerMin()) < EC_STABLE_SLOPE;
 }
 
 float getWaterTemperature() {
   return thermocouple.readCelsius(); // returns temperature in °C
 }
 
+// Woken by srECDose; one step in every zone flagged in zones.nutrientWake
 void controlNutrients() {
-  // This function uses the ecValue variable updated in the loop
-  switch(nutrientState) {
-    case NUTRIENT_IDLE:
-      // If the nutrient level is low (EC below threshold) and pump is not already running,
-      // initiate dosing. (You could also check for a high nutrient reading to skip dosing.)
-      if (ecValue < EC_LOW_THRESHOLD && !f_NutrientsActive) {
-        digitalWrite(NUTRIENTS_RELAY_PIN, HIGH); // Activate nutrient pump (adjust logic if needed)
-        Serial.println("Nutrient: Nutrient pump activated for dosing.");
-        nutrientStateStartTime = millis();
-        nutrientState = NUTRIENT_DOSING;
-        f_NutrientsActive = true;
+  uint8_t wake = zones.nutrientWake;
+  zones.nutrientWake = 0;
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    if (wake & ZONE_BIT(z)) stepNutrients(z);
+  }
+  armTask(tNutrients, srECDose);
+}
+
+void stepNutrients(uint8_t z) {
+  // This function uses the filtered zones.ec updated by tSampleWater
+  switch(zones.nutrientState[z]) {
+    case NUTRIENT_IDLE: {
+      // Dose length comes from the zone's EC controller, 0 when EC is close enough to its target
+      uint32_t pulse = ecControl[z].pendingPulseMs();
+      if (!ManualMode && pulse > 0 &&
+          requestActuator(z, ACT_NUTRIENT_RELAY, SRC_CONTROL, pulse)) { // the timer ends the dose
+        ecControl[z].doseStarted(pulse, millis());
+        logZone(z);
+        Log.print("Nutrient: Nutrient pump activated for dosing, ms ");
+        Log.println(pulse);
+        zones.nutrientStateStart[z] = millis();
+        zones.nutrientState[z] = NUTRIENT_DOSING;
       }
       break;
+    }
 
     case NUTRIENT_DOSING:
-      // After the dosing duration, turn the pump off.
-      if (millis() - nutrientStateStartTime >= nutrientDosingDuration) {
-        digitalWrite(NUTRIENTS_RELAY_PIN, LOW); // Deactivate nutrient pump
-        Serial.println("Nutrient: Nutrient pump deactivated after dosing.");
-        nutrientState = NUTRIENT_IDLE;
-        f_NutrientsActive = false;
-      }
+      // The dosing pulse has ended, the pump is already off.
+      logZone(z);
+      Log.println("Nutrient: Nutrient pump deactivated after dosing.");
+      zones.nutrientState[z] = NUTRIENT_IDLE;
       break;
   }
 }
 
 void pauseAutomationTasks() {
   tStartPump.disable();
-  tStopPump.disable();
   tStartPH.disable();
-  tStopPH.disable();
   tStartNutrients.disable();
-  tStopNutrients.disable();
   tReadPH.disable();
-  tECCalibration.disable();
-  tPHCalibration.disable();
+  // Calibration tasks stay armed, CAL_EC/CALPH are manual-mode commands
   tPHDosing.disable();
-  tPHVarUpdate.disable();
   tNutrients.disable();
-  digitalWrite(WATER_PUMP_RELAY_PIN, LOW); 
-  digitalWrite(PH_RELAY_PIN, LOW);
-  digitalWrite(NUTRIENTS_RELAY_PIN, LOW);
-  Serial.println("Automation tasks paused.");
+  for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+    actuators[z].stopAll();
+    // A cycle cut short restarts from idle
+    zones.phState[z] = PH_IDLE;
+    zones.nutrientState[z] = NUTRIENT_IDLE;
+    phControl[z].reset();  // no integral built up on error nobody was dosing against
+    ecControl[z].reset();
+  }
+  zones.phWake = 0;
+  zones.nutrientWake = 0;
+  Log.println("Automation tasks paused.");
 }
 
 void resumeAutomationTasks() {
   tStartPump.enable();
-  tStartPH.enable();
-  tStartNutrients.enable();
   tReadPH.enable();
-  tECCalibration.enable();
-  tPHCalibration.enable();
-  tPHDosing.enable();
-  tPHVarUpdate.enable();
-  tNutrients.enable();
+  armTask(tPHDosing, srPHDose);
+  armTask(tNutrients, srECDose);
   
-  Serial.println("Automation tasks resumed.");
+  Log.println("Automation tasks resumed.");
 }
 
 void Modecheck() {
@@ -928,178 +1738,380 @@ void processSerialCommands() {
   if (Serial.available()) {
     String cmd = Serial.readStringUntil('\n');
     cmd.trim();
-    Serial.print("Serial command received: ");
-    Serial.println(cmd);
+    Log.print("Serial command received: ");
+    Log.println(cmd);
     
     // Handle mode switching commands first
     if (cmd.equalsIgnoreCase("MANUAL")) {
       ManualMode = true;
-      Serial.println("Switching to MANUAL mode.");
+      Log.println("Switching to MANUAL mode.");
       Modecheck();
     }
     else if (cmd.equalsIgnoreCase("AUTO")) {
       ManualMode = false;
-      Serial.println("Switching to AUTOMATIC mode.");
+      Log.println("Switching to AUTOMATIC mode.");
       Modecheck();
     }
+    else if (cmd.startsWith("QUERY")) {
+      startLogQuery(cmd);
+    }
   }
 }
 
 
-// Modular function to read CO2 sensor data 
-void readCO2Sensor() {
-uint16_t etvoc, errstat, raw;
-ccs811.read(&eco2, &etvoc, &errstat, &raw);
-  if (errstat == CCS811_ERRSTAT_OK) {
-    Serial.print("CO2 (eCO2): ");
-    Serial.println(eco2);
-  } else {
-    Serial.println("CO2 sensor data not ready.");
+// I2C environmental sensors: one batch queued per period, drained back-to-back.
+// The CCS811 is only read when its nINT line reported a new result.
+void pollI2CSensors() {
+  i2cBus.request(I2C_MASK(I2C_DEV_BH1750) | I2C_MASK(I2C_DEV_BMP280));
+  tI2CBus.enable();
+}
+
+void checkCO2DataReady() {
+  if (ccs811.dataReady()) {
+    ccs811.clearDataReady();
+    i2cBus.request(I2C_MASK(I2C_DEV_CCS811));
+    tI2CBus.enable();
+  }
+}
+
+void runI2CBus() {
+  if (!i2cBus.step()) {
+    tI2CBus.disable();
+  }
+}
+
+// Called by the bus manager after each device transaction
+void onI2CRead(I2CDevice device, bool ok) {
+  const EnvSnapshot& env = i2cBus.snapshot();
+  switch (device) {
+    case I2C_DEV_CCS811:
+      if (ok) {
+        co2Stats.add(env.eco2, millis());
+        feedAlert(SIG_CO2, env.eco2, co2Stats.slopePerMin());
+        logSample(SIG_CO2, 0, env.eco2);
+        Log.print("CO2 (eCO2): ");
+        Log.println(env.eco2);
+      } else {
+        Log.println("CO2 sensor read failed.");
+      }
+      break;
+    case I2C_DEV_CCS811_ENV:
+      if (!ok) Log.println("CO2 sensor compensation write failed.");
+      break;
+    case I2C_DEV_BH1750:
+      if (ok) {
+        feedAlert(SIG_LUX, env.lux, 0);  // no window kept for light, rules see no trend
+        logSample(SIG_LUX, 0, env.lux);
+        Log.print("Light: ");
+        Log.print(env.lux);
+        Log.println(" lux");
+      }
+      break;
+    case I2C_DEV_BMP280:
+      if (ok) {
+        airTempStats.add(env.airTemperature, millis());
+        feedAlert(SIG_AIR_TEMP, env.airTemperature, airTempStats.slopePerMin());
+        logSample(SIG_AIR_TEMP, 0, env.airTemperature);
+        envActivity = AdaptiveRate::activity(airTempStats, AIR_TEMP_ACTIVE_SLOPE, AIR_TEMP_ACTIVE_STDDEV);
+        applyRate(tI2CPoll, envRate.update(envActivity));
+        Log.print(F("Temperature = "));
+        Log.print(env.airTemperature);
+        Log.println(" *C");
+        Log.println();
+      }
+      break;
+    default:
+      break;
   }
 }
 
 float getWaterLevel() {
   // Set up the signal
-  digitalWrite(trig_pin, LOW);
+  digitalWrite(WaterLevel::TRIG_PIN, LOW);
   delayMicroseconds(2);
  // Create a 10 µs impulse
-  digitalWrite(trig_pin, HIGH);
+  digitalWrite(WaterLevel::TRIG_PIN, HIGH);
   delayMicroseconds(TRIG_PULSE_DURATION_US);
-  digitalWrite(trig_pin, LOW);
+  digitalWrite(WaterLevel::TRIG_PIN, LOW);
   // Return the wave propagation time (in µs)
-  ultrason_duration = pulseIn(echo_pin, HIGH);
+  ultrason_duration = pulseIn(WaterLevel::ECHO_PIN, HIGH);
   distance_cm = (ultrason_duration * SOUND_SPEED / 2) * 0.0001;
   return distance_cm;
 }
 
 void checkWaterLevelTask() {
     float waterLevel = getWaterLevel();
+    levelStats.add(waterLevel, millis());
+    feedAlert(SIG_LEVEL, waterLevel, levelStats.slopePerMin());
+    logSample(SIG_LEVEL, 0, waterLevel);
+    bool pumping = false;
+    for (uint8_t z = 0; z < ZONE_COUNT; z++) pumping |= actuators[z].isOn(ACT_WATER_PUMP);
+    levelActivity = pumping ? 1 : AdaptiveRate::activity(levelStats, LEVEL_ACTIVE_SLOPE, LEVEL_ACTIVE_STDDEV);
+    applyRate(tCheckWaterLevel, levelRate.update(levelActivity));
+    // One level sensor for the shared reservoir: a low level stops every zone
 if (waterLevel > WATER_LEVEL_NUTRIENTS_THRESHOLD) {
         waterLevelLowAlert = true;
-        Serial.print("Water level: ");
-        Serial.print(waterLevel);
-        Serial.println(" cm - ALERT: LOW WATER LEVEL!");
+        for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+            actuators[z].setInhibit(ACT_MASK(ACT_WATER_PUMP) | ACT_MASK(ACT_PH_RELAY) | ACT_MASK(ACT_NUTRIENT_RELAY)); // no dry running, no dosing into a low tank
+        }
+        Log.print("Water level: ");
+        Log.print(waterLevel);
+        Log.println(" cm - ALERT: LOW WATER LEVEL!");
     } else {
         waterLevelLowAlert = false;
-        Serial.print("Water level: ");
-        Serial.print(waterLevel);
-        Serial.println(" cm - Status: OK");
+        for (uint8_t z = 0; z < ZONE_COUNT; z++) actuators[z].setInhibit(0);
+        Log.print("Water level: ");
+        Log.print(waterLevel);
+        Log.println(" cm - Status: OK");
     }
 }
 
-void readLightSensor() {
-    float lux = lightMeter.readLightLevel();
-    if (lux >= 0) {
-        Serial.print("Light: ");
-        Serial.print(lux);
-        Serial.println(" lux");
-    }
-  }
-void readBMP280Sensor() {
-    atmosphericTemperature = bmp.readTemperature();
-    Serial.print(F("Temperature = "));
-    Serial.print(atmosphericTemperature);
-    Serial.println(" *C");
-    Serial.println();
-}
-
 void generateHydroponicsJson(JsonDocument& doc) {
+    // No bus I/O here: environmental channels read the last I2C batch snapshot
     doc.clear();
     doc["i"] = "R1";
     doc["m"] = ManualMode ? 1 : 0;
 
-    JsonArray sensor_values = doc["sv"].to<JsonArray>();
-    sensor_values.add(static_cast<int>(last_pH * 10 + 0.5));       // pH * 10
-    sensor_values.add(static_cast<int>(ecValue * 100 + 0.5));      // EC * 100
-    sensor_values.add(static_cast<int>(atmosphericTemperature * 10 + 0.5)); // Air Temp * 10
-    sensor_values.add(eco2);                                       // CO2
-    sensor_values.add(lightMeter.readLightLevel());                 // Light value
-
-    JsonArray sensor_setpoints = doc.createNestedArray("ss");
-    sensor_setpoints.add(static_cast<int>(target_ph * 10 + 0.5));
-    sensor_setpoints.add(static_cast<int>(target_ec * 100 + 0.5));
-    sensor_setpoints.add(static_cast<int>(target_temperature * 10 + 0.5));
-    sensor_setpoints.add(target_co2);
-    sensor_setpoints.add(target_light);
+    // Single-zone keys describe zone 0, "zn" below carries every zone.
+    // Values and setpoints per registry channel, in slot order.
+    Telemetry::values(doc["sv"].to<JsonArray>());
+    Telemetry::setpoints(doc["ss"].to<JsonArray>());
 
     JsonArray actuator_values = doc.createNestedArray("av");
-    actuator_values.add(digitalRead(WATER_PUMP_RELAY_PIN) == HIGH ? 1 : 0);
-    actuator_values.add(digitalRead(PH_RELAY_PIN) == HIGH ? 1 : 0);
-    actuator_values.add(digitalRead(NUTRIENTS_RELAY_PIN) == HIGH ? 1 : 0);
+    actuator_values.add(actuators[0].isOn(ACT_WATER_PUMP) ? 1 : 0);
+    actuator_values.add(actuators[0].isOn(ACT_PH_RELAY) ? 1 : 0);
+    actuator_values.add(actuators[0].isOn(ACT_NUTRIENT_RELAY) ? 1 : 0);
+
+    // Duty accounting per actuator: switch-ons, on-time in seconds
+    JsonArray actuator_counts = doc["ac"].to<JsonArray>();
+    for (uint8_t i = 0; i < ACT_COUNT; i++) {
+        actuator_counts.add(actuators[0].stats((Actuator)i).starts);
+        actuator_counts.add(static_cast<uint32_t>(actuators[0].stats((Actuator)i).onTimeMs / 1000));
+    }
+
+    // Reading noise: standard deviation of the pH/EC readings around the filtered estimate * 1000
+    JsonArray filter_spread = doc["fv"].to<JsonArray>();
+    filter_spread.add(static_cast<int>(sqrt(phFilter[0].noiseVariance()) * 1000 + 0.5));
+    filter_spread.add(static_cast<int>(sqrt(ecFilter[0].noiseVariance()) * 1000 + 0.5));
+
+    // Spread over the statistics window: pH * 100, EC * 1000, water temp * 100, CO2
+    JsonArray sensor_spread = doc["sd"].to<JsonArray>();
+    sensor_spread.add(static_cast<int>(phStats[0].stddev() * 100 + 0.5));
+    sensor_spread.add(static_cast<int>(ecStats[0].stddev() * 1000 + 0.5));
+    sensor_spread.add(static_cast<int>(tempStats.stddev() * 100 + 0.5));
+    sensor_spread.add(static_cast<int>(co2Stats.stddev() + 0.5));
 
     doc["x"] = waterLevelLowAlert ? 1 : 0;
+    doc["w"] = wakeupsPerMinute;  // scheduler task wakeups over the last minute
+    doc["sl"] = asleepPermille;   // permille of the last minute in light sleep
+
+    // Effective sampling periods in seconds: water, environment, level, telemetry
+    JsonArray rates = doc["rt"].to<JsonArray>();
+    rates.add(waterRate.periodMs() / 1000);
+    rates.add(envRate.periodMs() / 1000);
+    rates.add(levelRate.periodMs() / 1000);
+    rates.add(telemetryRate.periodMs() / 1000);
+
+    // Dosing convergence per loop: error (positive: dose due), permille of samples
+    // inside the deadband, doses, dosed seconds; pH error * 100, EC error * 1000
+    JsonArray control = doc["pc"].to<JsonArray>();
+    control.add(static_cast<int>(lroundf(phControl[0].error() * 100)));
+    control.add(phControl[0].inBandPermille());
+    control.add(phControl[0].doses());
+    control.add(phControl[0].doseMsTotal() / 1000);
+    control.add(static_cast<int>(lroundf(ecControl[0].error() * 1000)));
+    control.add(ecControl[0].inBandPermille());
+    control.add(ecControl[0].doses());
+    control.add(ecControl[0].doseMsTotal() / 1000);
+
+    // Multi-zone builds: one row per zone, pH * 10, EC * 100, target pH * 10,
+    // target EC * 100, relays on (bit 0 pump, 1 pH, 2 nutrients), pH error * 100, EC error * 1000
+    if (ZONE_COUNT > 1) {
+        JsonArray zone_rows = doc["zn"].to<JsonArray>();
+        for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+            JsonArray row = zone_rows.add<JsonArray>();
+            row.add(static_cast<int>(zones.pH[z] * 10 + 0.5));
+            row.add(static_cast<int>(zones.ec[z] * 100 + 0.5));
+            row.add(static_cast<int>(zones.targetPH[z] * 10 + 0.5));
+            row.add(static_cast<int>(zones.targetEC[z] * 100 + 0.5));
+            uint8_t relays = 0;
+            for (uint8_t i = 0; i < ACT_COUNT; i++) {
+                if (actuators[z].isOn((Actuator)i)) relays |= ACT_MASK(i);
+            }
+            row.add(relays);
+            row.add(static_cast<int>(lroundf(phControl[z].error() * 100)));
+            row.add(static_cast<int>(lroundf(ecControl[z].error() * 1000)));
+        }
+    }
 }
 
 
 void processRPiCommand(const String& jsonCommandString) {
-    Serial.print("ESP32: Processing RPi Command: ");
-    Serial.println(jsonCommandString);
+    Log.print("ESP32: Processing RPi Command: ");
+    Log.println(jsonCommandString);
 
     StaticJsonDocument<256> doc;
     DeserializationError error = deserializeJson(doc, jsonCommandString);
 
     if (error) {
-        Serial.print("ESP32: deserializeJson() failed: "); Serial.println(error.f_str());
+        Log.print("ESP32: deserializeJson() failed: "); Log.println(error.f_str());
         return;
     }
 
+    // Hub clock ("t", epoch seconds), rides along on any command that has room
+    if (doc.containsKey("t")) {
+        sensorLog.setEpoch(doc["t"].as<uint32_t>(), millis());
+        if (doc.size() == 1) return;  // clock only
+    }
+
+    if (doc.containsKey("k") && !doc.containsKey("md")) return;  // uplink acks, the radio task took them
+
+    if (doc.containsKey("ar")) {
+        applyRateConfig(doc["ar"]);
+        if (!doc.containsKey("md")) return;  // sampling policy only
+    }
+
+    if (doc.containsKey("ru")) {
+        applyAlertRule(doc["ru"]);
+        if (!doc.containsKey("md")) return;  // alert rule only
+    }
+
+    if (doc.containsKey("sc")) {
+        sendSensorSchema();
+        if (!doc.containsKey("md")) return;  // schema request only
+    }
+
     if (!doc.containsKey("md")) {
-        Serial.println("ESP32: Received command from RPi without 'md' (mode) field.");
+        Log.println("ESP32: Received command from RPi without 'md' (mode) field.");
         return;
     }
     
     int mode_received = doc["md"];
+    // Zone the command addresses ("z"); setpoints without one apply to every zone
+    int zone = doc["z"] | -1;
+    if (zone >= ZONE_COUNT) {
+        Log.println("ESP32: Command for a zone this unit does not have, ignored.");
+        return;
+    }
 
     if (mode_received == 0) { // Auto mode
         ManualMode = false;
-        Serial.println("ESP32: Switching to AUTO mode.");
+        Log.println("ESP32: Switching to AUTO mode.");
         if (doc.containsKey("cv")) {
             cropVariety = doc["cv"].as<String>();
         }
         if (doc.containsKey("sp")) {
             JsonArray sp = doc["sp"];
             if (!sp.isNull() && sp.size() >= 6) {
-                target_ph = sp[0].as<int>() / 10.0;
-                target_ec = sp[1].as<int>() / 100.0;
+                for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+                    if (zone >= 0 && z != zone) continue;
+                    zones.targetPH[z] = sp[0].as<int>() / 10.0;
+                    zones.targetEC[z] = sp[1].as<int>() / 100.0;
+                    phControl[z].setTarget(zones.targetPH[z]);
+                    ecControl[z].setTarget(zones.targetEC[z]);
+                }
                 target_temperature = sp[2].as<int>() / 10.0;
                 target_humidity = sp[3].as<int>();
                 target_co2 = sp[4].as<int>();
                 target_light = sp[5].as<int>();
-                Serial.print("ESP32: Updated Setpoints - Crop: "); Serial.println(cropVariety);
+                Log.print("ESP32: Updated Setpoints - Crop: "); Log.println(cropVariety);
                 // Print other setpoints for confirmation
             } else {
-                Serial.println("ESP32: Auto mode 'sp' (setpoints) field present but invalid or incomplete. Using previous setpoints.");
+                Log.println("ESP32: Auto mode 'sp' (setpoints) field present but invalid or incomplete. Using previous setpoints.");
             }
         } else {
-             Serial.println("ESP32: Auto mode command received without 'cv' or 'sp'. Mode switched, using previous setpoints.");
+             Log.println("ESP32: Auto mode command received without 'cv' or 'sp'. Mode switched, using previous setpoints.");
         }
-        // TODO: Implement ESP32 auto control logic based on new setpoints
+        // pH and EC dosing track each zone's targets through phControl / ecControl
     } else if (mode_received == 1) { // Manual mode
         ManualMode = true;
-        Serial.println("ESP32: Switching to/confirming MANUAL mode.");
+        Log.println("ESP32: Switching to/confirming MANUAL mode.");
         if (doc.containsKey("act")) {
             JsonObject act = doc["act"];
-            if (act.containsKey("wp")) {
-                digitalWrite(WATER_PUMP_RELAY_PIN, act["wp"].as<int>() == 1 ? HIGH : LOW);
-                Serial.print("  WP: "); Serial.println(act["wp"].as<int>() == 1 ? "ON" : "OFF");
-            }
-            if (act.containsKey("phr")) {
-                digitalWrite(PH_RELAY_PIN, act["phr"].as<int>() == 1 ? HIGH : LOW);
-                Serial.print("  PHR: "); Serial.println(act["phr"].as<int>() == 1 ? "ON" : "OFF");
-            }
-            if (act.containsKey("nr")) {
-                digitalWrite(NUTRIENTS_RELAY_PIN, act["nr"].as<int>() == 1 ? HIGH : LOW);
-                Serial.print("  NR: "); Serial.println(act["nr"].as<int>() == 1 ? "ON" : "OFF");
+            if (zone < 0) zone = 0;  // relays without "z" are zone 0's
+            // The manager may refuse a request (busy, min off-time, interlock), so the
+            // hub is told what the relays did: {"z", "aa": result per actuator, "av": states}
+            static const char* const keys[ACT_COUNT] = { "wp", "phr", "nr" };
+            StaticJsonDocument<192> reply;
+            reply["i"] = "R1";
+            reply["z"] = zone;
+            JsonArray results = reply["aa"].to<JsonArray>();
+            JsonArray states = reply["av"].to<JsonArray>();
+            for (uint8_t i = 0; i < ACT_COUNT; i++) {
+                int result = -1;  // not in the command
+                if (act.containsKey(keys[i])) {
+                    ActuatorResult outcome = ACT_STARTED;
+                    if (act[keys[i]].as<int>() == 1) requestActuator(zone, (Actuator)i, SRC_HUB, 0, &outcome);
+                    else actuators[zone].release((Actuator)i, SRC_HUB);
+                    result = outcome;
+                    Log.print("  "); Log.print(keys[i]); Log.print(": ");
+                    Log.println(actuators[zone].isOn((Actuator)i) ? "ON" : "OFF");
+                }
+                results.add(result);
+                states.add(actuators[zone].isOn((Actuator)i) ? 1 : 0);
             }
+            if (!queueFrame(reply)) Log.println("Actuator reply: frame not queued.");
         } else {
-            Serial.println("ESP32: Manual mode command received, but no 'act' (actuators) field. Mode switched.");
+            Log.println("ESP32: Manual mode command received, but no 'act' (actuators) field. Mode switched.");
         }
     } else {
-        Serial.println("ESP32: Received unknown mode from RPi.");
+        Log.println("ESP32: Received unknown mode from RPi.");
     }
 }
 void sendTelemetryTask() {
+    // Report as often as the busiest sensor needs, the alert always counts as active
+    float activity = waterLevelLowAlert ? 1 : max(waterActivity, max(envActivity, levelActivity));
+    applyRate(tSendTelemetry, telemetryRate.update(activity));
     StaticJsonDocument<200> telemetryDoc;
     generateHydroponicsJson(telemetryDoc);
-    rakModule.sendJson(telemetryDoc);
+    if (!queueFrame(telemetryDoc)) {
+        Log.println("Telemetry: frame dropped.");
+    }
+}
+
+// {"k":[q, ...]}: frames the hub received; the backlog is the radio task's own
+void applyUplinkAcks(const String& json) {
+  StaticJsonDocument<256> doc;
+  if (deserializeJson(doc, json) || !doc.containsKey("k")) return;
+  JsonArrayConst acks = doc["k"];
+  for (size_t i = 0; i < acks.size(); i++) backlog.acked(acks[i].as<uint32_t>());
+}
+
+// Core 0: owns Serial output and the RAK UART. Each pass drains the log,
+// forwards received commands to the control loop and sends queued telemetry.
+void radioTask(void* parameter) {
+  for (;;) {
+    xSemaphoreTake(radioLock, portMAX_DELAY);  // keeps the control loop from sleeping mid-exchange
+    drainLog(Serial);
+
+    String rpiCommandJson = rakModule.checkForReceivedMessage();
+    // the hub's wake frame (and anything garbled by a wake) is not JSON
+    if (rpiCommandJson.startsWith("{")) {
+      applyUplinkAcks(rpiCommandJson);
+      if (rpiCommandJson.length() < RADIO_MSG_LEN) {
+        RadioCommand command;
+        strncpy(command.json, rpiCommandJson.c_str(), RADIO_MSG_LEN);
+        if (!commandQueue.push(command)) Serial.println("RAK: command queue full, dropped.");
+      } else {
+        Serial.println("RAK: received command too long, dropped.");
+      }
+    }
+
+    // Live frames first; the backlog only gets the radio when none is waiting
+    unsigned long now = millis();
+    TelemetryFrame frame;
+    if (telemetryQueue.pop(frame)) {
+      backlog.sent(frame, rakModule.sendPayload(String(frame.json)), now);
+    } else if (backlog.replayDue(now) && backlog.nextReplay(frame, now)) {
+      Serial.print("Backlog: replaying frame ");
+      Serial.print(frame.seq);
+      Serial.print(", ");
+      Serial.print(backlog.queued());
+      Serial.println(" left");
+      backlog.sent(frame, rakModule.sendPayload(String(frame.json)), now);
+    }
+    backlog.expire(now);
+    xSemaphoreGive(radioLock);
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
 }
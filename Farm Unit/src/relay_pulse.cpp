@@ -0,0 +1,61 @@
+#include "relay_pulse.h"
+
+bool RelayPulse::begin() {
+    pinMode(_pin, OUTPUT);
+    esp_timer_create_args_t args = {};
+    args.callback = &RelayPulse::onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = _name;
+    return esp_timer_create(&args, &_timer) == ESP_OK;
+}
+
+bool RelayPulse::start(uint32_t ms) {
+    if (_timer == nullptr) return false;
+    int64_t now = esp_timer_get_time();
+    if (_active) {
+        esp_timer_stop(_timer);
+    } else {
+        _done = false;
+        digitalWrite(_pin, HIGH);
+        _startUs = now;
+        _active = true;
+    }
+    if (ms == 0) {
+        _deadlineUs = 0;
+        _requestedMs = 0;
+        return true;
+    }
+    _deadlineUs = now + (int64_t)ms * 1000;
+    _requestedMs = (now - _startUs) / 1000 + ms;
+    return esp_timer_start_once(_timer, (uint64_t)ms * 1000) == ESP_OK;
+}
+
+uint32_t RelayPulse::remainingMs() const {
+    if (!_active || _deadlineUs == 0) return 0;
+    int64_t left = _deadlineUs - esp_timer_get_time();
+    return left > 0 ? left / 1000 : 0;
+}
+
+void RelayPulse::stop() {
+    if (!_active) return;
+    esp_timer_stop(_timer);
+    finish();
+}
+
+bool RelayPulse::takeDone() {
+    return _done.exchange(false);
+}
+
+void RelayPulse::finish() {
+    if (!_active.exchange(false)) return;  // stop() and the timer may race
+    digitalWrite(_pin, LOW);
+    _endUs = esp_timer_get_time();
+    _pulses++;
+    _done = true;
+}
+
+// Runs in the esp_timer task, not in loop()
+void RelayPulse::onTimer(void* arg) {
+    static_cast<RelayPulse*>(arg)->finish();
+}
@@ -0,0 +1,50 @@
+#ifndef RELAY_PULSE_H
+#define RELAY_PULSE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+
+// A timed relay-on pulse ended by an esp_timer one-shot. The relay is
+// switched off in the timer callback, so a blocked loop() cannot stretch
+// a dose. Completion is picked up later from the control loop via done().
+class RelayPulse {
+public:
+    RelayPulse(uint8_t pin, const char* name) : _pin(pin), _name(name) {}
+
+    bool begin();                 // pin mode and timer, call once from setup()
+
+    // Relay on now, off after ms (0: stays on until stop()). Restarting an
+    // active pulse moves its end to ms from now without switching off.
+    bool start(uint32_t ms);
+    void stop();                  // early off, still reported as a completed pulse
+
+    bool active() const { return _active; }
+    bool latched() const { return _active && _deadlineUs == 0; }
+    uint32_t remainingMs() const;         // 0 when off or latched
+    int64_t endedUs() const { return _endUs; }  // esp_timer time of the last switch-off
+    bool done() const { return _done; }
+    bool takeDone();              // clears the completion flag, true once per pulse
+
+    const char* name() const { return _name; }
+    uint32_t requestedMs() const { return _requestedMs; }
+    float actualMs() const { return (_endUs - _startUs) / 1000.0; }
+    uint32_t pulses() const { return _pulses; }
+
+private:
+    uint8_t _pin;
+    const char* _name;
+    esp_timer_handle_t _timer = nullptr;
+    std::atomic<bool> _active{false};
+    std::atomic<bool> _done{false};
+    int64_t _startUs = 0;
+    int64_t _deadlineUs = 0;
+    volatile int64_t _endUs = 0;
+    uint32_t _requestedMs = 0;
+    uint32_t _pulses = 0;
+
+    void finish();
+    static void onTimer(void* arg);
+};
+
+#endif // RELAY_PULSE_H
@@ -0,0 +1,98 @@
+#include "running_stats.h"
+
+RunningStats::RunningStats(unsigned long windowMs, float ewmaAlpha)
+    : _windowMs(windowMs), _alpha(ewmaAlpha) {
+    reset();
+}
+
+void RunningStats::reset() {
+    clearWindow(_w[0], 0);
+    clearWindow(_w[1], 0);
+    _ewma = 0;
+    _ewmVar = 0;
+    _ewmaInit = false;
+    _started = false;
+}
+
+void RunningStats::clearWindow(Window& w, unsigned long start) {
+    w.start = start;
+    w.n = 0;
+    w.mean = w.m2 = 0;
+    w.tMean = w.tM2 = w.cov = 0;
+    w.tLast = 0;
+}
+
+void RunningStats::addToWindow(Window& w, float value, unsigned long nowMs) {
+    float t = (nowMs - w.start) / 1000.0;
+    w.tLast = t;
+    w.n++;
+    float dt = t - w.tMean;
+    float dx = value - w.mean;
+    w.tMean += dt / w.n;
+    w.mean += dx / w.n;
+    w.tM2 += dt * (t - w.tMean);
+    w.m2 += dx * (value - w.mean);
+    w.cov += dt * (value - w.mean);
+}
+
+void RunningStats::add(float value, unsigned long nowMs) {
+    if (isnan(value) || isinf(value)) return;
+
+    if (!_started) {
+        // second accumulator starts half a window later
+        clearWindow(_w[0], nowMs);
+        clearWindow(_w[1], nowMs + _windowMs / 2);
+        _started = true;
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        if ((long)(nowMs - _w[i].start) < 0) continue;  // not started yet
+        if (nowMs - _w[i].start >= _windowMs) clearWindow(_w[i], nowMs);
+        addToWindow(_w[i], value, nowMs);
+    }
+
+    if (!_ewmaInit) {
+        _ewma = value;
+        _ewmVar = 0;
+        _ewmaInit = true;
+    } else {
+        float d = value - _ewma;
+        _ewma += _alpha * d;
+        _ewmVar = (1 - _alpha) * (_ewmVar + _alpha * d * d);
+    }
+}
+
+const RunningStats::Window& RunningStats::reported() const {
+    // the window that started first holds more history
+    if (_w[1].n == 0) return _w[0];
+    if (_w[0].n == 0) return _w[1];
+    return ((long)(_w[1].start - _w[0].start) > 0) ? _w[0] : _w[1];
+}
+
+bool RunningStats::ready() const {
+    const Window& w = reported();
+    if (w.n < 3) return false;
+    return w.tLast * 1000.0 >= _windowMs / 2;  // samples span at least half a window
+}
+
+uint32_t RunningStats::count() const {
+    return reported().n;
+}
+
+float RunningStats::mean() const {
+    return reported().mean;
+}
+
+float RunningStats::variance() const {
+    const Window& w = reported();
+    return w.n > 1 ? w.m2 / (w.n - 1) : 0;
+}
+
+float RunningStats::stddev() const {
+    return sqrt(variance());
+}
+
+float RunningStats::slopePerMin() const {
+    const Window& w = reported();
+    if (w.n < 2 || w.tM2 <= 0) return 0;
+    return w.cov / w.tM2 * 60.0;
+}
@@ -0,0 +1,51 @@
+#ifndef RUNNING_STATS_H
+#define RUNNING_STATS_H
+
+#include <Arduino.h>
+
+// Incremental statistics for one sensor stream, O(1) time and memory per sample.
+//
+// Mean, variance and least-squares slope come from Welford updates over a
+// sliding window approximated by two accumulators started half a window
+// apart: the older one always covers between W/2 and W of recent samples and
+// is the one reported. An exponentially weighted mean/variance runs alongside
+// for a smooth trend that never resets.
+class RunningStats {
+public:
+    RunningStats(unsigned long windowMs, float ewmaAlpha);
+
+    void add(float value, unsigned long nowMs);
+    void reset();
+
+    bool ready() const;               // reported window holds at least half a window of samples
+    uint32_t count() const;
+    float mean() const;
+    float variance() const;           // sample variance over the window
+    float stddev() const;
+    float slopePerMin() const;        // least-squares trend over the window, units per minute
+    float ewma() const { return _ewma; }
+    float ewmVariance() const { return _ewmVar; }
+    unsigned long windowMs() const { return _windowMs; }
+
+private:
+    struct Window {
+        unsigned long start;
+        uint32_t n;
+        float mean, m2;          // value
+        float tMean, tM2, cov;   // time (s since start) and value/time co-moment
+        float tLast;
+    };
+
+    Window _w[2];
+    unsigned long _windowMs;
+    float _alpha;
+    float _ewma, _ewmVar;
+    bool _ewmaInit;
+    bool _started;
+
+    const Window& reported() const;
+    static void clearWindow(Window& w, unsigned long start);
+    static void addToWindow(Window& w, float value, unsigned long nowMs);
+};
+
+#endif // RUNNING_STATS_H
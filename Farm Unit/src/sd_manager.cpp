@@ -1,9 +1,123 @@
 #include "sd_manager.h"
 #include <SPI.h>
-#include <CSS.h> // for append_page_header(), append_page_footer()
+#include <CSS.h> // page shell and stylesheet, plain and compressed
+#include "log_query.h"
+#include "core_link.h"
+#include "upload_writer.h"
+#include "http_range.h"
+
+static SPIClass sdSPI(HSPI);
+static uint8_t copyBuffer[SD_COPY_BUFFER];  // file bytes on their way to a client
+static const DeflatedText pageHeader = { PAGE_HEADER, sizeof(PAGE_HEADER) - 1, PAGE_HEADER_DEFLATE,
+                                         sizeof(PAGE_HEADER_DEFLATE), PAGE_HEADER_CRC };
+
+// gzip unless the client leaves it out of Accept-Encoding or gives it q=0
+static bool acceptsGzip() {
+    if (!server.hasHeader("Accept-Encoding")) return false;
+    String accept = server.header("Accept-Encoding");
+    accept.toLowerCase();
+    int at = accept.indexOf("gzip");
+    if (at < 0) return false;
+    int comma = accept.indexOf(',', at);
+    String params = accept.substring(at + 4, comma < 0 ? accept.length() : comma);
+    int q = params.indexOf("q=");
+    return q < 0 || params.substring(q + 2).toFloat() > 0;
+}
+
+// Wire rate and, for a gzip body, compression cost, per response
+static void logTransfer(const char* what, const ChunkedResponse& response) {
+    uint32_t ms = max(response.elapsedMs(), (uint32_t)1);
+    Log.print("HTTP ");
+    Log.print(what);
+    Log.print(": ");
+    Log.print(response.bytesSent() / 1024.0, 1);
+    Log.print(" KB in ");
+    Log.print(ms);
+    Log.print(" ms, ");
+    Log.print(response.bytesSent() / 1.024 / ms, 1);
+    Log.print(" KB/s");
+    const GzipStream* gzip = response.gzip();
+    if (gzip && gzip->bytesIn() > 0) {
+        Log.print(", gzip ");
+        Log.print(gzip->bytesIn() / 1024.0, 1);
+        Log.print(" KB -> ");
+        Log.print(gzip->bytesOut() / 1024.0, 1);
+        Log.print(" KB, ");
+        Log.print(gzip->cpuMicros() / 1000.0 / (gzip->bytesIn() / 1048576.0), 1);
+        Log.print(" ms CPU/MB");
+    }
+    Log.println();
+}
+
+// Names and ?dir= come from the card and the client, so anything put into a
+// page goes through one of these; runs of plain characters go out in one write
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Text or attribute value inside HTML
+static void printHtml(Print& out, const char* text) {
+    for (const char* run = text;; text++) {
+        const char* entity = nullptr;
+        switch (*text) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '\'': entity = "&#39;"; break;
+            case '"': entity = "&quot;"; break;
+            case '\0': break;
+            default: continue;
+        }
+        out.write((const uint8_t*)run, text - run);
+        if (!entity) return;
+        out.print(entity);
+        run = text + 1;
+    }
+}
+
+// Path as a query value: everything but unreserved characters and '/' percent-encoded
+static void printUrl(Print& out, const char* text) {
+    for (; *text; text++) {
+        uint8_t c = *text;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || strchr("-._~/", c)) {
+            out.write(c);
+        } else {
+            out.write('%');
+            out.write(HEX_DIGITS[c >> 4]);
+            out.write(HEX_DIGITS[c & 15]);
+        }
+    }
+}
+
+// Inside a JSON string
+static void printJson(Print& out, const char* text) {
+    for (; *text; text++) {
+        uint8_t c = *text;
+        if (c == '"' || c == '\\') {
+            out.write('\\');
+            out.write(c);
+        } else if (c < 0x20) {
+            out.print("\\u00");
+            out.write(HEX_DIGITS[c >> 4]);
+            out.write(HEX_DIGITS[c & 15]);
+        } else {
+            out.write(c);
+        }
+    }
+}
+
+// Appends to the page being built in webpage, for the pages that still use it
+class WebpagePrint : public Print {
+public:
+    size_t write(uint8_t c) override {
+        webpage += (char)c;
+        return 1;
+    }
+    using Print::write;
+};
+static WebpagePrint webpageOut;
 
 void SD_init(uint8_t sdPin) {
-    if (!SD.begin(sdPin)) {
+    sdSPI.begin(SD_SCK_PIN, SD_MISO_PIN, SD_MOSI_PIN, sdPin);
+    if (!SD.begin(sdPin, sdSPI)) {
         Serial.println(F("SD card initialization failed"));
         SD_present = false;
     } else {
@@ -12,6 +126,19 @@ void SD_init(uint8_t sdPin) {
     }
 }
 
+void SD_routes() {
+    server.on("/", SD_dir);  // GET or POST; download_ / delete_ args act on a file
+    server.on("/upload", File_Upload);
+    server.on("/fupload", HTTP_POST, []() {}, handleFileUpload);  // handleFileUpload answers
+    server.on("/query", SD_query);
+    server.on("/chart", SD_chart);
+    server.on("/export", SD_export);
+    server.on("/style.css", SendCSS);
+    server.onNotFound([]() { ReportFileNotPresent(server.uri()); });
+}
+
+// Listing streamed a row at a time: ?dir= picks the directory, ?page= and
+// ?per= page through it, ?format=json gives tools a plain list
 void SD_dir() {
     if (!SD_present) {
         ReportSDNotPresent();
@@ -19,36 +146,64 @@ void SD_dir() {
     }
 
     // Handle download and delete commands
-    if (server.args() > 0) {
-        String arg = server.arg(0);
-        if (arg.startsWith("download_")) {
-            SD_file_download(arg.substring(9));
-            return;
-        } else if (arg.startsWith("delete_")) {
-            SD_file_delete(arg.substring(7));
-            return;
-        }
+    if (server.hasArg("download_")) {
+        SD_file_download(server.arg("download_"));
+        return;
+    } else if (server.hasArg("delete_")) {
+        SD_file_delete(server.arg("delete_"));
+        return;
     }
 
-    File root = SD.open("/");
-    if (!root) {
-        SendHTML_Header();
-        webpage = "<h3>Cannot open root directory</h3>";
-        append_page_footer();
-        SendHTML_Content();
-        SendHTML_Stop();
+    String path = server.hasArg("dir") ? server.arg("dir") : String("/");
+    long page = server.hasArg("page") ? server.arg("page").toInt() : 0;
+    long per = server.hasArg("per") ? server.arg("per").toInt() : DIR_PAGE_SIZE;
+    bool json = server.arg("format") == "json";
+    if (page < 0 || per < 1 || per > DIR_PAGE_MAX) {
+        server.send(400, "text/plain", "page >= 0 and per 1.." + String(DIR_PAGE_MAX));
+        return;
+    }
+    File dir = SD.open(path);
+    if (!dir || !dir.isDirectory()) {
+        if (dir) dir.close();
+        ReportFileNotPresent(path);
         return;
     }
 
-    root.rewindDirectory();
-    SendHTML_Header();
-    webpage += F("<table align='center'><tr><th>Name</th><th>Type</th><th>Size</th><th>Actions</th></tr>");
-    printDirectory("/", 0);
-    webpage += F("</table>");
-    append_page_footer();
-    SendHTML_Content();
-    SendHTML_Stop();
-    root.close();
+    ChunkedResponse response(server.client());
+    bool gzip = acceptsGzip();
+    if (json) {
+        response.begin(200, "application/json", nullptr, gzip);
+        response.print(F("{\"dir\":\""));
+        printJson(response, path.c_str());
+        response.printf("\",\"page\":%ld,\"per\":%ld,\"entries\":[", page, per);
+    } else {
+        response.begin(200, "text/html", nullptr, gzip);
+        response.writeDeflated(pageHeader);
+        response.print(F("<h3>"));
+        printHtml(response, path.c_str());
+        response.print(F("</h3>"));
+        response.print(F("<table align='center'><tr><th>Name</th><th>Type</th><th>Size</th><th>Actions</th></tr>"));
+    }
+    bool more = printDirectory(response, dir, page * per, per, json);
+    dir.close();
+    if (json) {
+        response.printf("],\"more\":%s}", more ? "true" : "false");
+    } else {
+        response.print(F("</table><p>"));
+        if (page > 0) {
+            response.print(F("<a href='/?dir="));
+            printUrl(response, path.c_str());
+            response.printf("&amp;page=%ld&amp;per=%ld'>Previous</a> ", page - 1, per);
+        }
+        if (more) {
+            response.print(F("<a href='/?dir="));
+            printUrl(response, path.c_str());
+            response.printf("&amp;page=%ld&amp;per=%ld'>Next</a>", page + 1, per);
+        }
+        response.print(F("</p></body></html>"));
+    }
+    response.end();
+    logTransfer("listing", response);
 }
 
 void File_Upload() {
@@ -63,79 +218,302 @@ void File_Upload() {
     webpage = "";
 }
 
+// Body through UploadWriter; with ?crc32= (hex) the new file only replaces
+// the old one if the data matches
 void handleFileUpload() {
     HTTPUpload& upload = server.upload();
-    static File uploadFile;
+    static UploadWriter writer;  // its buffers stay off the loop stack
 
     if (upload.status == UPLOAD_FILE_START) {
         String filename = upload.filename;
         if (!filename.startsWith("/")) filename = "/" + filename;
-        SD.remove(filename);
-        uploadFile = SD.open(filename, FILE_WRITE);
+        writer.begin(SD, filename);
     } else if (upload.status == UPLOAD_FILE_WRITE) {
-        if (uploadFile) uploadFile.write(upload.buf, upload.currentSize);
+        writer.write(upload.buf, upload.currentSize);
     } else if (upload.status == UPLOAD_FILE_END) {
-        if (uploadFile) {
-            uploadFile.close();
-            append_page_header();
-            webpage += F("<h3>Upload successful</h3><a href='/'>Back</a>");
-            append_page_footer();
-            server.send(200, "text/html", webpage);
-            webpage = "";
-        } else {
+        if (!writer.end()) {
+            writer.abort();
+            ReportCouldNotCreateFile("upload");
+            return;
+        }
+        char crc[48];
+        if (server.hasArg("crc32") && strtoul(server.arg("crc32").c_str(), nullptr, 16) != writer.crc()) {
+            writer.abort();
+            snprintf(crc, sizeof(crc), "CRC-32 mismatch, received data has %08lx", (unsigned long)writer.crc());
+            server.send(400, "text/plain", crc);
+            return;
+        }
+        snprintf(crc, sizeof(crc), "%08lx", (unsigned long)writer.crc());
+        if (!writer.commit()) {
+            writer.abort();
             ReportCouldNotCreateFile("upload");
+            return;
         }
+        uint32_t ms = max(writer.elapsedMs(), (uint32_t)1);
+        float rate = writer.bytes() / 1.024 / ms;
+        Log.print("Upload ");
+        Log.print(upload.filename);
+        Log.print(": ");
+        Log.print(writer.bytes() / 1024.0, 1);
+        Log.print(" KB in ");
+        Log.print(ms);
+        Log.print(" ms, ");
+        Log.print(rate, 1);
+        Log.print(" KB/s, card busy ");
+        Log.print(writer.cardMs());
+        Log.println(" ms");
+        append_page_header();
+        webpage += F("<h3>Upload successful</h3><p>");
+        webpage += file_size(writer.bytes());
+        webpage += ", " + String(rate, 1);
+        webpage += F(" KB/s, CRC-32 ");
+        webpage += crc;
+        webpage += F("</p><a href='/'>Back</a>");
+        append_page_footer();
+        server.send(200, "text/html", webpage);
+        webpage = "";
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        writer.abort();
+    }
+}
+
+void SD_query() {
+    if (!SD_present) { ReportSDNotPresent(); return; }
+    if (!server.hasArg("from") || !server.hasArg("to")) {
+        server.send(400, "text/plain", "from and to (epoch seconds) required");
+        return;
     }
+    uint8_t signal = server.hasArg("signal") ? server.arg("signal").toInt() : LOG_QUERY_ANY;
+    uint8_t zone = server.hasArg("zone") ? server.arg("zone").toInt() : LOG_QUERY_ANY;
+    static LogQuery query;  // a block buffer, kept off the loop stack
+    query.begin(SD, strtoul(server.arg("from").c_str(), nullptr, 10), strtoul(server.arg("to").c_str(), nullptr, 10), signal, zone);
+
+    ChunkedResponse response(server.client());
+    response.begin(200, "text/csv", nullptr, acceptsGzip());
+    response.print(F(LOG_QUERY_CSV_HEADER "\n"));
+    LogRecord record;
+    char line[LOG_QUERY_CSV_LEN];
+    while (response.ok() && query.next(record)) {
+        LogQuery::formatCsv(line, sizeof(line), record);
+        response.print(line);
+        response.print('\n');
+    }
+    query.end();
+    response.end();
+    logTransfer("query", response);
 }
 
-void printDirectory(const char* dirname, uint8_t levels) {
-    File dir = SD.open(dirname);
-    if (!dir || !dir.isDirectory()) return;
+// One point per step from the coarsest rollup level that still resolves it,
+// a bounded number of stored buckets each: the cost follows points, not the window
+void SD_chart() {
+    if (!SD_present) { ReportSDNotPresent(); return; }
+    if (!server.hasArg("signal") || !server.hasArg("from") || !server.hasArg("to")) {
+        server.send(400, "text/plain", "signal, from and to (epoch seconds) required");
+        return;
+    }
+    uint8_t signal = server.arg("signal").toInt();
+    uint8_t zone = server.hasArg("zone") ? server.arg("zone").toInt() : 0;
+    uint32_t from = strtoul(server.arg("from").c_str(), nullptr, 10);
+    uint32_t to = strtoul(server.arg("to").c_str(), nullptr, 10);
+    long points = server.hasArg("points") ? server.arg("points").toInt() : 200;
+    if (to <= from || points < 1 || points > 2000) {
+        server.send(400, "text/plain", "need from < to and 1..2000 points");
+        return;
+    }
+    uint8_t level = LogRollup::levelFor(from, to, points);
+    uint32_t width = ROLLUP_WIDTHS[level];
+    uint32_t step = max((uint32_t)((to - from) / points / width * width), width);
+    uint32_t start = from - from % width;
+
+    ChunkedResponse response(server.client());
+    response.begin(200, "application/json", nullptr, acceptsGzip());
+    response.printf("{\"width\":%lu,\"step\":%lu,\"points\":[", (unsigned long)width, (unsigned long)step);
+    bool first = true;
+    for (uint32_t t = start; t <= to && t >= start && response.ok(); t += step) {
+        RollupBucket bucket = rollups.read(level, signal, zone, t, step);
+        if (bucket.count == 0) continue;  // gaps are left out
+        response.printf("%s[%lu,%ld,%ld,%ld,%lu]", first ? "" : ",", (unsigned long)t, (long)bucket.min,
+                        (long)bucket.max, (long)bucket.mean, (unsigned long)bucket.count);
+        first = false;
+    }
+    response.print("]}");
+    response.end();
+    logTransfer("chart", response);
+}
 
+// Entries [skip, skip + count) of an open directory; true if more follow
+bool printDirectory(ChunkedResponse& out, File& dir, uint32_t skip, uint32_t count, bool json) {
+    String base = dir.path();
+    if (!base.endsWith("/")) base += "/";
+    uint32_t index = 0;
     File file = dir.openNextFile();
     while (file) {
-        webpage += "<tr><td>" + String(file.name()) + "</td>";
-        webpage += "<td>" + String(file.isDirectory() ? "Dir" : "File") + "</td>";
-        webpage += "<td>" + (file.isDirectory() ? String("—") : file_size(file.size())) + "</td>";
-
-        if (!file.isDirectory()) {
-            String name = String(file.name());
-            webpage += "<td>";
-            webpage += "<form method='post' style='display:inline'>";
-            webpage += "<button name='download_' value='" + name + "'>Download</button></form>";
-            webpage += "<form method='post' style='display:inline'>";
-            webpage += "<button name='delete_' value='" + name + "'>Delete</button></form>";
-            webpage += "</td>";
-        } else {
-            webpage += "<td>—</td>";
+        if (index >= skip + count) {
+            file.close();
+            return true;
+        }
+        if (index++ >= skip) {
+            // full path without the leading '/', as download_ and delete_ take it
+            const char* name = file.name();
+            const char* slash = strrchr(name, '/');
+            if (slash) name = slash + 1;
+            String target = base.substring(1) + name;
+            bool isDir = file.isDirectory();
+            if (json) {
+                out.print(index - 1 > skip ? ",{\"name\":\"" : "{\"name\":\"");
+                printJson(out, name);
+                out.printf("\",\"dir\":%s,\"size\":%lu}", isDir ? "true" : "false",
+                           isDir ? 0UL : (unsigned long)file.size());
+            } else if (isDir) {
+                out.print(F("<tr><td><a href='/?dir=/"));
+                printUrl(out, target.c_str());
+                out.print(F("'>"));
+                printHtml(out, name);
+                out.print(F("</a></td><td>Dir</td><td>—</td><td>—</td></tr>"));
+            } else {
+                out.print(F("<tr><td>"));
+                printHtml(out, name);
+                out.printf("</td><td>File</td><td>%s</td><td>", file_size(file.size()).c_str());
+                out.print(F("<form method='post' style='display:inline'><button name='download_' value='"));
+                printHtml(out, target.c_str());
+                out.print(F("'>Download</button></form><form method='post' style='display:inline'><button name='delete_' value='"));
+                printHtml(out, target.c_str());
+                out.print(F("'>Delete</button></form></td></tr>"));
+            }
         }
-
-        webpage += "</tr>";
-        if (file.isDirectory() && levels > 0) printDirectory(file.name(), levels - 1);
         file.close();
         file = dir.openNextFile();
     }
-    dir.close();
+    return false;
+}
+
+void SD_collectHeaders() {
+    static const char* keys[] = { "Range", "If-Range", "Accept-Encoding", "If-None-Match" };
+    server.collectHeaders(keys, sizeof(keys) / sizeof(keys[0]));
+}
+
+// Strong validator: a log's size changes with every append
+static String fileETag(File& file) {
+    char tag[24];
+    snprintf(tag, sizeof(tag), "\"%lx-%lx\"", (unsigned long)file.size(), (unsigned long)file.getLastWrite());
+    return String(tag);
+}
+
+// Body of a response whose headers are out
+static void sendFileRange(File& file, size_t start, size_t length, Print& out) {
+    if (!file.seek(start)) return;
+    while (length > 0) {
+        size_t n = file.read(copyBuffer, min(length, sizeof(copyBuffer)));
+        if (n == 0 || out.write(copyBuffer, n) != n) break;
+        length -= n;
+    }
+}
+
+// Text compresses well; binary logs are already packed
+static bool isText(const String& filename) {
+    static const char* const extensions[] = { ".csv", ".txt", ".json", ".log", ".htm", ".html" };
+    String name = filename;
+    name.toLowerCase();
+    for (const char* extension : extensions) {
+        if (name.endsWith(extension)) return true;
+    }
+    return false;
 }
 
+// Whole file, or with Range one byte range of it (206) so an interrupted
+// download can resume; If-Range drops the range once the file has changed.
+// A text file asked for whole goes out gzipped if the client takes it; that
+// body has no length up front, so it is chunked and offers no ranges.
 void SD_file_download(const String& filename) {
     if (!SD_present) { ReportSDNotPresent(); return; }
     File file = SD.open("/" + filename);
-    if (file) {
-        server.sendHeader("Content-Type", "application/octet-stream");
-        server.sendHeader("Content-Disposition", "attachment; filename=" + filename);
-        server.streamFile(file, "application/octet-stream");
-        file.close();
-    } else {
+    if (!file || file.isDirectory()) {
+        if (file) file.close();
         ReportFileNotPresent("download");
+        return;
+    }
+    size_t size = file.size();
+    String etag = fileETag(file);
+    size_t start = 0, end = size - 1;
+    bool partial = false, satisfiable = true;
+    if (server.hasHeader("Range") && (!server.hasHeader("If-Range") || server.header("If-Range") == etag)) {
+        partial = parseRange(server.header("Range").c_str(), size, start, end, satisfiable);
+    }
+    if (partial && !satisfiable) {
+        file.close();
+        server.sendHeader("Content-Range", "bytes */" + String(size));
+        server.send(416, "text/plain", "");
+        return;
+    }
+
+    String name = filename.substring(filename.lastIndexOf('/') + 1);
+    if (!partial && isText(filename) && acceptsGzip()) {
+        String headers = "Content-Disposition: attachment; filename=" + name + "\r\nETag: " +
+                         etag.substring(0, etag.length() - 1) + "-gz\"\r\n";  // another representation
+        ChunkedResponse response(server.client());
+        response.begin(200, "application/octet-stream", headers.c_str(), true);
+        sendFileRange(file, 0, size, response);
+        file.close();
+        response.end();
+        logTransfer("download", response);
+        return;
+    }
+
+    size_t length = size ? end - start + 1 : 0;
+    server.sendHeader("Content-Disposition", "attachment; filename=" + name);
+    server.sendHeader("Accept-Ranges", "bytes");
+    server.sendHeader("ETag", etag);
+    if (partial) server.sendHeader("Content-Range", "bytes " + String(start) + "-" + String(end) + "/" + String(size));
+    server.setContentLength(length);
+    server.send(partial ? 206 : 200, "application/octet-stream", "");
+    WiFiClient client = server.client();
+    sendFileRange(file, start, length, client);
+    file.close();
+}
+
+// A binary log as CSV while it streams: ?file=log/YYYYMMDD.bin[&from=&to=]
+void SD_export() {
+    if (!SD_present) { ReportSDNotPresent(); return; }
+    if (!server.hasArg("file")) {
+        server.send(400, "text/plain", "file required");
+        return;
+    }
+    String filename = server.arg("file");
+    uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+    uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+    static LogQuery query;
+    if (!query.begin(SD, ("/" + filename).c_str(), from, to)) {
+        ReportFileNotPresent("export");
+        return;
+    }
+
+    String name = filename.substring(filename.lastIndexOf('/') + 1);
+    int dot = name.lastIndexOf('.');
+    if (dot > 0) name = name.substring(0, dot);
+    char disposition[64];
+    snprintf(disposition, sizeof(disposition), "Content-Disposition: attachment; filename=%s.csv\r\n", name.c_str());
+    ChunkedResponse response(server.client());
+    response.begin(200, "text/csv", disposition, acceptsGzip());
+    response.print(F(LOG_QUERY_CSV_HEADER "\n"));
+    LogRecord record;
+    char line[LOG_QUERY_CSV_LEN];
+    while (response.ok() && query.next(record)) {
+        LogQuery::formatCsv(line, sizeof(line), record);
+        response.print(line);
+        response.print('\n');
     }
+    query.end();
+    response.end();
+    logTransfer("export", response);
 }
 
 void SD_file_delete(const String& filename) {
     if (!SD_present) { ReportSDNotPresent(); return; }
     if (SD.remove("/" + filename)) {
         append_page_header();
-        webpage += "<h3>Deleted " + filename + "</h3><a href='/'>Back</a>";
+        webpage += F("<h3>Deleted ");
+        printHtml(webpageOut, filename.c_str());
+        webpage += F("</h3><a href='/'>Back</a>");
         append_page_footer();
         server.send(200, "text/html", webpage);
         webpage = "";
@@ -144,15 +522,35 @@ void SD_file_delete(const String& filename) {
     }
 }
 
+// The stylesheet from flash, gzipped if the client takes it. no-cache has
+// the browser check its copy each time, which costs a 304 and no body until
+// a firmware update changes the CSS.
+void SendCSS() {
+    bool gzip = acceptsGzip();
+    char etag[16];
+    snprintf(etag, sizeof(etag), gzip ? "\"%08lx-gz\"" : "\"%08lx\"", (unsigned long)PAGE_CSS_CRC);
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendHeader("Vary", "Accept-Encoding");
+    if (server.hasHeader("If-None-Match") && server.header("If-None-Match").indexOf(etag) >= 0) {
+        server.send(304, "text/css", "");
+        return;
+    }
+    const uint8_t* body = gzip ? PAGE_CSS_GZ : (const uint8_t*)PAGE_CSS;
+    size_t length = gzip ? sizeof(PAGE_CSS_GZ) : sizeof(PAGE_CSS) - 1;
+    if (gzip) server.sendHeader("Content-Encoding", "gzip");
+    server.setContentLength(length);
+    server.send(200, "text/css", "");
+    server.client().write(body, length);
+}
+
 void SendHTML_Header() {
     server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     server.sendHeader("Pragma", "no-cache");
     server.sendHeader("Expires", "-1");
     server.setContentLength(CONTENT_LENGTH_UNKNOWN);
     server.send(200, "text/html", "");
-    append_page_header();
-    server.sendContent(webpage);
-    webpage = "";
+    server.sendContent_P(PAGE_HEADER);
 }
 
 void SendHTML_Content() {
@@ -175,7 +573,9 @@ void ReportSDNotPresent() {
 
 void ReportFileNotPresent(const String& target) {
     SendHTML_Header();
-    webpage += "<h3>File not found: " + target + "</h3><a href='/'>Back</a>";
+    webpage += F("<h3>File not found: ");
+    printHtml(webpageOut, target.c_str());
+    webpage += F("</h3><a href='/'>Back</a>");
     append_page_footer();
     SendHTML_Content();
     SendHTML_Stop();
@@ -183,7 +583,9 @@ void ReportFileNotPresent(const String& target) {
 
 void ReportCouldNotCreateFile(const String& target) {
     SendHTML_Header();
-    webpage += "<h3>Could not create file: " + target + "</h3><a href='/'>Back</a>";
+    webpage += F("<h3>Could not create file: ");
+    printHtml(webpageOut, target.c_str());
+    webpage += F("</h3><a href='/'>Back</a>");
     append_page_footer();
     SendHTML_Content();
     SendHTML_Stop();
@@ -4,26 +4,49 @@
 #include <Arduino.h>
 #include <SD.h>
 #include <ESP32WebServer.h>
+#include "log_rollup.h"
+#include "chunked_response.h"
+
+#define DIR_PAGE_SIZE 50           // listing rows per page unless ?per= says otherwise
+#define DIR_PAGE_MAX 500
+#define SD_COPY_BUFFER 4096        // file bytes per read for download bodies
+// Listings, queries, charts, exports and whole text downloads are gzipped
+// when Accept-Encoding allows; each response logs its KB/s and the
+// compressor's CPU ms per MB
+
+// SD card on HSPI: the VSPI defaults (18, 23) carry the ultrasonic echo
+// and the CCS811 nWAKE line
+#define SD_SCK_PIN 26
+#define SD_MISO_PIN 19
+#define SD_MOSI_PIN 13
+#define SD_CS_PIN 32
 
 // These externs must be defined in your main sketch
 extern ESP32WebServer server;
 extern bool SD_present;
 extern String webpage;
+extern LogRollup rollups;
 
-// Initialize SD card (call in setup)
+// Initialize SD card on HSPI (call in setup)
 void SD_init(uint8_t sdPin);
 
 // HTTP endpoint handlers
+void SD_routes();  // registers the handlers below on server, before server.begin()
 void SD_dir();
 void File_Upload();
-void handleFileUpload();
+void handleFileUpload();  // ?crc32= (hex) is checked before the file is replaced
+void SD_query();   // ?from=&to=[&signal=&zone=], epoch s -> CSV of logged samples
+void SD_chart();   // ?signal=&from=&to=[&zone=&points=] -> JSON min/max/mean/count per point
+void SD_export();  // ?file=[&from=&to=] -> a binary log as CSV
 
 // File operations
-void printDirectory(const char* dirname, uint8_t levels);
-void SD_file_download(const String& filename);
+bool printDirectory(ChunkedResponse& out, File& dir, uint32_t skip, uint32_t count, bool json);
+void SD_file_download(const String& filename);  // honours Range / If-Range, gzips text
+void SD_collectHeaders();  // before server.begin(): the request headers the handlers read
 void SD_file_delete(const String& filename);
 
 // HTML helper functions
+void SendCSS();  // GET /style.css, the stylesheet the page header links
 void SendHTML_Header();
 void SendHTML_Content();
 void SendHTML_Stop();
@@ -0,0 +1,75 @@
+#include "sensor_filter.h"
+
+SensorFilter::SensorFilter(float processNoise, float measurementNoise, float minSpread, float hampelK)
+    : _q(processNoise), _r(measurementNoise), _minSpread(minSpread), _k(hampelK) {
+    reset();
+}
+
+void SensorFilter::reset() {
+    _head = 0;
+    _count = 0;
+    _x = 0;
+    _p = _r;
+    _noise = 0;
+    _lastRejected = false;
+    _rejected = 0;
+}
+
+float SensorFilter::update(float sample) {
+    if (isnan(sample) || isinf(sample)) {
+        _lastRejected = true;
+        _rejected++;
+        return _x;
+    }
+
+    // Hampel: replace samples further than k * MAD from the window median
+    float z = sample;
+    _lastRejected = false;
+    if (_count >= HAMPEL_WINDOW) {
+        float scratch[HAMPEL_WINDOW];
+        memcpy(scratch, _window, sizeof(scratch));
+        float med = median(scratch, HAMPEL_WINDOW);
+        for (uint8_t i = 0; i < HAMPEL_WINDOW; i++) scratch[i] = fabs(_window[i] - med);
+        float mad = 1.4826 * median(scratch, HAMPEL_WINDOW);
+        if (mad < _minSpread) mad = _minSpread;
+        if (fabs(sample - med) > _k * mad) {
+            z = med;
+            _lastRejected = true;
+            _rejected++;
+        }
+    }
+    // The raw sample still enters the window so a genuine step is accepted
+    // once it holds for more than half the window.
+    _window[_head] = sample;
+    _head = (_head + 1) % HAMPEL_WINDOW;
+
+    if (_count == 0) {
+        _x = z;
+        _p = _r;
+    } else {
+        // Scalar Kalman: random-walk model
+        float innovation = z - _x;
+        float squared = innovation * innovation;
+        _noise = _count == 1 ? squared : _noise + FILTER_NOISE_WEIGHT * (squared - _noise);
+        _p += _q;
+        float gain = _p / (_p + _r);
+        _x += gain * innovation;
+        _p *= (1 - gain);
+    }
+    if (_count < 255) _count++;
+    return _x;
+}
+
+float SensorFilter::median(float* values, uint8_t n) {
+    // insertion sort, n is HAMPEL_WINDOW
+    for (uint8_t i = 1; i < n; i++) {
+        float v = values[i];
+        int8_t j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+    return values[n / 2];
+}
@@ -0,0 +1,45 @@
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <Arduino.h>
+
+// Samples kept for the Hampel median; odd so the median is a real sample
+#define HAMPEL_WINDOW 5
+// EWMA weight of the squared innovation, about the last 20 samples
+#define FILTER_NOISE_WEIGHT 0.05
+
+// Per-sensor streaming filter: Hampel outlier rejection on a fixed 5-sample
+// window, then a scalar Kalman filter. Constant memory and time per sample.
+class SensorFilter {
+public:
+    // processNoise: expected drift variance per sample
+    // measurementNoise: sensor noise variance
+    // minSpread: MAD floor so a flat window does not reject every real change
+    SensorFilter(float processNoise, float measurementNoise, float minSpread, float hampelK = 3.0);
+
+    float update(float sample); // returns the filtered estimate
+    void reset();
+
+    float estimate() const { return _x; }
+    float variance() const { return _p; }  // Kalman error variance, converges to a constant set by q and r
+    // Running variance of the innovation (reading after Hampel minus the
+    // prior estimate): how far the readings actually scatter around it
+    float noiseVariance() const { return _noise; }
+    bool primed() const { return _count >= HAMPEL_WINDOW; }
+    bool lastRejected() const { return _lastRejected; }
+    uint32_t rejected() const { return _rejected; }
+
+private:
+    float _window[HAMPEL_WINDOW];
+    uint8_t _head;
+    uint8_t _count;
+    float _q, _r, _minSpread, _k;
+    float _x, _p;
+    float _noise;
+    bool _lastRejected;
+    uint32_t _rejected;
+
+    static float median(float* values, uint8_t n);
+};
+
+#endif // SENSOR_FILTER_H
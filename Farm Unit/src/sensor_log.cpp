@@ -0,0 +1,319 @@
+#include "sensor_log.h"
+#include <rom/crc.h>
+#include <time.h>
+
+void SensorLog::begin(fs::FS& fs) {
+    _fs = &fs;
+    _fs->mkdir(LOG_DIR);
+
+    // Carry the block numbering over from the last boot: the newest block of
+    // each file, a torn tail only has to keep its header
+    File dir = _fs->open(LOG_DIR);
+    File file = dir ? dir.openNextFile() : File();
+    while (file) {
+        size_t whole = file.size() - file.size() % LOG_BLOCK_SIZE;
+        LogBlockHeader header;
+        if (whole >= LOG_BLOCK_SIZE && file.seek(whole - LOG_BLOCK_SIZE) &&
+            file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == LOG_MAGIC && header.seq >= _seq) {
+            _seq = header.seq + 1;
+        }
+        file.close();
+        file = dir.openNextFile();
+    }
+    if (dir) dir.close();
+
+    _sealed = 0;
+    _packed.header.count = 0;
+    for (Series& series : _series) series.used = false;
+}
+
+void SensorLog::setEpoch(uint32_t epoch, unsigned long nowMs) {
+    _epochBaseMs = (uint64_t)epoch * 1000 - nowMs;
+    _epochSet = true;
+}
+
+void SensorLog::append(uint8_t signal, uint8_t zone, float value, unsigned long nowMs) {
+    if (!_fs) return;
+    uint64_t ms = clockMs(nowMs);
+    uint8_t flags = _epochSet ? 0 : LOG_FLAG_UPTIME;
+    LogRecord record = { (uint32_t)(ms / 1000), (uint16_t)(ms % 1000), signal, zone, (int32_t)lroundf(value * 1000) };
+
+    // One file per day and time base: a block never straddles them
+    Series* series = find(signal, zone);
+    if (series && (series->block.header.flags != flags || firstTime(series->block) / 86400 != record.time / 86400)) {
+        seal(*series, nowMs);
+        series = nullptr;
+    }
+    if (series && !series->encoder.add(series->block, ms, record.value)) {
+        seal(*series, nowMs);
+        series = nullptr;
+    }
+    if (!series) {
+        series = &slot();
+        if (series->used) seal(*series, nowMs);
+        series->used = true;
+        series->signal = signal;
+        series->zone = zone;
+        series->openedMs = nowMs;
+        series->encoder.start(series->block, record);
+        series->block.header.flags = flags;
+    }
+    _records++;
+}
+
+SensorLog::Series* SensorLog::find(uint8_t signal, uint8_t zone) {
+    for (Series& series : _series) {
+        if (series.used && series.signal == signal && series.zone == zone) return &series;
+    }
+    return nullptr;
+}
+
+// A free slot, or else the one open longest
+SensorLog::Series& SensorLog::slot() {
+    Series* oldest = &_series[0];
+    for (Series& series : _series) {
+        if (!series.used) return series;
+        if ((long)(series.openedMs - oldest->openedMs) < 0) oldest = &series;
+    }
+    return *oldest;
+}
+
+void SensorLog::seal(Series& series, unsigned long nowMs) {
+    series.used = false;
+    if (series.block.header.length >= LOG_SERIES_OWN_BLOCK) {
+        queue(series.block, nowMs);
+    } else {
+        pack(series.block, nowMs);
+    }
+}
+
+// Adds a short series to the packed block; one of another file goes in a new one
+void SensorLog::pack(const LogBlock& block, unsigned long nowMs) {
+    LogSegment segment = { block.header.count, block.header.length };
+    if (_packed.header.count > 0 &&
+        (_packed.header.flags != block.header.flags || firstTime(_packed) / 86400 != firstTime(block) / 86400 ||
+         _packed.header.length + sizeof(segment) + segment.length > LOG_PAYLOAD_SIZE)) {
+        queue(_packed, nowMs);
+        _packed.header.count = 0;
+    }
+    if (_packed.header.count == 0) {
+        memset(&_packed, 0, sizeof(_packed));
+        _packed.header.magic = LOG_MAGIC;
+        _packed.header.type = LOG_BLOCK_PACKED;
+        _packed.header.flags = block.header.flags;
+        _packedSinceMs = nowMs;
+    }
+    uint8_t* out = _packed.payload + _packed.header.length;
+    memcpy(out, &segment, sizeof(segment));
+    memcpy(out + sizeof(segment), block.payload, segment.length);
+    _packed.header.count += segment.count;
+    _packed.header.length += sizeof(segment) + segment.length;
+}
+
+void SensorLog::queue(const LogBlock& block, unsigned long nowMs) {
+    if (_sealed >= LOG_BUFFER_BLOCKS) {
+        _dropped += block.header.count;  // the card is not keeping up
+        return;
+    }
+    LogBlock& sealed = _blocks[_sealed];
+    sealed = block;
+    sealed.header.seq = _seq++;
+    sealed.header.crc = blockCrc(sealed);
+    if (_sealed == 0) _sealedSinceMs = nowMs;
+    _sealed++;
+}
+
+bool SensorLog::flushDue(unsigned long nowMs) const {
+    if (!_fs) return false;
+    if (_sealed >= LOG_FLUSH_BLOCKS) return true;
+    if (_sealed > 0 && nowMs - _sealedSinceMs >= LOG_MAX_AGE_MS) return true;
+    for (const Series& series : _series) {
+        if (series.used && nowMs - series.openedMs >= LOG_SERIES_MAX_AGE_MS) return true;
+    }
+    return _packed.header.count > 0 && nowMs - _packedSinceMs >= LOG_PACK_MAX_AGE_MS;
+}
+
+uint8_t SensorLog::flush(unsigned long nowMs) {
+    if (!_fs) return 0;
+    for (Series& series : _series) {
+        if (series.used && nowMs - series.openedMs >= LOG_SERIES_MAX_AGE_MS) seal(series, nowMs);
+    }
+    if (_packed.header.count > 0 && nowMs - _packedSinceMs >= LOG_PACK_MAX_AGE_MS) {
+        queue(_packed, nowMs);
+        _packed.header.count = 0;
+    }
+
+    // Runs of blocks bound for the same file, one write each
+    uint8_t done = 0;
+    while (done < _sealed) {
+        const LogBlock& first = _blocks[done];
+        uint8_t run = 1;
+        while (done + run < _sealed &&
+               _blocks[done + run].header.flags == first.header.flags &&
+               firstTime(_blocks[done + run]) / 86400 == firstTime(first) / 86400) {
+            run++;
+        }
+        if (!write(&_blocks[done], run)) break;
+        done += run;
+    }
+    if (done == 0) return 0;
+
+    memmove(_blocks, _blocks + done, (_sealed - done) * sizeof(LogBlock));
+    _sealed -= done;
+    if (_sealed > 0) _sealedSinceMs = nowMs;
+    return done;
+}
+
+bool SensorLog::write(const LogBlock* blocks, uint8_t count) {
+    char path[32];
+    filePath(path, sizeof(path), firstTime(blocks[0]) / 86400, blocks[0].header.flags);
+    File file = _fs->open(path, FILE_APPEND, true);
+    if (!file) {
+        _writeErrors++;
+        return false;
+    }
+    // A crash mid-write leaves a partial block: pad it out so the new blocks
+    // stay aligned, readers drop it on its CRC
+    size_t size = file.size();
+    size_t tail = size % LOG_BLOCK_SIZE;
+    if (tail) {
+        static const uint8_t zeros[LOG_BLOCK_SIZE] = {};
+        file.write(zeros, LOG_BLOCK_SIZE - tail);
+    }
+    uint32_t first = (size + LOG_BLOCK_SIZE - 1) / LOG_BLOCK_SIZE;
+    size_t bytes = count * sizeof(LogBlock);
+    bool ok = file.write((const uint8_t*)blocks, bytes) == bytes;
+    file.close();
+    if (!ok) {
+        _writeErrors++;
+        return false;
+    }
+    index(firstTime(blocks[0]) / 86400, blocks[0].header.flags, first, blocks, count);
+    _blocksWritten += count;
+    for (uint8_t i = 0; i < count; i++) _recordsWritten += blocks[i].header.count;
+    _writes++;
+    return true;
+}
+
+// Appends the index entry for blocks [first, first + count) of the day's file.
+// Blocks the index does not cover yet (a crash between the two writes, a torn
+// or missing index) are read back from the card and folded into the entry, so
+// the entries always tile the file from block 0.
+void SensorLog::index(uint32_t day, uint8_t flags, uint32_t first, const LogBlock* blocks, uint8_t count) {
+    char path[32];
+    filePath(path, sizeof(path), day, flags, "idx");
+    LogIndexEntry entry = { 0, 0, 0, UINT32_MAX, 0 };
+    File file = _fs->open(path, FILE_READ);
+    if (file) {
+        size_t size = file.size();
+        LogIndexEntry last;
+        bool ok = size % sizeof(last) == 0;
+        if (ok && size > 0) {
+            ok = file.seek(size - sizeof(last)) && file.read((uint8_t*)&last, sizeof(last)) == sizeof(last) &&
+                 last.block + last.blocks <= first;
+            entry.block = last.block + last.blocks;
+            entry.maxTime = last.maxTime;
+        }
+        file.close();
+        if (!ok) {
+            _fs->remove(path);  // rebuilt from block 0 below
+            entry.block = 0;
+            entry.maxTime = 0;
+        }
+    }
+
+    uint32_t minTime, maxTime;
+    if (entry.block < first) {
+        filePath(path, sizeof(path), day, flags);
+        file = _fs->open(path, FILE_READ);
+        LogBlock block;
+        for (uint32_t n = entry.block; file && n < first; n++) {
+            if (!file.seek(n * LOG_BLOCK_SIZE) || file.read((uint8_t*)&block, sizeof(block)) != sizeof(block)) break;
+            if (!blockSpan(block, minTime, maxTime)) continue;
+            entry.minTime = min(entry.minTime, minTime);
+            entry.maxTime = max(entry.maxTime, maxTime);
+        }
+        if (file) file.close();
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (!blockSpan(blocks[i], minTime, maxTime)) continue;
+        entry.minTime = min(entry.minTime, minTime);
+        entry.maxTime = max(entry.maxTime, maxTime);
+    }
+    entry.blocks = first + count - entry.block;
+
+    filePath(path, sizeof(path), day, flags, "idx");
+    file = _fs->open(path, FILE_APPEND, true);
+    if (!file || file.write((const uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) _writeErrors++;
+    if (file) file.close();
+}
+
+bool SensorLog::blockSpan(const LogBlock& block, uint32_t& minTime, uint32_t& maxTime) {
+    if (block.header.magic != LOG_MAGIC || block.header.count == 0 || block.header.crc != blockCrc(block)) return false;
+    minTime = UINT32_MAX;
+    maxTime = 0;
+    LogRecord record;
+    if (block.header.type == LOG_BLOCK_SERIES) {
+        SeriesDecoder decoder(block);
+        while (decoder.next(record)) {
+            minTime = min(minTime, record.time);
+            maxTime = max(maxTime, record.time);
+        }
+    } else if (block.header.type == LOG_BLOCK_PACKED) {
+        SeriesDecoder decoder;
+        LogSegment part;
+        uint16_t offset = 0;
+        while (const uint8_t* data = segment(block, offset, part)) {
+            decoder.start(data, part.count, part.length);
+            while (decoder.next(record)) {
+                minTime = min(minTime, record.time);
+                maxTime = max(maxTime, record.time);
+            }
+        }
+    } else if (block.header.type == LOG_BLOCK_RAW) {
+        for (uint16_t i = 0; i < block.header.count && i < LOG_RECORDS_PER_BLOCK; i++) {
+            memcpy(&record, block.payload + i * sizeof(record), sizeof(record));
+            minTime = min(minTime, record.time);
+            maxTime = max(maxTime, record.time);
+        }
+    }
+    return minTime <= maxTime;
+}
+
+const uint8_t* SensorLog::segment(const LogBlock& block, uint16_t& offset, LogSegment& segment) {
+    uint16_t used = min(block.header.length, (uint16_t)LOG_PAYLOAD_SIZE);
+    if (offset + sizeof(segment) > used) return nullptr;
+    memcpy(&segment, block.payload + offset, sizeof(segment));
+    const uint8_t* data = block.payload + offset + sizeof(segment);
+    if (segment.length < sizeof(LogRecord) || offset + sizeof(segment) + segment.length > used) return nullptr;
+    offset += sizeof(segment) + segment.length;
+    return data;
+}
+
+// A packed block's first series starts after its segment header
+uint32_t SensorLog::firstTime(const LogBlock& block) {
+    LogRecord record;
+    size_t at = block.header.type == LOG_BLOCK_PACKED ? sizeof(LogSegment) : 0;
+    memcpy(&record, block.payload + at, sizeof(record));
+    return record.time;
+}
+
+uint32_t SensorLog::blockCrc(const LogBlock& block) {
+    static const uint8_t zero[sizeof(block.header.crc)] = {};
+    uint32_t crc = crc32_le(0, (const uint8_t*)&block.header, offsetof(LogBlockHeader, crc));
+    crc = crc32_le(crc, zero, sizeof(zero));
+    return crc32_le(crc, block.payload, LOG_PAYLOAD_SIZE);
+}
+
+// LOG_DIR/YYYYMMDD.ext by UTC date, LOG_DIR/upNNNNN.ext by day since boot
+void SensorLog::filePath(char* out, size_t size, uint32_t day, uint8_t flags, const char* ext) {
+    if (flags & LOG_FLAG_UPTIME) {
+        snprintf(out, size, "%s/up%05lu.%s", LOG_DIR, (unsigned long)day, ext);
+        return;
+    }
+    time_t t = (time_t)day * 86400;
+    struct tm date;
+    gmtime_r(&t, &date);
+    snprintf(out, size, "%s/%04d%02d%02d.%s", LOG_DIR, date.tm_year + 1900, date.tm_mon + 1, date.tm_mday, ext);
+}
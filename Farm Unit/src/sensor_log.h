@@ -0,0 +1,99 @@
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "log_block.h"
+#include "series_codec.h"
+
+// On-card time series in the log_block.h format. Every (signal, zone) series
+// fills its own compressed block (series_codec.h). A series that fills most
+// of it goes out as that block; one that was cut short by age, eviction or
+// the day is packed with others into a shared block, so slow series do not
+// cost a block each. Sealed blocks are queued and go to the card several at
+// a time, appended to one file per day, with a sparse time index
+// (LogIndexEntry) beside it.
+#define LOG_SERIES_MAX 13          // open series blocks; the stalest is sealed for a new one
+#define LOG_SERIES_MAX_AGE_MS 600000  // a part-filled series block is sealed after this
+#define LOG_SERIES_OWN_BLOCK (LOG_PAYLOAD_SIZE / 2)  // payload bytes from which a series is not packed
+#define LOG_PACK_MAX_AGE_MS 900000  // a packed block takes more series for at most this
+#define LOG_FLUSH_BLOCKS 8         // 4 KB per write once this many are sealed
+#define LOG_BUFFER_BLOCKS 10       // slack while the flush task gets to run
+#define LOG_MAX_AGE_MS 60000       // a sealed block waits at most this for its write
+#define LOG_DIR "/log"
+
+class SensorLog {
+public:
+    // Nothing is logged until a card is attached
+    void begin(fs::FS& fs);
+    bool active() const { return _fs != nullptr; }
+
+    // Hub time; until the first sync records carry uptime
+    void setEpoch(uint32_t epoch, unsigned long nowMs);
+    bool hasEpoch() const { return _epochSet; }
+    uint32_t epoch(unsigned long nowMs) const { return _epochSet ? clockMs(nowMs) / 1000 : 0; }
+
+    // RAM only, no card access
+    void append(uint8_t signal, uint8_t zone, float value, unsigned long nowMs);
+
+    // Enough sealed blocks for one write, or one of them or a series is due
+    bool flushDue(unsigned long nowMs) const;
+    // Seals aged series and writes the sealed blocks; returns blocks written
+    uint8_t flush(unsigned long nowMs);
+
+    uint32_t records() const { return _records; }
+    uint32_t recordsWritten() const { return _recordsWritten; }
+    uint32_t blocksWritten() const { return _blocksWritten; }
+    uint32_t writes() const { return _writes; }
+    uint32_t dropped() const { return _dropped; }
+    uint32_t writeErrors() const { return _writeErrors; }
+
+    static uint32_t blockCrc(const LogBlock& block);
+    // Earliest and latest sample of a block; false if it is not a valid block
+    static bool blockSpan(const LogBlock& block, uint32_t& minTime, uint32_t& maxTime);
+    // Series payload of the packed block's segment at offset, which moves on to
+    // the next one; nullptr after the last or at a segment that does not fit
+    static const uint8_t* segment(const LogBlock& block, uint16_t& offset, LogSegment& segment);
+    static void filePath(char* out, size_t size, uint32_t day, uint8_t flags, const char* ext = "bin");
+
+private:
+    fs::FS* _fs = nullptr;
+    bool _epochSet = false;
+    uint64_t _epochBaseMs = 0;      // epoch ms at millis() == 0
+
+    struct Series {
+        bool used;
+        uint8_t signal;
+        uint8_t zone;
+        unsigned long openedMs;
+        SeriesEncoder encoder;
+        LogBlock block;
+    };
+
+    Series _series[LOG_SERIES_MAX] = {};
+    LogBlock _packed;               // short series so far, none while its count is 0
+    unsigned long _packedSinceMs = 0;
+    LogBlock _blocks[LOG_BUFFER_BLOCKS];
+    uint8_t _sealed = 0;            // blocks waiting for the card
+    unsigned long _sealedSinceMs = 0;  // when _blocks[0] was sealed
+    uint32_t _seq = 0;
+
+    uint32_t _records = 0;
+    uint32_t _recordsWritten = 0;
+    uint32_t _blocksWritten = 0;
+    uint32_t _writes = 0;
+    uint32_t _dropped = 0;
+    uint32_t _writeErrors = 0;
+
+    Series* find(uint8_t signal, uint8_t zone);
+    Series& slot();
+    void seal(Series& series, unsigned long nowMs);
+    void pack(const LogBlock& block, unsigned long nowMs);
+    void queue(const LogBlock& block, unsigned long nowMs);
+    bool write(const LogBlock* blocks, uint8_t count);
+    void index(uint32_t day, uint8_t flags, uint32_t first, const LogBlock* blocks, uint8_t count);
+    uint64_t clockMs(unsigned long nowMs) const { return _epochSet ? _epochBaseMs + nowMs : nowMs; }
+    static uint32_t firstTime(const LogBlock& block);
+};
+
+#endif // SENSOR_LOG_H
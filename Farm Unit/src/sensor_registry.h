@@ -0,0 +1,93 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Compile-time sensor registry. Sensors and telemetry channels are plain
+// structs with static members, listed once as template arguments; every
+// call below expands to straight-line code, nothing is looked up at runtime.
+//
+// A sampled sensor provides
+//   static void begin();           pins and bus setup
+//   static Task& task();           its periodic sampling task
+//   static uint32_t periodMs();    current sampling period
+//
+// A telemetry channel derives from SensorChannel<slot, scale, Sensor> and
+// provides name(), unit(), value() and setpoint(). Slot n is entry n of the
+// "sv" and "ss" arrays, encoded as round(value * scale).
+
+template <uint8_t Slot, int Scale, typename Sensor>
+struct SensorChannel {
+    static const uint8_t SLOT = Slot;
+    static const int SCALE = Scale;
+    typedef Sensor Source;
+
+    static int32_t encode(float value) { return (int32_t)lroundf(value * Scale); }
+};
+
+// Adds every sensor's task to the scheduler at its current period
+template <typename... Sensors>
+struct SensorTable;
+
+template <>
+struct SensorTable<> {
+    static const size_t COUNT = 0;
+    template <typename S> static void begin(S&) {}
+};
+
+template <typename First, typename... Rest>
+struct SensorTable<First, Rest...> {
+    static const size_t COUNT = 1 + sizeof...(Rest);
+
+    template <typename S> static void begin(S& scheduler) {
+        First::begin();
+        scheduler.addTask(First::task());
+        First::task().setInterval(First::periodMs());
+        First::task().enable();
+        SensorTable<Rest...>::begin(scheduler);
+    }
+};
+
+// Telemetry encoder and hub schema; channels must be listed in slot order
+template <size_t Slot, typename... Channels>
+struct ChannelLayout;
+
+template <size_t Slot>
+struct ChannelLayout<Slot> {
+    static const size_t COUNT = Slot;
+    static void values(JsonArray) {}
+    static void setpoints(JsonArray) {}
+    static void describe(JsonArray) {}
+};
+
+template <size_t Slot, typename First, typename... Rest>
+struct ChannelLayout<Slot, First, Rest...> {
+    static_assert(First::SLOT == Slot, "telemetry channels out of slot order");
+    static const size_t COUNT = ChannelLayout<Slot + 1, Rest...>::COUNT;
+
+    static void values(JsonArray out) {
+        out.add(First::encode(First::value()));
+        ChannelLayout<Slot + 1, Rest...>::values(out);
+    }
+
+    static void setpoints(JsonArray out) {
+        out.add(First::encode(First::setpoint()));
+        ChannelLayout<Slot + 1, Rest...>::setpoints(out);
+    }
+
+    // [name, scale, unit, period_s] per slot
+    static void describe(JsonArray out) {
+        JsonArray entry = out.add<JsonArray>();
+        entry.add(First::name());
+        entry.add((int)First::SCALE);
+        entry.add(First::unit());
+        entry.add((uint32_t)(First::Source::periodMs() / 1000));
+        ChannelLayout<Slot + 1, Rest...>::describe(out);
+    }
+};
+
+template <typename... Channels>
+using TelemetryLayout = ChannelLayout<0, Channels...>;
+
+#endif // SENSOR_REGISTRY_H
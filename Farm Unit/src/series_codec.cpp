@@ -0,0 +1,113 @@
+#include "series_codec.h"
+
+static const uint8_t TIME_WIDTHS[] = { 7, 9, 12, 32 };
+static const uint8_t VALUE_WIDTHS[] = { 6, 12, 20, 32 };
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t u) {
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+void SeriesEncoder::start(LogBlock& block, const LogRecord& first) {
+    memset(&block, 0, sizeof(block));
+    block.header.magic = LOG_MAGIC;
+    block.header.type = LOG_BLOCK_SERIES;
+    block.header.count = 1;
+    block.header.length = sizeof(LogRecord);
+    memcpy(block.payload, &first, sizeof(first));
+    _prevMs = (uint64_t)first.time * 1000 + first.ms;
+    _prevDelta = 0;
+    _prevValue = first.value;
+    _bits = 0;
+}
+
+bool SeriesEncoder::add(LogBlock& block, uint64_t timeMs, int32_t value) {
+    if (sizeof(LogRecord) * 8 + _bits + SERIES_MAX_SAMPLE_BITS > LOG_PAYLOAD_SIZE * 8) return false;
+    int32_t delta = (int32_t)(timeMs - _prevMs);
+    putField(block, zigzag(delta - _prevDelta), TIME_WIDTHS);
+    putField(block, zigzag((int32_t)((uint32_t)value - (uint32_t)_prevValue)), VALUE_WIDTHS);  // wraps, still lossless
+    _prevMs = timeMs;
+    _prevDelta = delta;
+    _prevValue = value;
+    block.header.count++;
+    block.header.length = sizeof(LogRecord) + (_bits + 7) / 8;
+    return true;
+}
+
+void SeriesEncoder::put(LogBlock& block, uint32_t bits, uint8_t width) {
+    uint8_t* out = block.payload + sizeof(LogRecord);
+    for (int8_t i = width - 1; i >= 0; i--) {
+        if ((bits >> i) & 1) out[_bits >> 3] |= 0x80 >> (_bits & 7);
+        _bits++;
+    }
+}
+
+void SeriesEncoder::putField(LogBlock& block, uint32_t zigzag, const uint8_t* widths) {
+    if (zigzag == 0) {
+        put(block, 0, 1);
+        return;
+    }
+    uint8_t i = 0;
+    while (i < 3 && zigzag >= (1UL << widths[i])) i++;
+    if (i < 3) {
+        put(block, ((1u << (i + 1)) - 1) << 1, i + 2);  // 10, 110, 1110
+    } else {
+        put(block, 0xF, 4);
+    }
+    put(block, zigzag, widths[i]);
+}
+
+void SeriesDecoder::start(const uint8_t* data, uint16_t count, uint16_t length) {
+    _data = data;
+    _count = length >= sizeof(LogRecord) ? count : 0;
+    _length = length;
+    rewind();
+}
+
+bool SeriesDecoder::next(LogRecord& record) {
+    if (_index >= _count) return false;
+    memcpy(&record, _data, sizeof(record));  // signal and zone for every sample
+    if (_index == 0) {
+        _prevMs = (uint64_t)record.time * 1000 + record.ms;
+        _prevValue = record.value;
+    } else {
+        int32_t delta = _prevDelta + unzigzag(getField(TIME_WIDTHS));
+        _prevValue = (int32_t)((uint32_t)_prevValue + (uint32_t)unzigzag(getField(VALUE_WIDTHS)));
+        if (_bitPos > (uint32_t)(_length - sizeof(LogRecord)) * 8) return false;  // ran off the payload
+        _prevMs += delta;
+        _prevDelta = delta;
+        record.time = _prevMs / 1000;
+        record.ms = _prevMs % 1000;
+        record.value = _prevValue;
+    }
+    _index++;
+    return true;
+}
+
+void SeriesDecoder::rewind() {
+    _index = 0;
+    _bitPos = 0;
+    _prevDelta = 0;
+}
+
+uint32_t SeriesDecoder::get(uint8_t width) {
+    const uint8_t* in = _data + sizeof(LogRecord);
+    uint32_t bits = 0;
+    for (uint8_t i = 0; i < width; i++) {
+        uint32_t byte = _bitPos >> 3;
+        uint8_t bit = byte < _length - sizeof(LogRecord) ? (in[byte] >> (7 - (_bitPos & 7))) & 1 : 0;
+        bits = (bits << 1) | bit;
+        _bitPos++;
+    }
+    return bits;
+}
+
+uint32_t SeriesDecoder::getField(const uint8_t* widths) {
+    uint8_t ones = 0;
+    while (ones < 4 && get(1)) ones++;
+    if (ones == 0) return 0;
+    return get(widths[ones - 1]);
+}
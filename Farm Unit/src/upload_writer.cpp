@@ -0,0 +1,115 @@
+#include "upload_writer.h"
+#include <rom/crc.h>
+
+bool UploadWriter::begin(fs::FS& fs, const String& path) {
+    abort();
+#if UPLOAD_WRITER_TASK
+    if (!_full) {  // once; without the task the handler writes
+        _full = xQueueCreate(UPLOAD_BUFFERS, sizeof(Job));
+        _free = xQueueCreate(UPLOAD_BUFFERS, sizeof(uint8_t));
+        if (_full && _free) {
+            xTaskCreatePinnedToCore(writerTask, "upload", UPLOAD_TASK_STACK, this, UPLOAD_TASK_PRIORITY, &_task,
+                                    UPLOAD_TASK_CORE);
+        }
+    }
+#endif
+    _fs = &fs;
+    _path = path;
+    _fill = 0;
+    _len = 0;
+    _crc = 0;
+    _bytes = 0;
+    _cardMicros = 0;
+    _failed = false;
+    _startMs = millis();
+    _doneMs = _startMs;
+    _file = _fs->open(_path + ".part", FILE_WRITE);
+    if (!_file) {
+        _failed = true;  // nothing to commit over the old file
+        return false;
+    }
+    if (_task) {
+        for (uint8_t slot = 1; slot < UPLOAD_BUFFERS; slot++) xQueueSend(_free, &slot, 0);
+    }
+    return true;
+}
+
+bool UploadWriter::write(const uint8_t* data, size_t len) {
+    if (!_file) return false;
+    _crc = crc32_le(_crc, data, len);
+    _bytes += len;
+    while (len > 0) {
+        size_t n = min(len, (size_t)UPLOAD_BUFFER_SIZE - _len);
+        memcpy(_buffers[_fill] + _len, data, n);
+        _len += n;
+        data += n;
+        len -= n;
+        if (_len == UPLOAD_BUFFER_SIZE) submit();
+    }
+    return !_failed;
+}
+
+bool UploadWriter::end() {
+    if (!_file) return false;
+    submit();
+    drain();
+    _file.close();
+    _doneMs = millis();
+    return !_failed;
+}
+
+bool UploadWriter::commit() {
+    if (!_fs || _file || _failed) return false;
+    String part = _path + ".part";
+    _fs->remove(_path);
+    return _fs->rename(part, _path);
+}
+
+void UploadWriter::abort() {
+    if (_file) {
+        _len = 0;
+        drain();
+        _file.close();
+        _doneMs = millis();
+    }
+    _failed = true;
+    if (_fs) _fs->remove(_path + ".part");
+}
+
+// Hands the filled part of the buffer to the card and takes a free buffer,
+// waiting while the writer still has all the others
+void UploadWriter::submit() {
+    Job job = { _fill, (uint16_t)_len };
+    _len = 0;
+    if (job.len == 0) return;
+    if (_task) {
+        xQueueSend(_full, &job, portMAX_DELAY);
+        xQueueReceive(_free, &_fill, portMAX_DELAY);
+        return;
+    }
+    store(job);
+}
+
+void UploadWriter::store(const Job& job) {
+    if (_failed) return;
+    uint32_t start = micros();
+    if (_file.write(_buffers[job.slot], job.len) != job.len) _failed = true;
+    _cardMicros += micros() - start;
+}
+
+// Waits until the writer has handed back every buffer but the filling one
+void UploadWriter::drain() {
+    if (!_task) return;
+    uint8_t slot;
+    for (uint8_t i = 1; i < UPLOAD_BUFFERS; i++) xQueueReceive(_free, &slot, portMAX_DELAY);
+}
+
+void UploadWriter::writerTask(void* parameter) {
+    UploadWriter* writer = (UploadWriter*)parameter;
+    Job job;
+    for (;;) {
+        if (xQueueReceive(writer->_full, &job, portMAX_DELAY) != pdTRUE) continue;
+        writer->store(job);
+        xQueueSend(writer->_free, &job.slot, portMAX_DELAY);
+    }
+}
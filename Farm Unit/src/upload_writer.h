@@ -0,0 +1,69 @@
+#ifndef UPLOAD_WRITER_H
+#define UPLOAD_WRITER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/queue.h>
+
+// Upload body to the card in whole buffers, each written at a multiple of
+// its size into the file, instead of the web server's ~1.4 KB pieces at
+// any offset. The handler fills one buffer from the socket while a writer
+// task on the IO core writes the other. The data goes to <path>.part, which
+// only replaces the file on commit(), so a broken upload leaves the old
+// file as it was. The gain over writing each piece has not been measured
+// on the board; every upload logs its KB/s and card time for comparison.
+#define UPLOAD_BUFFER_SIZE 4096    // 8 sectors, one card write
+#define UPLOAD_BUFFERS 2
+#define UPLOAD_WRITER_TASK 1       // 0: the handler writes each full buffer itself
+#define UPLOAD_TASK_CORE 0
+#define UPLOAD_TASK_STACK 3072
+#define UPLOAD_TASK_PRIORITY 1
+
+class UploadWriter {
+public:
+    bool begin(fs::FS& fs, const String& path);
+    bool write(const uint8_t* data, size_t len);
+    // Last buffer out and the .part file closed; false if a write failed
+    bool end();
+    // The finished .part file over the real one; false after a failed
+    // begin() or an abort()
+    bool commit();
+    // Stops writing and removes the .part file
+    void abort();
+
+    uint32_t crc() const { return _crc; }          // CRC-32 of the data so far
+    uint32_t bytes() const { return _bytes; }
+    uint32_t elapsedMs() const { return _doneMs - _startMs; }
+    uint32_t cardMs() const { return _cardMicros / 1000; }  // spent in card writes
+
+private:
+    struct Job {
+        uint8_t slot;
+        uint16_t len;
+    };
+
+    fs::FS* _fs = nullptr;
+    File _file;
+    String _path;
+    uint8_t _buffers[UPLOAD_BUFFERS][UPLOAD_BUFFER_SIZE];
+    uint8_t _fill = 0;             // the buffer taking data
+    size_t _len = 0;
+    uint32_t _crc = 0;
+    uint32_t _bytes = 0;
+    unsigned long _startMs = 0;
+    unsigned long _doneMs = 0;
+    // Written by the writer task, read once it has handed every buffer back
+    volatile uint32_t _cardMicros = 0;
+    volatile bool _failed = false;
+
+    TaskHandle_t _task = nullptr;
+    QueueHandle_t _full = nullptr;  // Jobs for the writer
+    QueueHandle_t _free = nullptr;  // slots it is done with
+
+    void submit();
+    void store(const Job& job);
+    void drain();
+    static void writerTask(void* parameter);
+};
+
+#endif // UPLOAD_WRITER_H
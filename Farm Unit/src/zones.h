@@ -0,0 +1,59 @@
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <Arduino.h>
+
+// Grow zones (tanks) driven by one controller. Each zone has its own pH/EC
+// probes, setpoints, relays and dosing loops; water temperature, water
+// level, the I2C environment sensors and the radio are shared.
+#ifndef ZONE_COUNT
+#define ZONE_COUNT 1   // build flag, e.g. -DZONE_COUNT=2
+#endif
+#define ZONE_MAX 4     // zone masks are one byte, ZONE_EACH stops at 4
+
+static_assert(ZONE_COUNT >= 1 && ZONE_COUNT <= ZONE_MAX, "ZONE_COUNT must be 1..ZONE_MAX");
+
+// M(0), M(1), ... once per zone, to brace-initialise per-zone object arrays
+#if ZONE_COUNT == 1
+#define ZONE_EACH(M) M(0)
+#elif ZONE_COUNT == 2
+#define ZONE_EACH(M) M(0), M(1)
+#elif ZONE_COUNT == 3
+#define ZONE_EACH(M) M(0), M(1), M(2)
+#else
+#define ZONE_EACH(M) M(0), M(1), M(2), M(3)
+#endif
+
+#define ZONE_BIT(z) (1 << (z))
+
+// Wiring of one zone
+struct ZonePins {
+    uint8_t phAdc;
+    uint8_t ecAdc;
+    uint8_t pumpRelay;
+    uint8_t phRelay;
+    uint8_t nutrientRelay;
+};
+
+enum PHState : uint8_t { PH_IDLE, PH_DOSING, PH_MIXING };
+enum NutrientState : uint8_t { NUTRIENT_IDLE, NUTRIENT_DOSING };
+
+// Per-zone scalar state as a struct of arrays: one array per quantity, so
+// a pass over every zone for one quantity reads a single contiguous array.
+struct ZoneTable {
+    float pH[ZONE_COUNT];               // filtered, what the controllers act on
+    float rawPH[ZONE_COUNT];            // last unfiltered reading
+    float ec[ZONE_COUNT];
+    float rawEC[ZONE_COUNT];
+    float ecVoltage[ZONE_COUNT];        // last probe voltage, for calibration
+    float targetPH[ZONE_COUNT];
+    float targetEC[ZONE_COUNT];
+    PHState phState[ZONE_COUNT];
+    NutrientState nutrientState[ZONE_COUNT];
+    unsigned long phStateStart[ZONE_COUNT];
+    unsigned long nutrientStateStart[ZONE_COUNT];
+    uint8_t phWake;                     // ZONE_BIT per zone with a pH step to take
+    uint8_t nutrientWake;
+};
+
+#endif // ZONES_H
@@ -0,0 +1,124 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <Arduino.h>
+#include <cstdio>
+#include <dirent.h>
+#include <memory>
+#include <sys/stat.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+// Card paths under a host directory, e.g. a test's scratch directory
+namespace fs {
+
+enum SeekMode { SeekSet = SEEK_SET, SeekCur = SEEK_CUR, SeekEnd = SEEK_END };
+
+class File {
+public:
+    File() {}
+    explicit operator bool() const { return _file || _dir; }
+    size_t write(const uint8_t* data, size_t len) { return _file ? fwrite(data, 1, len, _file.get()) : 0; }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t read(uint8_t* data, size_t len) { return _file ? fread(data, 1, len, _file.get()) : 0; }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) { return _file && fseek(_file.get(), pos, mode) == 0; }
+    size_t position() const { return _file ? ftell(_file.get()) : 0; }
+    size_t size() const {
+        if (!_file) return 0;
+        fflush(_file.get());
+        struct stat st;
+        return fstat(fileno(_file.get()), &st) == 0 ? st.st_size : 0;
+    }
+    void flush() {
+        if (_file) fflush(_file.get());
+    }
+    void close() {
+        _file.reset();
+        _dir.reset();
+    }
+    const char* name() const { return _name.c_str(); }
+    const char* path() const { return _path.c_str(); }
+    bool isDirectory() const { return (bool)_dir; }
+    File openNextFile();
+
+private:
+    friend class FS;
+    std::shared_ptr<FILE> _file;
+    std::shared_ptr<DIR> _dir;
+    std::string _root;
+    std::string _path;
+    std::string _name;
+
+    static File at(const std::string& root, const std::string& path, const char* mode);
+};
+
+class FS {
+public:
+    explicit FS(const char* root) : _root(root) {}
+    File open(const char* path, const char* mode = FILE_READ, bool create = false) {
+        (void)create;  // "w" and "a" create anyway
+        return File::at(_root, path, mode);
+    }
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path) {
+        struct stat st;
+        return stat(host(path).c_str(), &st) == 0;
+    }
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path) { return ::remove(host(path).c_str()) == 0; }
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to) { return ::rename(host(from).c_str(), host(to).c_str()) == 0; }
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path) { return ::mkdir(host(path).c_str(), 0755) == 0; }
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+
+private:
+    std::string _root;
+
+    std::string host(const char* path) const { return _root + path; }
+};
+
+// A directory opens to list it; a missing file only opens to write
+inline File File::at(const std::string& root, const std::string& path, const char* mode) {
+    File file;
+    std::string host = root + path;
+    struct stat st;
+    bool exists = stat(host.c_str(), &st) == 0;
+    if (exists && S_ISDIR(st.st_mode)) {
+        if (mode[0] == 'r') file._dir.reset(opendir(host.c_str()), closedir);
+    } else if (mode[0] != 'r' || exists) {
+        const char* hostMode = mode[0] == 'a' ? "a+b" : mode[0] == 'w' ? "w+b" : mode[1] == '+' ? "r+b" : "rb";
+        FILE* handle = fopen(host.c_str(), hostMode);
+        if (handle) file._file.reset(handle, fclose);
+    }
+    if (!file) return File();
+    file._root = root;
+    file._path = path;
+    size_t slash = path.rfind('/');
+    file._name = slash == std::string::npos ? path : path.substr(slash + 1);
+    return file;
+}
+
+inline File File::openNextFile() {
+    if (!_dir) return File();
+    while (dirent* entry = readdir(_dir.get())) {
+        if (entry->d_name[0] == '.') continue;
+        return at(_root, _path + "/" + entry->d_name, FILE_READ);
+    }
+    return File();
+}
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
+
+#endif // NATIVE_FS_H
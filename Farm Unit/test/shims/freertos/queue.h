@@ -0,0 +1,59 @@
+#ifndef NATIVE_FREERTOS_QUEUE_H
+#define NATIVE_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Fixed-length queue of items copied in and out, as FreeRTOS does
+struct NativeQueue {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+    std::mutex lock;
+    std::condition_variable changed;
+};
+
+typedef NativeQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    NativeQueue* queue = new NativeQueue;
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+// Waits up to ticks ms for pass(); portMAX_DELAY waits for good
+template <typename Pass>
+inline bool nativeQueueWait(QueueHandle_t queue, std::unique_lock<std::mutex>& held, TickType_t ticks, Pass pass) {
+    if (ticks == portMAX_DELAY) {
+        queue->changed.wait(held, pass);
+        return true;
+    }
+    return queue->changed.wait_for(held, std::chrono::milliseconds(ticks), pass);
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> held(queue->lock);
+    if (!nativeQueueWait(queue, held, ticks, [&] { return queue->items.size() < queue->length; })) return pdFALSE;
+    const uint8_t* bytes = (const uint8_t*)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> held(queue->lock);
+    if (!nativeQueueWait(queue, held, ticks, [&] { return !queue->items.empty(); })) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+#endif // NATIVE_FREERTOS_QUEUE_H
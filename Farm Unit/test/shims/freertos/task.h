@@ -0,0 +1,19 @@
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+#include <thread>
+
+// A task is a detached thread; the core and priority are not modelled
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char*, uint32_t, void* parameter,
+                                          UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+    std::thread* task = new std::thread(code, parameter);
+    task->detach();
+    if (handle) *handle = task;
+    return pdTRUE;
+}
+
+#endif // NATIVE_FREERTOS_TASK_H
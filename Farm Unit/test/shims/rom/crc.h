@@ -0,0 +1,12 @@
+#ifndef NATIVE_ROM_CRC_H
+#define NATIVE_ROM_CRC_H
+
+#include <zlib.h>
+#include <cstdint>
+
+// The ROM routine is zlib's CRC-32: crc32_le(0, ...) starts a fresh one
+inline uint32_t crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    return crc32(crc, buf, len);
+}
+
+#endif // NATIVE_ROM_CRC_H
@@ -0,0 +1,109 @@
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "frame_backlog.h"
+
+static char root[] = "/tmp/frame_backlog_XXXXXX";
+static fs::FS* card;
+static FrameBacklog backlog;
+
+// A fresh boot on the same card
+static void reboot() {
+    backlog = FrameBacklog();
+    backlog.begin(*card);
+}
+
+static TelemetryFrame frame(uint32_t seq) {
+    TelemetryFrame out;
+    out.seq = seq;
+    snprintf(out.json, sizeof(out.json), "{\"q\":%lu}", (unsigned long)seq);
+    return out;
+}
+
+// Failed sends go straight to the queue file
+static void storeFrames(uint32_t first, uint32_t count) {
+    for (uint32_t seq = first; seq < first + count; seq++) backlog.sent(frame(seq), false, 0);
+}
+
+static uint32_t replaySeq() {
+    TelemetryFrame out;
+    TEST_ASSERT_TRUE(backlog.nextReplay(out, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, strcmp(out.json, frame(out.seq).json));
+    return out.seq;
+}
+
+void setUp() {
+    std::string command = std::string("rm -rf ") + root + "/queue";
+    system(command.c_str());
+    reboot();
+}
+void tearDown() {}
+
+// Only the slots say how far the ring got: the tail comes back from their indexes
+void test_tail_recovered_from_slots() {
+    storeFrames(100, 5);
+    TEST_ASSERT_EQUAL_UINT32(5, backlog.stored());
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(5, backlog.queued());
+    for (uint32_t seq = 100; seq < 105; seq++) TEST_ASSERT_EQUAL_UINT32(seq, replaySeq());
+    TEST_ASSERT_EQUAL_UINT32(0, backlog.queued());
+    TEST_ASSERT_FALSE(card->exists(BACKLOG_DIR "/frames.bin"));
+}
+
+// Past a full ring the oldest slots are overwritten; after a reboot the head
+// read from the card is clamped to the oldest frame still there
+void test_head_clamped_after_wrap() {
+    storeFrames(0, 20);
+    for (uint32_t seq = 0; seq < BACKLOG_HEAD_SAVE_FRAMES; seq++) TEST_ASSERT_EQUAL_UINT32(seq, replaySeq());
+    storeFrames(20, BACKLOG_MAX_FRAMES);
+    TEST_ASSERT_EQUAL_UINT32(BACKLOG_MAX_FRAMES, backlog.queued());
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(BACKLOG_MAX_FRAMES, backlog.queued());
+    TEST_ASSERT_EQUAL_UINT32(20, replaySeq());
+}
+
+// A slot torn mid-write fails its CRC and is skipped, the rest replay
+void test_torn_slot_skipped() {
+    storeFrames(0, 3);
+    File frames = card->open(BACKLOG_DIR "/frames.bin", "r+");
+    TEST_ASSERT_TRUE(frames.seek(BACKLOG_SLOT_SIZE + offsetof(BacklogSlot, json)));
+    frames.write((const uint8_t*)"xx", 2);
+    frames.close();
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(3, backlog.queued());
+    TEST_ASSERT_EQUAL_UINT32(0, replaySeq());
+    TEST_ASSERT_EQUAL_UINT32(2, replaySeq());
+    TEST_ASSERT_EQUAL_UINT32(1, backlog.dropped());
+    TEST_ASSERT_EQUAL_UINT32(0, backlog.queued());
+}
+
+// The head goes to the card every BACKLOG_HEAD_SAVE_FRAMES replays, not per
+// frame: a reboot replays at most that many again
+void test_head_saved_in_batches() {
+    storeFrames(0, 40);
+    for (uint32_t seq = 0; seq < BACKLOG_HEAD_SAVE_FRAMES - 1; seq++) replaySeq();
+    TEST_ASSERT_FALSE(card->exists(BACKLOG_DIR "/head"));
+    replaySeq();
+    TEST_ASSERT_TRUE(card->exists(BACKLOG_DIR "/head"));
+    for (uint32_t i = 0; i < 4; i++) replaySeq();
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(40 - BACKLOG_HEAD_SAVE_FRAMES, backlog.queued());
+    TEST_ASSERT_EQUAL_UINT32(BACKLOG_HEAD_SAVE_FRAMES, replaySeq());
+    while (backlog.queued() > 0) replaySeq();
+    TEST_ASSERT_FALSE(card->exists(BACKLOG_DIR "/head"));
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(0, backlog.queued());
+}
+
+int main(int, char**) {
+    if (!mkdtemp(root)) return 1;
+    fs::FS scratch(root);
+    card = &scratch;
+    UNITY_BEGIN();
+    RUN_TEST(test_tail_recovered_from_slots);
+    RUN_TEST(test_head_clamped_after_wrap);
+    RUN_TEST(test_torn_slot_skipped);
+    RUN_TEST(test_head_saved_in_batches);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+#include <unity.h>
+#include <zlib.h>
+#include <cstdio>
+#include <cstdlib>
+#include "gzip_stream.h"
+
+// Collects the compressed stream
+class StringPrint : public Print {
+public:
+    std::string data;
+    size_t write(uint8_t c) override {
+        data.push_back(c);
+        return 1;
+    }
+    size_t write(const uint8_t* bytes, size_t len) override {
+        data.append((const char*)bytes, len);
+        return len;
+    }
+};
+
+static GzipStream gzip;
+
+static std::string gunzip(const std::string& in) {
+    z_stream z = {};
+    TEST_ASSERT_EQUAL_INT(Z_OK, inflateInit2(&z, 16 + MAX_WBITS));
+    z.next_in = (Bytef*)in.data();
+    z.avail_in = in.size();
+    std::string out;
+    char buffer[16384];
+    int result;
+    do {
+        z.next_out = (Bytef*)buffer;
+        z.avail_out = sizeof(buffer);
+        result = inflate(&z, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - z.avail_out);
+    } while (result == Z_OK);
+    inflateEnd(&z);
+    TEST_ASSERT_EQUAL_INT(Z_STREAM_END, result);
+    TEST_ASSERT_EQUAL_UINT32(0, z.avail_in);  // nothing after the trailer
+    return out;
+}
+
+// Compresses data in pieces of the given size and checks zlib gets it back
+static std::string roundTrip(const std::string& data, size_t piece) {
+    StringPrint out;
+    gzip.begin(out);
+    for (size_t i = 0; i < data.size(); i += piece) {
+        size_t n = min(piece, data.size() - i);
+        TEST_ASSERT_EQUAL_UINT32(n, gzip.write((const uint8_t*)data.data() + i, n));
+    }
+    gzip.finish();
+    TEST_ASSERT_TRUE(gunzip(out.data) == data);
+    TEST_ASSERT_EQUAL_UINT32(data.size(), gzip.bytesIn());
+    TEST_ASSERT_EQUAL_UINT32(out.data.size(), gzip.bytesOut());
+    return out.data;
+}
+
+static std::string sensorCsv(uint32_t rows) {
+    std::string csv = "time,signal,zone,value\n";
+    char line[64];
+    for (uint32_t i = 0; i < rows; i++) {
+        snprintf(line, sizeof(line), "%lu.%03lu,%lu,%lu,%.3f\n", 1760832000UL + i * 5, (unsigned long)(i % 1000),
+                 (unsigned long)(i % 7), (unsigned long)(i % 3), 6.5 + (i % 40) * 0.01);
+        csv += line;
+    }
+    return csv;
+}
+
+static std::string randomBytes(size_t size, unsigned seed) {
+    srand(seed);
+    std::string data;
+    for (size_t i = 0; i < size; i++) data.push_back(rand());
+    return data;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty() {
+    roundTrip("", 1);
+}
+
+void test_short_text() {
+    roundTrip("ab", 1);
+    roundTrip("abcabcabcabcabc", 4);
+}
+
+void test_csv_compresses() {
+    std::string csv = sensorCsv(20000);
+    std::string gz = roundTrip(csv, 37);
+    TEST_ASSERT_TRUE(gz.size() * 2 < csv.size());
+    // Same stream whatever the write size
+    TEST_ASSERT_TRUE(roundTrip(csv, 1) == gz);
+    TEST_ASSERT_TRUE(roundTrip(csv, 4096) == gz);
+}
+
+void test_long_runs() {
+    std::string zeros(1000000, '\0');
+    TEST_ASSERT_TRUE(roundTrip(zeros, 777).size() < 2000);
+}
+
+void test_random_is_stored() {
+    std::string data = randomBytes(300000, 1);
+    std::string gz = roundTrip(data, 1000);
+    // Stored blocks: 5 bytes each on top of the data, plus header and trailer
+    TEST_ASSERT_TRUE(gz.size() <= data.size() + data.size() / 256 + 32);
+}
+
+void test_mixed_blocks() {
+    // Text and noise in turn, so block types change along the stream
+    std::string data;
+    for (unsigned i = 0; i < 20; i++) data += i % 2 ? randomBytes(3000 + i * 500, i) : sensorCsv(100 + i * 20);
+    roundTrip(data, 1400);
+}
+
+void test_fuzz() {
+    srand(7);
+    for (unsigned round = 0; round < 40; round++) {
+        size_t size = rand() % 40000;
+        unsigned alphabet = 1 + rand() % 256;
+        std::string data;
+        for (size_t i = 0; i < size; i++) data.push_back(rand() % alphabet);
+        roundTrip(data, 1 + rand() % 3000);
+    }
+}
+
+void test_deflated_prefix() {
+    // A raw deflate sync-flushed by zlib is whole, non-final, byte-aligned blocks
+    static const char text[] = "<!DOCTYPE html><html><head><title>Farm Unit</title></head><body>";
+    uint8_t deflated[256];
+    z_stream z = {};
+    deflateInit2(&z, 9, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    z.next_in = (Bytef*)text;
+    z.avail_in = sizeof(text) - 1;
+    z.next_out = deflated;
+    z.avail_out = sizeof(deflated);
+    deflate(&z, Z_SYNC_FLUSH);
+    DeflatedText shell = { text, sizeof(text) - 1, deflated, sizeof(deflated) - z.avail_out,
+                           (uint32_t)crc32(0, (const Bytef*)text, sizeof(text) - 1) };
+    deflateEnd(&z);
+
+    std::string rest = sensorCsv(500) + "</body></html>";
+    StringPrint out;
+    gzip.begin(out);
+    TEST_ASSERT_TRUE(gzip.writeDeflated(shell));
+    gzip.write((const uint8_t*)rest.data(), rest.size());
+    TEST_ASSERT_FALSE(gzip.writeDeflated(shell));  // first data only
+    gzip.finish();
+    TEST_ASSERT_TRUE(gunzip(out.data) == std::string(text) + rest);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty);
+    RUN_TEST(test_short_text);
+    RUN_TEST(test_csv_compresses);
+    RUN_TEST(test_long_runs);
+    RUN_TEST(test_random_is_stored);
+    RUN_TEST(test_mixed_blocks);
+    RUN_TEST(test_fuzz);
+    RUN_TEST(test_deflated_prefix);
+    return UNITY_END();
+}
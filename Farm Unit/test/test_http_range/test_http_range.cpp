@@ -0,0 +1,85 @@
+#include <unity.h>
+#include "http_range.h"
+
+#define SIZE 1000
+
+static size_t start, end;
+static bool satisfiable;
+
+// What SD_file_download() answers: 200, 206 or 416
+static int status(const char* header, size_t size = SIZE) {
+    start = end = 12345;
+    satisfiable = true;
+    if (!parseRange(header, size, start, end, satisfiable)) return 200;
+    return satisfiable ? 206 : 416;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_first_and_last() {
+    TEST_ASSERT_EQUAL_INT(206, status("bytes=0-99"));
+    TEST_ASSERT_EQUAL_UINT32(0, start);
+    TEST_ASSERT_EQUAL_UINT32(99, end);
+    TEST_ASSERT_EQUAL_INT(206, status("bytes= 10 - 10 "));
+    TEST_ASSERT_EQUAL_UINT32(10, start);
+    TEST_ASSERT_EQUAL_UINT32(10, end);
+    // an end past the file is cut to it
+    TEST_ASSERT_EQUAL_INT(206, status("bytes=900-5000"));
+    TEST_ASSERT_EQUAL_UINT32(900, start);
+    TEST_ASSERT_EQUAL_UINT32(SIZE - 1, end);
+}
+
+void test_open_end() {
+    TEST_ASSERT_EQUAL_INT(206, status("bytes=500-"));
+    TEST_ASSERT_EQUAL_UINT32(500, start);
+    TEST_ASSERT_EQUAL_UINT32(SIZE - 1, end);
+    TEST_ASSERT_EQUAL_INT(206, status("bytes=999-"));
+    TEST_ASSERT_EQUAL_UINT32(999, start);
+}
+
+void test_suffix() {
+    TEST_ASSERT_EQUAL_INT(206, status("bytes=-100"));
+    TEST_ASSERT_EQUAL_UINT32(900, start);
+    TEST_ASSERT_EQUAL_UINT32(SIZE - 1, end);
+    // longer than the file: all of it
+    TEST_ASSERT_EQUAL_INT(206, status("bytes=-2000"));
+    TEST_ASSERT_EQUAL_UINT32(0, start);
+    TEST_ASSERT_EQUAL_UINT32(SIZE - 1, end);
+}
+
+void test_unsatisfiable() {
+    TEST_ASSERT_EQUAL_INT(416, status("bytes=1000-"));
+    TEST_ASSERT_EQUAL_INT(416, status("bytes=2000-3000"));
+    TEST_ASSERT_EQUAL_INT(416, status("bytes=-0"));
+    TEST_ASSERT_EQUAL_INT(416, status("bytes=99999999999999999999999-"));
+}
+
+void test_empty_file() {
+    TEST_ASSERT_EQUAL_INT(416, status("bytes=0-", 0));
+    TEST_ASSERT_EQUAL_INT(416, status("bytes=0-0", 0));
+    TEST_ASSERT_EQUAL_INT(416, status("bytes=-5", 0));
+}
+
+// Anything else is ignored and the whole file goes out
+void test_ignored() {
+    TEST_ASSERT_EQUAL_INT(200, status("bytes=0-1,5-6"));
+    TEST_ASSERT_EQUAL_INT(200, status("bytes=5-2"));
+    TEST_ASSERT_EQUAL_INT(200, status("bytes=abc-"));
+    TEST_ASSERT_EQUAL_INT(200, status("bytes=1-2x"));
+    TEST_ASSERT_EQUAL_INT(200, status("bytes=-"));
+    TEST_ASSERT_EQUAL_INT(200, status("bytes="));
+    TEST_ASSERT_EQUAL_INT(200, status("items=0-1"));
+    TEST_ASSERT_EQUAL_INT(200, status(""));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_and_last);
+    RUN_TEST(test_open_end);
+    RUN_TEST(test_suffix);
+    RUN_TEST(test_unsatisfiable);
+    RUN_TEST(test_empty_file);
+    RUN_TEST(test_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "sensor_log.h"
+#include "log_query.h"
+
+#define EPOCH 1760832000UL          // 2025-10-19 00:00 UTC
+
+static char root[] = "/tmp/log_query_XXXXXX";
+static fs::FS* card;
+static SensorLog sensorLog;
+
+struct Sample {
+    uint8_t signal;
+    uint32_t time;
+    int32_t value;                  // milli-units
+};
+static std::vector<Sample> logged;
+
+// A fresh boot on the same card
+static void reboot(uint32_t epoch) {
+    sensorLog = SensorLog();
+    sensorLog.begin(*card);
+    sensorLog.setEpoch(epoch, 0);
+}
+
+static void clearLog(uint32_t epoch) {
+    std::string command = std::string("rm -rf ") + root + "/log";
+    system(command.c_str());
+    reboot(epoch);
+    logged.clear();
+}
+
+// One sample per period of each signal from boot on, flushed as logSample() does
+static void run(uint32_t epoch, uint8_t signals, uint32_t periodMs, uint32_t seconds) {
+    for (uint64_t now = 0; now < seconds * 1000ULL; now += periodMs) {
+        for (uint8_t signal = 0; signal < signals; signal++) {
+            float value = 6.5f + signal + (now / periodMs % 7) * 0.01f;
+            sensorLog.append(signal, 0, value, now);
+            logged.push_back({ signal, (uint32_t)(epoch + now / 1000), (int32_t)lroundf(value * 1000) });
+            if (sensorLog.flushDue(now)) sensorLog.flush(now);
+        }
+    }
+    uint64_t end = seconds * 1000ULL + LOG_SERIES_MAX_AGE_MS;
+    sensorLog.flush(end);
+    sensorLog.flush(end + LOG_PACK_MAX_AGE_MS);
+}
+
+static uint32_t expected(uint32_t from, uint32_t to) {
+    uint32_t count = 0;
+    for (const Sample& sample : logged) count += sample.time >= from && sample.time <= to;
+    return count;
+}
+
+// Runs the query, checking each record against the logged samples; returns the count
+static uint32_t drain(LogQuery& query, uint32_t from, uint32_t to) {
+    LogRecord record;
+    uint32_t count = 0;
+    while (query.next(record)) {
+        TEST_ASSERT_TRUE(record.time >= from && record.time <= to);
+        bool found = false;
+        for (const Sample& sample : logged) {
+            if (sample.signal == record.signal && sample.time == record.time && sample.value == record.value) {
+                found = true;
+                break;
+            }
+        }
+        TEST_ASSERT_TRUE(found);
+        count++;
+    }
+    return count;
+}
+
+static size_t fileSize(const char* path) {
+    File file = card->open(path, FILE_READ);
+    return file ? file.size() : 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// The index keeps a narrow query to the writes that can reach it
+void test_index_limits_blocks_read() {
+    clearLog(EPOCH);
+    run(EPOCH, 3, 1000, 4 * 3600);
+    uint32_t fileBlocks = fileSize("/log/20251019.bin") / LOG_BLOCK_SIZE;
+    TEST_ASSERT_TRUE(fileSize("/log/20251019.idx") >= 4 * sizeof(LogIndexEntry));
+
+    LogQuery query;
+    uint32_t from = EPOCH + 2 * 3600, to = from + 300;
+    query.begin(*card, from, to);
+    TEST_ASSERT_EQUAL_UINT32(expected(from, to), drain(query, from, to));
+    printf("%u of %u blocks read\n", (unsigned)query.blocksRead(), (unsigned)fileBlocks);
+    TEST_ASSERT_TRUE(query.blocksRead() * 4 <= fileBlocks);
+}
+
+// A write cut off mid-block leaves a partial block; the writer pads past it
+// and neither it nor the blocks after it are lost to readers
+void test_torn_tail_block() {
+    clearLog(EPOCH);
+    run(EPOCH, 1, 1000, 1800);
+    File data = card->open("/log/20251019.bin", FILE_APPEND);
+    std::vector<uint8_t> torn(LOG_BLOCK_SIZE / 2, 0xA5);
+    data.write(torn.data(), torn.size());
+    data.close();
+
+    // the reboot after the crash, an hour on
+    size_t before = logged.size();
+    reboot(EPOCH + 3600);
+    run(EPOCH + 3600, 1, 1000, 1800);
+    TEST_ASSERT_TRUE(logged.size() > before);
+    TEST_ASSERT_EQUAL_UINT32(0, fileSize("/log/20251019.bin") % LOG_BLOCK_SIZE);
+
+    LogQuery query;
+    query.begin(*card, EPOCH, EPOCH + 86399);
+    TEST_ASSERT_EQUAL_UINT32(logged.size(), drain(query, EPOCH, EPOCH + 86399));
+
+    // the same data with the index gone: the whole file is scanned
+    card->remove("/log/20251019.idx");
+    query.begin(*card, EPOCH + 3600, EPOCH + 3700);
+    TEST_ASSERT_EQUAL_UINT32(expected(EPOCH + 3600, EPOCH + 3700), drain(query, EPOCH + 3600, EPOCH + 3700));
+}
+
+// A range across midnight reads the end of one file and the start of the next
+void test_query_spans_two_days() {
+    uint32_t start = EPOCH - 3600;  // 23:00 the day before
+    clearLog(start);
+    run(start, 2, 10000, 2 * 3600);
+    TEST_ASSERT_TRUE(fileSize("/log/20251018.bin") > 0);
+    TEST_ASSERT_TRUE(fileSize("/log/20251019.bin") > 0);
+
+    LogQuery query;
+    uint32_t from = EPOCH - 1800, to = EPOCH + 1800;
+    query.begin(*card, from, to);
+    TEST_ASSERT_EQUAL_UINT32(expected(from, to), drain(query, from, to));
+
+    // in time order across the two files
+    query.begin(*card, from, to, 1);
+    LogRecord record;
+    uint32_t last = 0;
+    while (query.next(record)) {
+        TEST_ASSERT_EQUAL_UINT8(1, record.signal);
+        TEST_ASSERT_TRUE(record.time >= last);
+        last = record.time;
+    }
+    TEST_ASSERT_TRUE(last >= EPOCH);
+}
+
+// The whole clock range opens only the files on the card, more of them than
+// one directory pass takes
+void test_full_range_lists_day_files() {
+    clearLog(EPOCH);
+    const uint32_t days = LOG_QUERY_DAYS + 8;
+    for (uint32_t d = 0; d < days; d++) {
+        uint32_t epoch = EPOCH - d * 86400 * 3;  // every third day
+        reboot(epoch);
+        run(epoch, 1, 1000, 60);
+    }
+    LogQuery query;
+    query.begin(*card, (uint32_t)0, UINT32_MAX);
+    LogRecord record;
+    uint32_t count = 0, last = 0;
+    while (query.next(record)) {
+        TEST_ASSERT_TRUE(record.time >= last);
+        last = record.time;
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(logged.size(), count);
+
+    // a range after the last file finds nothing
+    query.begin(*card, EPOCH + 86400, UINT32_MAX);
+    TEST_ASSERT_FALSE(query.next(record));
+}
+
+int main(int, char**) {
+    if (!mkdtemp(root)) return 1;
+    fs::FS scratch(root);
+    card = &scratch;
+    UNITY_BEGIN();
+    RUN_TEST(test_index_limits_blocks_read);
+    RUN_TEST(test_torn_tail_block);
+    RUN_TEST(test_query_spans_two_days);
+    RUN_TEST(test_full_range_lists_day_files);
+    return UNITY_END();
+}
@@ -0,0 +1,174 @@
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "log_rollup.h"
+
+#define EPOCH 1760832000UL          // 2025-10-19 00:00 UTC
+#define MINUTE 60
+#define HOUR 3600
+#define DAY 86400
+
+static char root[] = "/tmp/log_rollup_XXXXXX";
+static fs::FS* card;
+static LogRollup rollup;
+static unsigned long nowMs;
+
+// A fresh boot on the same card
+static void reboot() {
+    rollup = LogRollup();
+    rollup.begin(*card);
+}
+
+static void clearCard() {
+    std::string command = std::string("rm -rf ") + root + "/rollup";
+    system(command.c_str());
+    reboot();
+    nowMs = 0;
+}
+
+// Signal 0, zone 0 every step seconds in [from, to); returns the samples added
+static uint32_t addEvery(uint32_t from, uint32_t to, uint32_t step, int32_t value) {
+    uint32_t count = 0;
+    for (uint32_t t = from; t < to; t += step, count++) {
+        nowMs += step * 1000;
+        rollup.add(0, 0, value, t, nowMs);
+        if (rollup.flushDue(nowMs)) rollup.flush(nowMs);
+    }
+    return count;
+}
+
+static void flushAll() {
+    while (rollup.flush(nowMs) > 0) {
+    }
+}
+
+static RollupFileHeader header(const char* path) {
+    RollupFileHeader out = {};
+    File file = card->open(path, FILE_READ);
+    if (file) file.read((uint8_t*)&out, sizeof(out));
+    return out;
+}
+
+void setUp() {
+    clearCard();
+}
+void tearDown() {}
+
+// Past ROLLUP_MAX_GAP empty minutes the file is kept as a segment and a new
+// one starts, linked back to it, with no padding in between
+void test_gap_starts_segment() {
+    addEvery(EPOCH, EPOCH + 2 * MINUTE, 10, 100);
+    uint32_t later = EPOCH + (ROLLUP_MAX_GAP + 10) * MINUTE;
+    addEvery(later, later + 2 * MINUTE, 10, 200);
+    addEvery(later + 2 * MINUTE, later + 2 * MINUTE + 1, 1, 200);  // closes the second minute
+    flushAll();
+    TEST_ASSERT_EQUAL_UINT32(0, rollup.writeErrors());
+
+    char segment[ROLLUP_PATH_LEN];
+    snprintf(segment, sizeof(segment), "%s/1m/s0z0_%08lx.bin", ROLLUP_DIR, (unsigned long)EPOCH);
+    RollupFileHeader old = header(segment);
+    TEST_ASSERT_EQUAL_UINT32(ROLLUP_MAGIC, old.magic);
+    TEST_ASSERT_EQUAL_UINT32(EPOCH, old.base);
+    RollupFileHeader current = header(ROLLUP_DIR "/1m/s0z0.bin");
+    TEST_ASSERT_EQUAL_UINT32(later, current.base);
+    TEST_ASSERT_EQUAL_UINT32(EPOCH, current.previous);
+    File file = card->open(ROLLUP_DIR "/1m/s0z0.bin", FILE_READ);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(RollupFileHeader) + 2 * sizeof(RollupBucket), file.size());
+}
+
+// A read back before the file being written walks through the segments
+void test_read_walks_back_segments() {
+    uint32_t starts[3];
+    uint32_t added = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        starts[i] = EPOCH + i * (ROLLUP_MAX_GAP + 10) * MINUTE;
+        added += addEvery(starts[i], starts[i] + 3 * MINUTE, 10, 100 * (i + 1));
+    }
+    addEvery(starts[2] + 10 * MINUTE, starts[2] + 10 * MINUTE + 1, 1, 0);
+    flushAll();
+    uint32_t span = starts[2] + 3 * MINUTE - EPOCH;
+
+    RollupBucket all = rollup.read(0, 0, 0, EPOCH, span);
+    TEST_ASSERT_EQUAL_UINT32(added, all.count);
+    TEST_ASSERT_EQUAL_INT32(100, all.min);
+    TEST_ASSERT_EQUAL_INT32(300, all.max);
+    TEST_ASSERT_EQUAL_INT32(200, all.mean);
+
+    // the first segment alone, two files back
+    RollupBucket first = rollup.read(0, 0, 0, EPOCH, 3 * MINUTE);
+    TEST_ASSERT_EQUAL_UINT32(18, first.count);
+    TEST_ASSERT_EQUAL_INT32(100, first.max);
+    // the middle one
+    RollupBucket middle = rollup.read(0, 0, 0, starts[1], 3 * MINUTE);
+    TEST_ASSERT_EQUAL_UINT32(18, middle.count);
+    TEST_ASSERT_EQUAL_INT32(200, middle.mean);
+}
+
+// A bucket that is already on the card takes the new one in
+void test_merge_into_stored_bucket() {
+    addEvery(EPOCH, EPOCH + 30, 10, 100);          // 3 samples of minute 0
+    addEvery(EPOCH + MINUTE, EPOCH + MINUTE + 1, 1, 0);
+    flushAll();
+
+    // back after a reboot within the same minute
+    reboot();
+    addEvery(EPOCH + 30, EPOCH + MINUTE, 10, 400); // 3 more
+    addEvery(EPOCH + 2 * MINUTE, EPOCH + 2 * MINUTE + 1, 1, 0);
+    flushAll();
+
+    File file = card->open(ROLLUP_DIR "/1m/s0z0.bin", FILE_READ);
+    RollupBucket stored;
+    TEST_ASSERT_TRUE(file.seek(sizeof(RollupFileHeader)));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(stored), file.read((uint8_t*)&stored, sizeof(stored)));
+    TEST_ASSERT_EQUAL_UINT32(6, stored.count);
+    TEST_ASSERT_EQUAL_INT32(100, stored.min);
+    TEST_ASSERT_EQUAL_INT32(400, stored.max);
+    TEST_ASSERT_EQUAL_INT32(250, stored.mean);
+}
+
+// After a reboot the open hour and day start from the finer levels on the
+// card; every sample counts once in them
+void test_reboot_rebuilds_open_hour_and_day() {
+    uint32_t firstHour = addEvery(EPOCH, EPOCH + HOUR, 10, 100);
+    uint32_t beforeReboot = addEvery(EPOCH + HOUR, EPOCH + HOUR + 30 * MINUTE, 10, 100);
+    flushAll();
+    // the open minute, 01:29, is lost with the RAM
+    beforeReboot -= 6;
+
+    reboot();
+    uint32_t afterReboot = addEvery(EPOCH + HOUR + 30 * MINUTE, EPOCH + 2 * HOUR, 10, 100);
+    RollupBucket hour = rollup.read(1, 0, 0, EPOCH + HOUR, HOUR);
+    TEST_ASSERT_EQUAL_UINT32(beforeReboot + afterReboot, hour.count);
+
+    uint32_t third = addEvery(EPOCH + 2 * HOUR, EPOCH + 2 * HOUR + 10 * MINUTE, 10, 100);
+    addEvery(EPOCH + DAY, EPOCH + DAY + 1, 1, 100);  // closes minute, hour and day
+    flushAll();
+    TEST_ASSERT_EQUAL_UINT32(0, rollup.dropped());
+
+    File file = card->open(ROLLUP_DIR "/1h/s0z0.bin", FILE_READ);
+    RollupBucket stored[2];
+    TEST_ASSERT_TRUE(file.seek(sizeof(RollupFileHeader)));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(stored), file.read((uint8_t*)stored, sizeof(stored)));
+    TEST_ASSERT_EQUAL_UINT32(firstHour, stored[0].count);
+    TEST_ASSERT_EQUAL_UINT32(beforeReboot + afterReboot, stored[1].count);
+
+    file = card->open(ROLLUP_DIR "/1d/s0z0.bin", FILE_READ);
+    RollupBucket day;
+    TEST_ASSERT_TRUE(file.seek(sizeof(RollupFileHeader)));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(day), file.read((uint8_t*)&day, sizeof(day)));
+    TEST_ASSERT_EQUAL_UINT32(firstHour + beforeReboot + afterReboot + third, day.count);
+    TEST_ASSERT_EQUAL_UINT32(day.count, rollup.read(2, 0, 0, EPOCH, DAY).count);
+}
+
+int main(int, char**) {
+    if (!mkdtemp(root)) return 1;
+    fs::FS scratch(root);
+    card = &scratch;
+    UNITY_BEGIN();
+    RUN_TEST(test_gap_starts_segment);
+    RUN_TEST(test_read_walks_back_segments);
+    RUN_TEST(test_merge_into_stored_bucket);
+    RUN_TEST(test_reboot_rebuilds_open_hour_and_day);
+    return UNITY_END();
+}
@@ -0,0 +1,95 @@
+#include <unity.h>
+#include "series_codec.h"
+
+static LogBlock block;
+
+static LogRecord record(uint64_t timeMs, int32_t value) {
+    LogRecord r = {};
+    r.time = timeMs / 1000;
+    r.ms = timeMs % 1000;
+    r.signal = 3;
+    r.zone = 1;
+    r.value = value;
+    return r;
+}
+
+// Encodes until the block is full or count samples are in, decodes it back
+// and checks every sample; returns how many went in
+static uint16_t roundTrip(uint16_t count, uint64_t (*timeAt)(uint16_t), int32_t (*valueAt)(uint16_t)) {
+    SeriesEncoder encoder;
+    encoder.start(block, record(timeAt(0), valueAt(0)));
+    uint16_t added = 1;
+    while (added < count && encoder.add(block, timeAt(added), valueAt(added))) added++;
+    TEST_ASSERT_EQUAL_UINT16(added, block.header.count);
+    TEST_ASSERT_TRUE(block.header.length <= LOG_PAYLOAD_SIZE);
+
+    SeriesDecoder decoder(block);
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        LogRecord r;
+        for (uint16_t i = 0; i < added; i++) {
+            TEST_ASSERT_TRUE(decoder.next(r));
+            LogRecord want = record(timeAt(i), valueAt(i));
+            TEST_ASSERT_EQUAL_UINT32(want.time, r.time);
+            TEST_ASSERT_EQUAL_UINT16(want.ms, r.ms);
+            TEST_ASSERT_EQUAL_INT32(want.value, r.value);
+            TEST_ASSERT_EQUAL_UINT8(3, r.signal);
+            TEST_ASSERT_EQUAL_UINT8(1, r.zone);
+        }
+        TEST_ASSERT_FALSE(decoder.next(r));
+        decoder.rewind();
+    }
+    return added;
+}
+
+static uint64_t steadyTime(uint16_t i) { return 1760832000000ULL + i * 1000ULL; }
+static int32_t phValue(uint16_t i) { return 6500 + (i % 7) - 3; }
+static uint64_t jitterTime(uint16_t i) { return 1760832000000ULL + i * 1000ULL + (i * 7919 % 23); }
+static uint64_t burstTime(uint16_t i) { return 1760832000000ULL + (i / 4) * 600000ULL + i % 4; }
+static int32_t extremeValue(uint16_t i) { return i % 2 ? INT32_MAX - i : INT32_MIN + i; }
+static int32_t stepValue(uint16_t i) { return (i % 5) * 100000 - 200000; }
+
+void setUp() {}
+void tearDown() {}
+
+void test_steady_series_packs_densely() {
+    uint16_t added = roundTrip(1000, steadyTime, phValue);
+    // 1-2 bytes per sample once the steady rate is found, against 12 raw
+    TEST_ASSERT_TRUE(added > 2 * LOG_RECORDS_PER_BLOCK);
+}
+
+void test_jittered_times() {
+    roundTrip(1000, jitterTime, phValue);
+}
+
+void test_bursts_and_long_gaps() {
+    roundTrip(1000, burstTime, stepValue);
+}
+
+void test_values_wrap_losslessly() {
+    roundTrip(1000, steadyTime, extremeValue);
+}
+
+void test_single_sample() {
+    TEST_ASSERT_EQUAL_UINT16(1, roundTrip(1, steadyTime, phValue));
+}
+
+void test_truncated_payload_stops() {
+    roundTrip(200, jitterTime, stepValue);
+    block.header.length = sizeof(LogRecord) + 4;
+    SeriesDecoder decoder(block);
+    LogRecord r;
+    uint16_t decoded = 0;
+    while (decoder.next(r)) decoded++;
+    TEST_ASSERT_TRUE(decoded < block.header.count);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_series_packs_densely);
+    RUN_TEST(test_jittered_times);
+    RUN_TEST(test_bursts_and_long_gaps);
+    RUN_TEST(test_values_wrap_losslessly);
+    RUN_TEST(test_single_sample);
+    RUN_TEST(test_truncated_payload_stops);
+    return UNITY_END();
+}
@@ -0,0 +1,125 @@
+#include <unity.h>
+#include <zlib.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "upload_writer.h"
+
+static char root[] = "/tmp/upload_writer_XXXXXX";
+static fs::FS* card;
+static UploadWriter writer;
+
+static std::string hostPath(const char* path) {
+    return std::string(root) + path;
+}
+
+static std::string readFile(const char* path) {
+    std::string data;
+    FILE* file = fopen(hostPath(path).c_str(), "rb");
+    if (!file) return "(missing)";
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, n);
+    fclose(file);
+    return data;
+}
+
+static void writeFile(const char* path, const std::string& data) {
+    FILE* file = fopen(hostPath(path).c_str(), "wb");
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+}
+
+static bool exists(const char* path) {
+    return access(hostPath(path).c_str(), F_OK) == 0;
+}
+
+static std::string randomBytes(size_t size) {
+    std::string data;
+    for (size_t i = 0; i < size; i++) data.push_back(rand());
+    return data;
+}
+
+// Uploads data in pieces of the given size, as the web server hands them over
+static bool upload(const char* path, const std::string& data, size_t piece) {
+    if (!writer.begin(*card, path)) return false;
+    for (size_t i = 0; i < data.size(); i += piece) {
+        if (!writer.write((const uint8_t*)data.data() + i, min(piece, data.size() - i))) return false;
+    }
+    return writer.end() && writer.commit();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_file_is_identical() {
+    const size_t sizes[] = { 0, 1, UPLOAD_BUFFER_SIZE - 1, UPLOAD_BUFFER_SIZE, UPLOAD_BUFFER_SIZE + 1, 100000 };
+    const size_t pieces[] = { 1, 1436, UPLOAD_BUFFER_SIZE, 3 * UPLOAD_BUFFER_SIZE + 5 };
+    for (size_t size : sizes) {
+        for (size_t piece : pieces) {
+            std::string data = randomBytes(size);
+            TEST_ASSERT_TRUE(upload("/data.bin", data, piece));
+            TEST_ASSERT_TRUE(readFile("/data.bin") == data);
+            TEST_ASSERT_FALSE(exists("/data.bin.part"));
+            TEST_ASSERT_EQUAL_UINT32(size, writer.bytes());
+            TEST_ASSERT_EQUAL_UINT32(crc32(0, (const Bytef*)data.data(), data.size()), writer.crc());
+        }
+    }
+}
+
+void test_replaces_existing_file() {
+    writeFile("/config.txt", "old");
+    TEST_ASSERT_TRUE(upload("/config.txt", "new contents", 5));
+    TEST_ASSERT_TRUE(readFile("/config.txt") == "new contents");
+}
+
+void test_abort_keeps_old_file() {
+    writeFile("/config.txt", "old");
+    std::string data = randomBytes(3 * UPLOAD_BUFFER_SIZE);
+    TEST_ASSERT_TRUE(writer.begin(*card, "/config.txt"));
+    TEST_ASSERT_TRUE(writer.write((const uint8_t*)data.data(), data.size()));
+    TEST_ASSERT_TRUE(exists("/config.txt.part"));
+    writer.abort();
+    TEST_ASSERT_FALSE(exists("/config.txt.part"));
+    TEST_ASSERT_FALSE(writer.commit());
+    TEST_ASSERT_TRUE(readFile("/config.txt") == "old");
+}
+
+void test_commit_needs_end() {
+    writeFile("/config.txt", "old");
+    TEST_ASSERT_TRUE(writer.begin(*card, "/config.txt"));
+    TEST_ASSERT_TRUE(writer.write((const uint8_t*)"new", 3));
+    TEST_ASSERT_FALSE(writer.commit());  // still open
+    TEST_ASSERT_TRUE(writer.end());
+    TEST_ASSERT_TRUE(writer.commit());
+    TEST_ASSERT_TRUE(readFile("/config.txt") == "new");
+}
+
+void test_bad_path_fails() {
+    writeFile("/locked.bin", "old");
+    mkdir(hostPath("/locked.bin.part").c_str(), 0700);  // no .part file can be opened
+    TEST_ASSERT_FALSE(writer.begin(*card, "/locked.bin"));
+    TEST_ASSERT_FALSE(writer.write((const uint8_t*)"x", 1));
+    TEST_ASSERT_FALSE(writer.end());
+    TEST_ASSERT_FALSE(writer.commit());
+    TEST_ASSERT_TRUE(readFile("/locked.bin") == "old");
+    TEST_ASSERT_FALSE(writer.begin(*card, "/no/such/dir/file.bin"));
+    // The writer is usable again afterwards
+    TEST_ASSERT_TRUE(upload("/after.bin", "after", 2));
+    TEST_ASSERT_TRUE(readFile("/after.bin") == "after");
+}
+
+int main(int, char**) {
+    if (!mkdtemp(root)) return 1;
+    fs::FS scratch(root);
+    card = &scratch;
+    srand(3);
+    UNITY_BEGIN();
+    RUN_TEST(test_file_is_identical);
+    RUN_TEST(test_replaces_existing_file);
+    RUN_TEST(test_abort_keeps_old_file);
+    RUN_TEST(test_commit_needs_end);
+    RUN_TEST(test_bad_path_fails);
+    return UNITY_END();
+}